@@ -0,0 +1,575 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dbackupimage.h"
+#include "private/dblockio_p.h"
+#include "private/dbackupformat_p.h"
+#include "private/dxxhash64_p.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <zstd.h>
+
+namespace {
+// against a chain looping through forged parents
+const int MaxChainLength = 4096;
+}
+
+class DBackupImagePrivate
+{
+public:
+    ~DBackupImagePrivate();
+
+    bool readIndex();
+    bool openParent(const QString &name);
+    bool readChunk(quint64 i, uchar *data);
+    bool checkHash(quint64 i, const uchar *data);
+    int chunkSize() const;
+    quint64 chunkLength(quint64 i) const;
+    void fail(const QString &message);
+    void failWithErrno(const QString &what);
+
+    int fd = -1;
+    QString fileName;
+    DBackupFormat::Header header;
+    std::vector<DBackupFormat::IndexEntry> index;
+    quint64 storedSize = 0;
+    QScopedPointer<DBackupImage> parent;
+    int depth = 0; // in the chain, from the image opened
+    // kept from a chunk to the next, it allocates its tables once
+    ZSTD_DCtx *context = nullptr;
+    std::vector<uchar> buffer;
+    QString errorString;
+};
+
+DBackupImagePrivate::~DBackupImagePrivate()
+{
+    if (fd >= 0)
+        ::close(fd);
+
+    ZSTD_freeDCtx(context);
+}
+
+// Everything the chunks are read with is checked here once
+bool DBackupImagePrivate::readIndex()
+{
+    uchar encoded[DBackupFormat::HeaderSize];
+    struct stat st;
+
+    if (::fstat(fd, &st) < 0 || !DBlockIO::readAll(fd, encoded, sizeof(encoded), 0)) {
+        failWithErrno(QStringLiteral("Read header"));
+        return false;
+    }
+
+    if (!DBackupFormat::decodeHeader(encoded, &header)) {
+        fail(QStringLiteral("Not a backup image"));
+        return false;
+    }
+
+    if (header.indexOffset == 0) {
+        fail(QStringLiteral("The backup image is incomplete"));
+        return false;
+    }
+
+    const quint64 fileSize = static_cast<quint64>(st.st_size);
+    const quint64 chunk = header.chunkSize;
+
+    const size_t entrySize = DBackupFormat::IndexEntrySize;
+    // the length of the name of the parent
+    const quint64 trailer = 4;
+
+    // the writer never makes another size, a larger one would overflow the int of chunkSize()
+    if (!DBackupFormat::isValidChunkSize(header.chunkSize) || header.id == 0
+            || header.chunkCount != (header.size + chunk - 1) / chunk
+            || header.indexOffset < DBackupFormat::HeaderSize
+            || header.indexOffset > fileSize
+            || fileSize - header.indexOffset < trailer
+            || header.chunkCount > (fileSize - header.indexOffset - trailer) / entrySize) {
+        fail(QStringLiteral("The backup image is corrupted"));
+        return false;
+    }
+
+    std::vector<uchar> data(static_cast<size_t>(header.chunkCount * entrySize + trailer));
+
+    if (!DBlockIO::readAll(fd, data.data(), data.size(), header.indexOffset)) {
+        failWithErrno(QStringLiteral("Read index"));
+        return false;
+    }
+
+    index.resize(static_cast<size_t>(header.chunkCount));
+    storedSize = 0;
+
+    for (size_t i = 0; i < index.size(); ++i) {
+        DBackupFormat::IndexEntry &entry = index[i];
+
+        DBackupFormat::decodeIndexEntry(data.data() + i * entrySize, &entry);
+
+        const bool valid = entry.type == DBackupFormat::ZeroChunk
+                || (entry.type == DBackupFormat::CompressedChunk && entry.storedSize > 0)
+                || (entry.type == DBackupFormat::StoredChunk && entry.storedSize == chunkLength(i))
+                || (entry.type == DBackupFormat::ParentChunk && entry.storedSize == 0 && header.parentId != 0);
+
+        if (!valid || (entry.storedSize > 0 && (entry.offset < DBackupFormat::HeaderSize
+                                                || entry.offset + entry.storedSize > header.indexOffset))) {
+            fail(QStringLiteral("The backup image is corrupted at chunk %1").arg(i));
+            return false;
+        }
+
+        storedSize += entry.storedSize;
+    }
+
+    if (header.parentId == 0)
+        return true;
+
+    const quint64 nameOffset = header.indexOffset + data.size();
+    const quint32 nameLength = qFromLittleEndian<quint32>(data.data() + data.size() - trailer);
+
+    if (nameLength == 0 || nameLength > fileSize - nameOffset) {
+        fail(QStringLiteral("The backup image is corrupted"));
+        return false;
+    }
+
+    QByteArray name(static_cast<int>(nameLength), Qt::Uninitialized);
+
+    if (!DBlockIO::readAll(fd, reinterpret_cast<uchar *>(name.data()), nameLength, nameOffset)) {
+        failWithErrno(QStringLiteral("Read index"));
+        return false;
+    }
+
+    if (!openParent(QString::fromUtf8(name)))
+        return false;
+
+    for (size_t i = 0; i < index.size(); ++i) {
+        if (index[i].type == DBackupFormat::ParentChunk
+                && (i >= parent->chunkCount() || parent->chunkLength(i) != chunkLength(i))) {
+            fail(QStringLiteral("The chunk %1 isn't in the parent image").arg(i));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// The parent is where it was written, else next to this image: the chain may
+// have been moved or copied as a whole
+bool DBackupImagePrivate::openParent(const QString &name)
+{
+    if (depth + 1 >= MaxChainLength) {
+        fail(QStringLiteral("The chain of backup images is too long"));
+        return false;
+    }
+
+    const QString moved = QFileInfo(fileName).absoluteDir().filePath(QFileInfo(name).fileName());
+    QString error;
+
+    for (const QString &candidate : {name, moved}) {
+        parent.reset(new DBackupImage());
+        parent->d_ptr->depth = depth + 1;
+
+        if (!parent->open(candidate)) {
+            error = parent->errorString();
+        } else if (parent->id() != header.parentId || parent->chunkSize() != chunkSize()) {
+            error = QStringLiteral("%1 isn't the parent image").arg(candidate);
+        } else {
+            return true;
+        }
+
+        if (moved == name)
+            break;
+    }
+
+    parent.reset();
+    fail(QStringLiteral("Parent image: %1").arg(error));
+
+    return false;
+}
+
+bool DBackupImagePrivate::readChunk(quint64 i, uchar *data)
+{
+    const DBackupFormat::IndexEntry &entry = index[static_cast<size_t>(i)];
+    const size_t length = static_cast<size_t>(chunkLength(i));
+
+    switch (entry.type) {
+    case DBackupFormat::ZeroChunk:
+        memset(data, 0, length);
+        return true;
+    case DBackupFormat::ParentChunk:
+        // checked by the parent
+        if (parent->d_ptr->readChunk(i, data))
+            return true;
+
+        fail(parent->errorString());
+        return false;
+    case DBackupFormat::StoredChunk:
+        if (!DBlockIO::readAll(fd, data, length, entry.offset)) {
+            failWithErrno(QStringLiteral("Read chunk %1").arg(i));
+            return false;
+        }
+
+        return checkHash(i, data);
+    default:
+        break;
+    }
+
+    buffer.resize(entry.storedSize);
+
+    if (!DBlockIO::readAll(fd, buffer.data(), buffer.size(), entry.offset)) {
+        failWithErrno(QStringLiteral("Read chunk %1").arg(i));
+        return false;
+    }
+
+    if (!context)
+        context = ZSTD_createDCtx();
+
+    if (!context) {
+        fail(QString::fromLocal8Bit(strerror(ENOMEM)));
+        return false;
+    }
+
+    const size_t n = ZSTD_decompressDCtx(context, data, length, buffer.data(), buffer.size());
+
+    if (ZSTD_isError(n) || n != length) {
+        fail(QStringLiteral("Decompress chunk %1: %2").arg(i).arg(ZSTD_isError(n) ? ZSTD_getErrorName(n) : "Wrong size"));
+        return false;
+    }
+
+    return checkHash(i, data);
+}
+
+// the hash of the manifest is also the checksum of the data read
+bool DBackupImagePrivate::checkHash(quint64 i, const uchar *data)
+{
+    const quint64 hash = index[static_cast<size_t>(i)].hash;
+
+    if (DXXHash64::hash(data, static_cast<size_t>(chunkLength(i))) != hash) {
+        fail(QStringLiteral("The chunk %1 is corrupted").arg(i));
+        return false;
+    }
+
+    return true;
+}
+
+int DBackupImagePrivate::chunkSize() const
+{
+    return static_cast<int>(header.chunkSize);
+}
+
+quint64 DBackupImagePrivate::chunkLength(quint64 i) const
+{
+    const quint64 offset = i * header.chunkSize;
+
+    return offset < header.size ? qMin<quint64>(header.chunkSize, header.size - offset) : 0;
+}
+
+void DBackupImagePrivate::fail(const QString &message)
+{
+    errorString = message;
+}
+
+void DBackupImagePrivate::failWithErrno(const QString &what)
+{
+    fail(QStringLiteral("%1: %2").arg(what, QString::fromLocal8Bit(strerror(errno))));
+}
+
+/*!
+ * \class DBackupImage
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief Reads a backup image written by DBackupWriter.
+ *
+ * open() reads and checks the index only. Every chunk is an independent zstd
+ * frame at the place given by the index, so readChunk() and read() decompress
+ * only the chunks they need; restore() writes the whole source back. Each
+ * chunk read is checked against its hash in the index.
+ *
+ * An incremental image opens its parent, found by the id written in it, and
+ * reads the unchanged chunks from there, up to the full image of the chain.
+ *
+ * Not thread safe: the chunks are decompressed with one context.
+ */
+
+DBackupImage::DBackupImage(const QString &fileName)
+    : d_ptr(new DBackupImagePrivate())
+{
+    if (!fileName.isEmpty())
+        open(fileName);
+}
+
+DBackupImage::~DBackupImage()
+{
+
+}
+
+bool DBackupImage::open(const QString &fileName)
+{
+    Q_D(DBackupImage);
+
+    close();
+
+    d->fd = ::open(fileName.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+
+    if (d->fd < 0) {
+        d->failWithErrno(QStringLiteral("Open"));
+        return false;
+    }
+
+    d->fileName = fileName;
+
+    if (!d->readIndex()) {
+        const QString error = d->errorString;
+
+        close();
+        d->errorString = error;
+
+        return false;
+    }
+
+    return true;
+}
+
+void DBackupImage::close()
+{
+    Q_D(DBackupImage);
+
+    if (d->fd >= 0)
+        ::close(d->fd);
+
+    d->fd = -1;
+    d->fileName.clear();
+    d->header = DBackupFormat::Header();
+    d->index.clear();
+    d->storedSize = 0;
+    d->parent.reset();
+    d->errorString.clear();
+}
+
+bool DBackupImage::isOpen() const
+{
+    Q_D(const DBackupImage);
+
+    return d->fd >= 0;
+}
+
+QString DBackupImage::fileName() const
+{
+    Q_D(const DBackupImage);
+
+    return d->fileName;
+}
+
+quint64 DBackupImage::size() const
+{
+    Q_D(const DBackupImage);
+
+    return d->header.size;
+}
+
+int DBackupImage::chunkSize() const
+{
+    Q_D(const DBackupImage);
+
+    return static_cast<int>(d->header.chunkSize);
+}
+
+quint64 DBackupImage::chunkCount() const
+{
+    Q_D(const DBackupImage);
+
+    return d->index.size();
+}
+
+QDateTime DBackupImage::created() const
+{
+    Q_D(const DBackupImage);
+
+    return isOpen() ? QDateTime::fromMSecsSinceEpoch(d->header.created) : QDateTime();
+}
+
+quint64 DBackupImage::storedSize() const
+{
+    Q_D(const DBackupImage);
+
+    return d->storedSize;
+}
+
+quint64 DBackupImage::id() const
+{
+    Q_D(const DBackupImage);
+
+    return d->header.id;
+}
+
+bool DBackupImage::isIncremental() const
+{
+    Q_D(const DBackupImage);
+
+    return !d->parent.isNull();
+}
+
+QString DBackupImage::parentFileName() const
+{
+    Q_D(const DBackupImage);
+
+    return d->parent ? d->parent->fileName() : QString();
+}
+
+DBackupImage::ChunkType DBackupImage::chunkType(quint64 index) const
+{
+    Q_D(const DBackupImage);
+
+    if (index >= d->index.size())
+        return ZeroChunk;
+
+    return static_cast<ChunkType>(d->index[static_cast<size_t>(index)].type);
+}
+
+quint64 DBackupImage::chunkLength(quint64 index) const
+{
+    Q_D(const DBackupImage);
+
+    return d->chunkLength(index);
+}
+
+quint64 DBackupImage::chunkStoredSize(quint64 index) const
+{
+    Q_D(const DBackupImage);
+
+    if (index >= d->index.size())
+        return 0;
+
+    return d->index[static_cast<size_t>(index)].storedSize;
+}
+
+quint64 DBackupImage::chunkHash(quint64 index) const
+{
+    Q_D(const DBackupImage);
+
+    if (index >= d->index.size())
+        return 0;
+
+    return d->index[static_cast<size_t>(index)].hash;
+}
+
+QByteArray DBackupImage::readChunk(quint64 index)
+{
+    Q_D(DBackupImage);
+
+    if (index >= d->index.size()) {
+        d->fail(QStringLiteral("No chunk %1").arg(index));
+        return QByteArray();
+    }
+
+    QByteArray data(static_cast<int>(d->chunkLength(index)), Qt::Uninitialized);
+
+    if (!d->readChunk(index, reinterpret_cast<uchar *>(data.data())))
+        return QByteArray();
+
+    return data;
+}
+
+QByteArray DBackupImage::read(quint64 offset, quint64 length)
+{
+    Q_D(DBackupImage);
+
+    if (!isOpen() || offset >= d->header.size)
+        return QByteArray();
+
+    length = qMin(length, d->header.size - offset);
+
+    // a QByteArray holds less than 2 GiB
+    if (length > static_cast<quint64>(std::numeric_limits<int>::max() - 1)) {
+        d->fail(QStringLiteral("Too much data to read at once"));
+        return QByteArray();
+    }
+
+    const quint64 chunk = d->header.chunkSize;
+    QByteArray data(static_cast<int>(length), Qt::Uninitialized);
+    std::vector<uchar> decompressed(static_cast<size_t>(chunk));
+    quint64 done = 0;
+
+    while (done < length) {
+        const quint64 position = offset + done;
+        const quint64 i = position / chunk;
+        const quint64 skip = position % chunk;
+        const quint64 count = qMin(length - done, d->chunkLength(i) - skip);
+
+        if (!d->readChunk(i, decompressed.data()))
+            return QByteArray();
+
+        memcpy(data.data() + done, decompressed.data() + skip, static_cast<size_t>(count));
+        done += count;
+    }
+
+    return data;
+}
+
+/*!
+ * \brief Writes the source of the image to \a fd, from its start.
+ *
+ * With \a sparse the zero chunks are not written: \a fd must read zeros there
+ * already, like a new file or a device that was discarded.
+ */
+bool DBackupImage::restore(int fd, bool sparse)
+{
+    Q_D(DBackupImage);
+
+    if (!isOpen()) {
+        d->fail(QStringLiteral("No image is open"));
+        return false;
+    }
+
+    DBlockIO::AlignedBuffer data(d->header.chunkSize);
+
+    if (!data.get()) {
+        d->fail(QString::fromLocal8Bit(strerror(ENOMEM)));
+        return false;
+    }
+
+    for (quint64 i = 0; i < d->index.size(); ++i) {
+        if (sparse && d->index[static_cast<size_t>(i)].type == DBackupFormat::ZeroChunk)
+            continue;
+
+        if (!d->readChunk(i, data.get()))
+            return false;
+
+        if (!DBlockIO::writeAll(fd, data.get(), static_cast<size_t>(d->chunkLength(i)), i * d->header.chunkSize)) {
+            d->failWithErrno(QStringLiteral("Write chunk %1").arg(i));
+            return false;
+        }
+    }
+
+    struct stat st;
+
+    // the zeros at the end of a file are still part of it
+    if (sparse && ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)
+            && static_cast<quint64>(st.st_size) < d->header.size
+            && ::ftruncate(fd, static_cast<off_t>(d->header.size)) < 0) {
+        d->failWithErrno(QStringLiteral("Truncate"));
+        return false;
+    }
+
+    if (::fdatasync(fd) < 0) {
+        d->failWithErrno(QStringLiteral("Sync"));
+        return false;
+    }
+
+    return true;
+}
+
+QString DBackupImage::errorString() const
+{
+    Q_D(const DBackupImage);
+
+    return d->errorString;
+}
@@ -0,0 +1,70 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DBACKUPIMAGE_H
+#define DBACKUPIMAGE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QScopedPointer>
+#include <QString>
+
+class DBackupImagePrivate;
+class DBackupImage
+{
+    Q_DECLARE_PRIVATE(DBackupImage)
+
+public:
+    enum ChunkType {
+        ZeroChunk, // only zeros, nothing stored
+        CompressedChunk,
+        StoredChunk, // kept as is, it didn't compress
+        ParentChunk // unchanged since the parent image, read from it
+    };
+
+    explicit DBackupImage(const QString &fileName = QString());
+    ~DBackupImage();
+
+    // reads the header and the index, the chunks are read on demand;
+    // the parents of an incremental image are opened too
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const;
+    QString fileName() const;
+
+    quint64 size() const; // of the source
+    int chunkSize() const;
+    quint64 chunkCount() const;
+    QDateTime created() const;
+    // bytes of the chunks in this image, without its parents
+    quint64 storedSize() const;
+    // random, never 0
+    quint64 id() const;
+    bool isIncremental() const;
+    // where the parent was found, it may have moved along with this image
+    QString parentFileName() const;
+
+    ChunkType chunkType(quint64 index) const;
+    // chunkSize() except for the last chunk
+    quint64 chunkLength(quint64 index) const;
+    quint64 chunkStoredSize(quint64 index) const;
+    // XXH64 of the data of the chunk
+    quint64 chunkHash(quint64 index) const;
+
+    // the data of the chunk, decompressed alone; empty on error
+    QByteArray readChunk(quint64 index);
+    // length bytes of the source from offset, from the chunks they cross
+    QByteArray read(quint64 offset, quint64 length);
+    // the whole source to fd from its start, zero chunks are skipped if sparse
+    bool restore(int fd, bool sparse = false);
+
+    QString errorString() const;
+
+private:
+    QScopedPointer<DBackupImagePrivate> d_ptr;
+
+    Q_DISABLE_COPY(DBackupImage)
+};
+
+#endif // DBACKUPIMAGE_H
@@ -0,0 +1,691 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dbackupwriter.h"
+#include "dbackupimage.h"
+#include "ddiskmanager.h"
+#include "dblockdevice.h"
+#include "private/dblockio_p.h"
+#include "private/dbackupformat_p.h"
+#include "private/dmemcompare_p.h"
+#include "private/dxxhash64_p.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QThread>
+#include <QTimer>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+
+#include <zstd.h>
+
+class DBackupWriterPrivate
+{
+public:
+    explicit DBackupWriterPrivate(DBackupWriter *qq)
+        : q_ptr(qq)
+    {
+
+    }
+
+    ~DBackupWriterPrivate();
+
+    // in the threads of the backup
+    void run();
+    void work();
+    bool writeIndex();
+    void setError(const char *what);
+
+    bool loadBase(int imageFd);
+
+    void poll();
+    void reset();
+    void closeFiles();
+
+    int threads = 0;
+    int chunkSize = 4 * 1024 * 1024;
+    int compressionLevel = 3;
+    QString baseImage;
+
+    int sourceFd = -1;
+    int imageFd = -1;
+    quint64 size = 0;
+    DBackupFormat::Header header;
+    // one entry per chunk, each is written by the worker of its chunk only
+    std::vector<DBackupFormat::IndexEntry> index;
+    // the manifest of the base image: the hash of every chunk, 0 if unknown
+    std::vector<quint64> baseHashes;
+    quint64 baseSize = 0;
+    QByteArray baseFileName; // absolute, UTF-8
+    std::thread thread;
+    std::atomic<bool> running {false};
+    std::atomic<bool> done {false};
+    std::atomic<bool> cancelled {false};
+    std::atomic<quint64> next {0};
+    // where the next stored chunk goes in the image
+    std::atomic<quint64> end {0};
+    std::atomic<quint64> bytesRead {0};
+    std::atomic<quint64> written {0};
+    std::atomic<quint64> zeroChunks {0};
+    std::atomic<quint64> unchangedChunks {0};
+    std::atomic<int> error {0};
+    QString errorPrefix; // what failed with error
+    // set by the thread of the backup before done, read after it was joined
+    QString errorString;
+
+    QTimer timer;
+    QElapsedTimer clock;
+    quint64 lastRead = 0;
+    qint64 lastTime = 0;
+    double throughput = 0;
+
+    DBackupWriter *q_ptr;
+
+    Q_DECLARE_PUBLIC(DBackupWriter)
+};
+
+DBackupWriterPrivate::~DBackupWriterPrivate()
+{
+    cancelled = true;
+
+    if (thread.joinable())
+        thread.join();
+
+    closeFiles();
+}
+
+void DBackupWriterPrivate::run()
+{
+    const int count = threads > 0 ? threads : qBound(1, QThread::idealThreadCount(), 16);
+    std::vector<std::thread> workers;
+
+    for (int i = 1; i < count; ++i) {
+        workers.emplace_back(&DBackupWriterPrivate::work, this);
+    }
+
+    work();
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    if (error == 0 && !cancelled)
+        writeIndex();
+
+    if (error != 0) {
+        errorString = QStringLiteral("%1: %2").arg(errorPrefix, QString::fromLocal8Bit(strerror(error)));
+    } else if (cancelled) {
+        errorString = QStringLiteral("Cancelled");
+    }
+
+    done = true;
+}
+
+// Each worker reads a whole chunk, hashes it, compresses it as one frame if it changed
+// since the base image and appends it to the image at the offset it reserved, so the
+// chunks are written in any order without lock
+void DBackupWriterPrivate::work()
+{
+    DBlockIO::AlignedBuffer source(header.chunkSize);
+    std::vector<uchar> compressed(ZSTD_compressBound(header.chunkSize));
+    ZSTD_CCtx *context = ZSTD_createCCtx();
+
+    if (!source.get() || !context) {
+        errno = ENOMEM;
+        setError("Allocate");
+        ZSTD_freeCCtx(context);
+        return;
+    }
+
+    const quint64 chunk = header.chunkSize;
+
+    while (!cancelled && error == 0) {
+        const quint64 i = next++;
+
+        if (i >= index.size())
+            break;
+
+        const quint64 offset = i * chunk;
+        const size_t length = static_cast<size_t>(qMin(chunk, size - offset));
+
+        if (!DBlockIO::readAll(sourceFd, source.get(), length, offset)) {
+            setError("Read");
+            break;
+        }
+
+        DBackupFormat::IndexEntry &entry = index[static_cast<size_t>(i)];
+
+        // kept for every chunk, the index is the manifest of the next incremental backup
+        entry.hash = DXXHash64::hash(source.get(), length);
+
+        // free space and never written areas cost nothing
+        if (DMemCompare::firstNonZero(source.get(), length) == length) {
+            entry.type = DBackupFormat::ZeroChunk;
+            bytesRead += length;
+            ++zeroChunks;
+            continue;
+        }
+
+        // the last chunk of the base may be shorter if the source grew
+        if (i < baseHashes.size() && baseHashes[i] == entry.hash
+                && qMin(chunk, baseSize - offset) == length) {
+            entry.type = DBackupFormat::ParentChunk;
+            bytesRead += length;
+            ++unchangedChunks;
+            continue;
+        }
+
+        const uchar *data = compressed.data();
+        size_t stored = ZSTD_compressCCtx(context, compressed.data(), compressed.size(),
+                                          source.get(), length, compressionLevel);
+
+        entry.type = DBackupFormat::CompressedChunk;
+
+        // encrypted or already compressed data is kept as is
+        if (ZSTD_isError(stored) || stored >= length) {
+            data = source.get();
+            stored = length;
+            entry.type = DBackupFormat::StoredChunk;
+        }
+
+        entry.offset = end.fetch_add(stored);
+        entry.storedSize = static_cast<quint32>(stored);
+
+        if (!DBlockIO::writeAll(imageFd, data, stored, entry.offset)) {
+            setError("Write");
+            break;
+        }
+
+        bytesRead += length;
+        written += stored;
+    }
+
+    ZSTD_freeCCtx(context);
+}
+
+// The index and the name of the parent follow the chunks, then the header gets their
+// offset: an image interrupted before has an index offset of 0 and isn't opened by DBackupImage
+bool DBackupWriterPrivate::writeIndex()
+{
+    const size_t entrySize = DBackupFormat::IndexEntrySize;
+    std::vector<uchar> data(index.size() * entrySize + 4 + static_cast<size_t>(baseFileName.size()));
+    uchar *parent = data.data() + index.size() * entrySize;
+
+    for (size_t i = 0; i < index.size(); ++i) {
+        DBackupFormat::encodeIndexEntry(index[i], data.data() + i * entrySize);
+    }
+
+    qToLittleEndian<quint32>(static_cast<quint32>(baseFileName.size()), parent);
+    memcpy(parent + 4, baseFileName.constData(), static_cast<size_t>(baseFileName.size()));
+
+    header.indexOffset = end;
+
+    if (!DBlockIO::writeAll(imageFd, data.data(), data.size(), header.indexOffset)
+            || ::ftruncate(imageFd, static_cast<off_t>(header.indexOffset + data.size())) < 0
+            || ::fdatasync(imageFd) < 0) {
+        setError("Write index");
+        return false;
+    }
+
+    uchar encoded[DBackupFormat::HeaderSize];
+
+    DBackupFormat::encodeHeader(header, encoded);
+
+    if (!DBlockIO::writeAll(imageFd, encoded, sizeof(encoded), 0) || ::fdatasync(imageFd) < 0) {
+        setError("Write header");
+        return false;
+    }
+
+    written += data.size() + sizeof(encoded);
+
+    return true;
+}
+
+// the first error of the workers is kept, errno is its code
+void DBackupWriterPrivate::setError(const char *what)
+{
+    int expected = 0;
+
+    if (error.compare_exchange_strong(expected, errno != 0 ? errno : EIO))
+        errorPrefix = QString::fromLatin1(what);
+}
+
+// The hashes of the base are all that is read from it, its chunks are never decompressed
+bool DBackupWriterPrivate::loadBase(int imageFd)
+{
+    if (baseImage.isEmpty())
+        return true;
+
+    struct stat image;
+    struct stat st;
+
+    // the image is truncated once the base was read
+    if (::fstat(imageFd, &image) == 0 && ::stat(baseImage.toLocal8Bit().constData(), &st) == 0
+            && image.st_dev == st.st_dev && image.st_ino == st.st_ino) {
+        errorString = QStringLiteral("The image would overwrite its base image");
+        return false;
+    }
+
+    DBackupImage base(baseImage);
+
+    if (!base.isOpen()) {
+        errorString = QStringLiteral("Base image: %1").arg(base.errorString());
+        return false;
+    }
+
+    baseHashes.resize(static_cast<size_t>(base.chunkCount()));
+
+    for (quint64 i = 0; i < base.chunkCount(); ++i) {
+        baseHashes[static_cast<size_t>(i)] = base.chunkHash(i);
+    }
+
+    baseSize = base.size();
+    baseFileName = QFileInfo(baseImage).absoluteFilePath().toUtf8();
+    header.chunkSize = static_cast<quint32>(base.chunkSize());
+    header.parentId = base.id();
+
+    return true;
+}
+
+void DBackupWriterPrivate::poll()
+{
+    Q_Q(DBackupWriter);
+
+    // read first, what the backup did before it was over is reported below
+    const bool over = done;
+    const qint64 now = clock.elapsed();
+    const quint64 bytes = bytesRead;
+
+    if (now > lastTime) {
+        const double instant = (bytes - lastRead) * 1000.0 / (now - lastTime);
+
+        throughput = lastTime == 0 ? instant : throughput * 0.5 + instant * 0.5;
+        lastRead = bytes;
+        lastTime = now;
+    }
+
+    Q_EMIT q->progressChanged(size > 0 ? static_cast<double>(bytes) / size : 1.0, throughput);
+
+    if (!over)
+        return;
+
+    timer.stop();
+    thread.join();
+    closeFiles();
+    running = false;
+
+    Q_EMIT q->finished(errorString.isEmpty());
+}
+
+void DBackupWriterPrivate::reset()
+{
+    header = DBackupFormat::Header();
+    index.clear();
+    baseHashes.clear();
+    baseSize = 0;
+    baseFileName.clear();
+    done = false;
+    cancelled = false;
+    next = 0;
+    end = DBackupFormat::HeaderSize;
+    bytesRead = 0;
+    written = 0;
+    zeroChunks = 0;
+    unchangedChunks = 0;
+    error = 0;
+    errorPrefix.clear();
+    errorString.clear();
+    lastRead = 0;
+    lastTime = 0;
+    throughput = 0;
+}
+
+void DBackupWriterPrivate::closeFiles()
+{
+    if (sourceFd >= 0)
+        ::close(sourceFd);
+
+    if (imageFd >= 0)
+        ::close(imageFd);
+
+    sourceFd = -1;
+    imageFd = -1;
+}
+
+/*!
+ * \class DBackupWriter
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief Writes a compressed backup image of a block device or of a file.
+ *
+ * The source is split into chunks of chunkSize() bytes, compressed by threads()
+ * workers as independent zstd frames. The chunks of zeros are only marked in
+ * the index and those that don't compress are stored as is. The index at the
+ * end of the image gives the place of every chunk, so DBackupImage reads any
+ * of them without decompressing the others.
+ *
+ * The index also holds the XXH64 of every chunk. With a baseImage() the hashes
+ * of the chunks read are compared with those of the base, and the chunks
+ * which didn't change are only marked as found in the parent: a nightly
+ * backup of a disk mostly static writes a few chunks and its index. The
+ * source is still read whole, the hashes are computed in the workers. Every
+ * image of the chain is needed to read or restore the last one.
+ *
+ * The backup runs in its own threads, progressChanged() is emitted by a timer
+ * in the thread of the writer, then finished().
+ */
+
+DBackupWriter::DBackupWriter(QObject *parent)
+    : QObject(parent)
+    , d_ptr(new DBackupWriterPrivate(this))
+{
+    Q_D(DBackupWriter);
+
+    d->timer.setInterval(500);
+    connect(&d->timer, &QTimer::timeout, this, [d] {
+        d->poll();
+    });
+}
+
+DBackupWriter::~DBackupWriter()
+{
+
+}
+
+int DBackupWriter::threads() const
+{
+    Q_D(const DBackupWriter);
+
+    return d->threads;
+}
+
+int DBackupWriter::chunkSize() const
+{
+    Q_D(const DBackupWriter);
+
+    return d->chunkSize;
+}
+
+int DBackupWriter::compressionLevel() const
+{
+    Q_D(const DBackupWriter);
+
+    return d->compressionLevel;
+}
+
+QString DBackupWriter::baseImage() const
+{
+    Q_D(const DBackupWriter);
+
+    return d->baseImage;
+}
+
+bool DBackupWriter::isRunning() const
+{
+    Q_D(const DBackupWriter);
+
+    return d->running;
+}
+
+bool DBackupWriter::backupBlockDevice(const QString &blockDevicePath, const QString &imageFileName, const QDBusConnection &connection)
+{
+    Q_D(DBackupWriter);
+
+    if (d->running) {
+        d->errorString = QStringLiteral("A backup is running");
+        return false;
+    }
+
+    QScopedPointer<DBlockDevice> device(DDiskManager::createBlockDevice(blockDevicePath, connection));
+    const QDBusUnixFileDescriptor &fd = device->openForBackup({});
+
+    if (!fd.isValid()) {
+        d->errorString = device->lastError().message();
+        return false;
+    }
+
+    // the image holds all the data of the device, only its owner reads it;
+    // backup() truncates it, once it has checked that it isn't the base image
+    const int image = ::open(imageFileName.toLocal8Bit().constData(), O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+
+    if (image < 0) {
+        d->errorString = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+
+    const bool ok = backup(fd.fileDescriptor(), image);
+
+    ::close(image);
+
+    return ok;
+}
+
+bool DBackupWriter::backupFile(const QString &fileName, const QString &imageFileName)
+{
+    Q_D(DBackupWriter);
+
+    if (d->running) {
+        d->errorString = QStringLiteral("A backup is running");
+        return false;
+    }
+
+    const int source = ::open(fileName.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+
+    if (source < 0) {
+        d->errorString = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+
+    const int image = ::open(imageFileName.toLocal8Bit().constData(), O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+
+    if (image < 0) {
+        d->errorString = QString::fromLocal8Bit(strerror(errno));
+        ::close(source);
+        return false;
+    }
+
+    const bool ok = backup(source, image);
+
+    ::close(source);
+    ::close(image);
+
+    return ok;
+}
+
+bool DBackupWriter::backup(int sourceFd, int imageFd)
+{
+    Q_D(DBackupWriter);
+
+    if (d->running) {
+        d->errorString = QStringLiteral("A backup is running");
+        return false;
+    }
+
+    d->reset();
+
+    struct stat st;
+
+    if (::fstat(sourceFd, &st) < 0) {
+        d->errorString = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+
+    if (S_ISBLK(st.st_mode)) {
+        uint64_t size = 0;
+
+        if (::ioctl(sourceFd, BLKGETSIZE64, &size) < 0) {
+            d->errorString = QString::fromLocal8Bit(strerror(errno));
+            return false;
+        }
+
+        d->size = size;
+    } else if (S_ISREG(st.st_mode)) {
+        d->size = static_cast<quint64>(st.st_size);
+    } else {
+        d->errorString = QStringLiteral("Not a block device nor a regular file");
+        return false;
+    }
+
+    d->header.chunkSize = static_cast<quint32>(d->chunkSize);
+
+    if (!d->loadBase(imageFd))
+        return false;
+
+    const quint64 chunk = d->header.chunkSize;
+    std::random_device random;
+
+    d->header.size = d->size;
+    d->header.chunkCount = (d->size + chunk - 1) / chunk;
+    d->header.created = QDateTime::currentMSecsSinceEpoch();
+    // never 0, the images based on this one check they found their parent with it
+    d->header.id = ((static_cast<quint64>(random()) << 32) | random()) | 1;
+    d->index.resize(static_cast<size_t>(d->header.chunkCount));
+
+    // a device is read once, it would only evict the page cache of the system
+    d->sourceFd = S_ISBLK(st.st_mode) ? DBlockIO::openDirect(sourceFd) : -1;
+
+    if (d->sourceFd < 0)
+        d->sourceFd = ::fcntl(sourceFd, F_DUPFD_CLOEXEC, 0);
+
+    d->imageFd = ::fcntl(imageFd, F_DUPFD_CLOEXEC, 0);
+
+    if (d->sourceFd < 0 || d->imageFd < 0) {
+        d->errorString = QString::fromLocal8Bit(strerror(errno));
+        d->closeFiles();
+        return false;
+    }
+
+    // the header without index marks the image as incomplete until the end
+    uchar encoded[DBackupFormat::HeaderSize];
+
+    DBackupFormat::encodeHeader(d->header, encoded);
+
+    if (::ftruncate(d->imageFd, 0) < 0 || !DBlockIO::writeAll(d->imageFd, encoded, sizeof(encoded), 0)) {
+        d->errorString = QString::fromLocal8Bit(strerror(errno));
+        d->closeFiles();
+        return false;
+    }
+
+    if (!S_ISBLK(st.st_mode))
+        ::posix_fadvise(d->sourceFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    d->running = true;
+    d->clock.start();
+    d->thread = std::thread(&DBackupWriterPrivate::run, d);
+    d->timer.start();
+
+    return true;
+}
+
+quint64 DBackupWriter::size() const
+{
+    Q_D(const DBackupWriter);
+
+    return d->size;
+}
+
+quint64 DBackupWriter::bytesRead() const
+{
+    Q_D(const DBackupWriter);
+
+    return d->bytesRead;
+}
+
+quint64 DBackupWriter::bytesWritten() const
+{
+    Q_D(const DBackupWriter);
+
+    return d->written;
+}
+
+quint64 DBackupWriter::zeroChunks() const
+{
+    Q_D(const DBackupWriter);
+
+    return d->zeroChunks;
+}
+
+quint64 DBackupWriter::unchangedChunks() const
+{
+    Q_D(const DBackupWriter);
+
+    return d->unchangedChunks;
+}
+
+double DBackupWriter::throughput() const
+{
+    Q_D(const DBackupWriter);
+
+    return d->throughput;
+}
+
+/*!
+ * \brief The error of the last backup, valid once it has finished.
+ */
+QString DBackupWriter::errorString() const
+{
+    Q_D(const DBackupWriter);
+
+    return d->running ? QString() : d->errorString;
+}
+
+void DBackupWriter::setThreads(int threads)
+{
+    Q_D(DBackupWriter);
+
+    if (!d->running)
+        d->threads = qBound(0, threads, 16);
+}
+
+void DBackupWriter::setChunkSize(int chunkSize)
+{
+    Q_D(DBackupWriter);
+
+    // a multiple of 4 KiB, from 64 KiB to 64 MiB
+    if (!d->running) {
+        const int size = qBound(static_cast<int>(DBackupFormat::MinChunkSize), chunkSize, static_cast<int>(DBackupFormat::MaxChunkSize));
+
+        d->chunkSize = size / static_cast<int>(DBackupFormat::ChunkSizeAlignment) * static_cast<int>(DBackupFormat::ChunkSizeAlignment);
+    }
+}
+
+void DBackupWriter::setCompressionLevel(int level)
+{
+    Q_D(DBackupWriter);
+
+    if (!d->running)
+        d->compressionLevel = qBound(1, level, 19);
+}
+
+void DBackupWriter::setBaseImage(const QString &fileName)
+{
+    Q_D(DBackupWriter);
+
+    if (!d->running)
+        d->baseImage = fileName;
+}
+
+/*!
+ * \brief Stops the backup after the chunks being compressed, finished() is emitted with false.
+ *
+ * The image is left without index, DBackupImage doesn't open it.
+ */
+void DBackupWriter::cancel()
+{
+    Q_D(DBackupWriter);
+
+    d->cancelled = true;
+}
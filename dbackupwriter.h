@@ -0,0 +1,71 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DBACKUPWRITER_H
+#define DBACKUPWRITER_H
+
+#include <QObject>
+#include <QDBusConnection>
+
+class DBackupWriterPrivate;
+class DBackupWriter : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(DBackupWriter)
+
+    Q_PROPERTY(int threads READ threads WRITE setThreads)
+    Q_PROPERTY(int chunkSize READ chunkSize WRITE setChunkSize)
+    Q_PROPERTY(int compressionLevel READ compressionLevel WRITE setCompressionLevel)
+    Q_PROPERTY(QString baseImage READ baseImage WRITE setBaseImage)
+    Q_PROPERTY(bool running READ isRunning)
+
+public:
+    explicit DBackupWriter(QObject *parent = nullptr);
+    // a running backup is cancelled
+    ~DBackupWriter();
+
+    // 0 for one thread per CPU, up to 16
+    int threads() const;
+    // bytes of the source compressed as one frame, the unit read back by DBackupImage;
+    // an incremental backup uses the one of its base image
+    int chunkSize() const;
+    // zstd level, 1 to 19
+    int compressionLevel() const;
+    // an image of the same source written before, only the chunks changed since are
+    // stored and the new image refers to it for the others; empty for a full backup
+    QString baseImage() const;
+    bool isRunning() const;
+
+    // the block device is opened by Block.OpenForBackup, no privilege is needed
+    bool backupBlockDevice(const QString &blockDevicePath, const QString &imageFileName,
+                           const QDBusConnection &connection = QDBusConnection::systemBus());
+    bool backupFile(const QString &fileName, const QString &imageFileName);
+    // both are duplicated, the image is written from its start and truncated
+    bool backup(int sourceFd, int imageFd);
+
+    quint64 size() const;
+    quint64 bytesRead() const;
+    quint64 bytesWritten() const; // to the image
+    quint64 zeroChunks() const;
+    quint64 unchangedChunks() const; // referring to the base image
+    double throughput() const; // bytes of the source per second
+    QString errorString() const;
+
+public Q_SLOTS:
+    void setThreads(int threads);
+    void setChunkSize(int chunkSize);
+    void setCompressionLevel(int level);
+    void setBaseImage(const QString &fileName);
+
+    void cancel();
+
+Q_SIGNALS:
+    void progressChanged(double progress, double bytesPerSecond);
+    void finished(bool success);
+
+private:
+    QScopedPointer<DBackupWriterPrivate> d_ptr;
+};
+
+#endif // DBACKUPWRITER_H
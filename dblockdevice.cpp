@@ -3,16 +3,194 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "dblockdevice.h"
+#include "dblockpartition.h"
 #include "private/dblockdevice_p.h"
+#include "private/dpropertiesdispatcher_p.h"
 #include "udisks2_interface.h"
 #include "objectmanager_interface.h"
 
+#include <QDBusServiceWatcher>
+#include <QMetaProperty>
+
+namespace {
+struct PropertyEntry
+{
+    const char *interface; // without the UDISKS2_SERVICE prefix
+    const char *name;
+    DBlockDevice::PropertyId id;
+    const char *qtProperty; // the Q_PROPERTY whose NOTIFY signal is emitted
+    const QMetaObject *metaObject;
+};
+}
+
+static const PropertyEntry propertyEntries[] = {
+    {".Block", "Configuration", DBlockDevice::ConfigurationProperty, "configuration", &DBlockDevice::staticMetaObject},
+    {".Block", "CryptoBackingDevice", DBlockDevice::CryptoBackingDeviceProperty, "cryptoBackingDevice", &DBlockDevice::staticMetaObject},
+    {".Block", "Device", DBlockDevice::DeviceProperty, nullptr, nullptr},
+    {".Block", "DeviceNumber", DBlockDevice::DeviceNumberProperty, nullptr, nullptr},
+    {".Block", "Drive", DBlockDevice::DriveProperty, nullptr, nullptr},
+    {".Block", "HintAuto", DBlockDevice::HintAutoProperty, "hintAuto", &DBlockDevice::staticMetaObject},
+    {".Block", "HintIconName", DBlockDevice::HintIconNameProperty, "hintIconName", &DBlockDevice::staticMetaObject},
+    {".Block", "HintIgnore", DBlockDevice::HintIgnoreProperty, "hintIgnore", &DBlockDevice::staticMetaObject},
+    {".Block", "HintName", DBlockDevice::HintNameProperty, "hintName", &DBlockDevice::staticMetaObject},
+    {".Block", "HintPartitionable", DBlockDevice::HintPartitionableProperty, "hintPartitionable", &DBlockDevice::staticMetaObject},
+    {".Block", "HintSymbolicIconName", DBlockDevice::HintSymbolicIconNameProperty, "hintSymbolicIconName", &DBlockDevice::staticMetaObject},
+    {".Block", "HintSystem", DBlockDevice::HintSystemProperty, nullptr, nullptr},
+    {".Block", "Id", DBlockDevice::IdProperty, nullptr, nullptr},
+    {".Block", "IdLabel", DBlockDevice::IdLabelProperty, "idLabel", &DBlockDevice::staticMetaObject},
+    {".Block", "IdType", DBlockDevice::IdTypeProperty, "idType", &DBlockDevice::staticMetaObject},
+    {".Block", "IdUUID", DBlockDevice::IdUUIDProperty, "idUUID", &DBlockDevice::staticMetaObject},
+    {".Block", "IdUsage", DBlockDevice::IdUsageProperty, "idUsage", &DBlockDevice::staticMetaObject},
+    {".Block", "IdVersion", DBlockDevice::IdVersionProperty, "idVersion", &DBlockDevice::staticMetaObject},
+    {".Block", "MDRaid", DBlockDevice::MDRaidProperty, "mDRaid", &DBlockDevice::staticMetaObject},
+    {".Block", "MDRaidMember", DBlockDevice::MDRaidMemberProperty, "mDRaidMember", &DBlockDevice::staticMetaObject},
+    {".Block", "PreferredDevice", DBlockDevice::PreferredDeviceProperty, "preferredDevice", &DBlockDevice::staticMetaObject},
+    {".Block", "ReadOnly", DBlockDevice::ReadOnlyProperty, "readOnly", &DBlockDevice::staticMetaObject},
+    {".Block", "Size", DBlockDevice::SizeProperty, "size", &DBlockDevice::staticMetaObject},
+    {".Block", "Symlinks", DBlockDevice::SymlinksProperty, "symlinks", &DBlockDevice::staticMetaObject},
+    {".Block", "UserspaceMountOptions", DBlockDevice::UserspaceMountOptionsProperty, "userspaceMountOptions", &DBlockDevice::staticMetaObject},
+    {".Filesystem", "MountPoints", DBlockDevice::MountPointsProperty, "mountPoints", &DBlockDevice::staticMetaObject},
+    {".Filesystem", "Size", DBlockDevice::FileSystemSizeProperty, nullptr, nullptr},
+    {".PartitionTable", "Type", DBlockDevice::PTTypeProperty, "ptType", &DBlockDevice::staticMetaObject},
+    {".PartitionTable", "Partitions", DBlockDevice::PTPartitionsProperty, nullptr, nullptr},
+    {".Encrypted", "ChildConfiguration", DBlockDevice::ChildConfigurationProperty, "childConfiguration", &DBlockDevice::staticMetaObject},
+    {".Encrypted", "CleartextDevice", DBlockDevice::CleartextDeviceProperty, "cleartextDevice", &DBlockDevice::staticMetaObject},
+    {".Encrypted", "HintEncryptionType", DBlockDevice::HintEncryptionTypeProperty, nullptr, nullptr},
+    {".Encrypted", "MetadataSize", DBlockDevice::MetadataSizeProperty, nullptr, nullptr},
+    {".Partition", "Flags", DBlockDevice::PartitionFlagsProperty, "flags", &DBlockPartition::staticMetaObject},
+    {".Partition", "IsContained", DBlockDevice::PartitionIsContainedProperty, "isContained", &DBlockPartition::staticMetaObject},
+    {".Partition", "IsContainer", DBlockDevice::PartitionIsContainerProperty, "isContainer", &DBlockPartition::staticMetaObject},
+    {".Partition", "Name", DBlockDevice::PartitionNameProperty, "name", &DBlockPartition::staticMetaObject},
+    {".Partition", "Number", DBlockDevice::PartitionNumberProperty, "number", &DBlockPartition::staticMetaObject},
+    {".Partition", "Offset", DBlockDevice::PartitionOffsetProperty, "offset", &DBlockPartition::staticMetaObject},
+    {".Partition", "Size", DBlockDevice::PartitionSizeProperty, "size", &DBlockPartition::staticMetaObject},
+    {".Partition", "Table", DBlockDevice::PartitionTableProperty, nullptr, nullptr},
+    {".Partition", "Type", DBlockDevice::PartitionTypeProperty, "type", &DBlockPartition::staticMetaObject},
+    {".Partition", "UUID", DBlockDevice::PartitionUUIDProperty, "UUID", &DBlockPartition::staticMetaObject},
+};
+
+static const PropertyEntry *findPropertyEntry(const QString &interface, const QString &name)
+{
+    for (const PropertyEntry &entry : propertyEntries) {
+        if (interface.endsWith(QLatin1String(entry.interface)) && name == QLatin1String(entry.name))
+            return &entry;
+    }
+
+    return nullptr;
+}
+
 DBlockDevicePrivate::DBlockDevicePrivate(DBlockDevice *qq)
     : q_ptr(qq)
 {
 
 }
 
+DBlockDevice::FSType DBlockDevicePrivate::toFSType(const QString &idType)
+{
+    if (idType.isEmpty())
+        return DBlockDevice::InvalidFS;
+
+    if (idType == "hfs+")
+        return DBlockDevice::hfs_plus;
+
+    bool ok = false;
+    const QMetaEnum me = QMetaEnum::fromType<DBlockDevice::FSType>();
+
+    int value = me.keyToValue(idType.toLatin1().constData(), &ok);
+
+    if (!ok) {
+        return DBlockDevice::UnknowFS;
+    }
+
+    return static_cast<DBlockDevice::FSType>(value);
+}
+
+DBlockDevice::PTType DBlockDevicePrivate::toPTType(const QString &type)
+{
+    if (type.isEmpty()) {
+        return DBlockDevice::InvalidPT;
+    }
+
+    if (type == "dos") {
+        return DBlockDevice::MBR;
+    }
+
+    if (type == "gpt") {
+        return DBlockDevice::GPT;
+    }
+
+    return DBlockDevice::UnknowPT;
+}
+
+void DBlockDevicePrivate::applyProperties(const QString &interface, const QVariantMap &changed_properties,
+                                          const QStringList &invalidated_properties, QSet<DBlockDevice::PropertyId> *changed)
+{
+    Q_Q(DBlockDevice);
+
+    for (auto begin = changed_properties.constBegin(); begin != changed_properties.constEnd(); ++begin) {
+        const PropertyEntry *entry = findPropertyEntry(interface, begin.key());
+
+        if (!entry)
+            continue;
+
+        const QVariant &value = UDisks2::demarshal(begin.value());
+        auto cached = cache.find(entry->id);
+
+        if (cached != cache.end()) {
+            if (UDisks2::valueEquals(cached.value(), value))
+                continue;
+
+            cached.value() = value;
+        } else if (watchChanges) {
+            cache.insert(entry->id, value);
+        }
+
+        changed->insert(entry->id);
+
+        if (!entry->qtProperty || !q->metaObject()->inherits(entry->metaObject))
+            continue;
+
+        const QMetaObject *mo = entry->metaObject;
+        const QMetaProperty &mp = mo->property(mo->indexOfProperty(entry->qtProperty));
+
+        if (!mp.hasNotifySignal())
+            continue;
+
+        const QMetaMethod &signal = mp.notifySignal();
+
+        if (signal.parameterCount() == 0) {
+            signal.invoke(q);
+            continue;
+        }
+
+        QVariant argument = value;
+
+        if (argument.userType() != signal.parameterType(0) && !argument.convert(signal.parameterType(0)))
+            continue;
+
+        signal.invoke(q, QGenericArgument(signal.parameterTypes().first().constData(), argument.constData()));
+    }
+
+    for (const QString &name : invalidated_properties) {
+        const PropertyEntry *entry = findPropertyEntry(interface, name);
+
+        if (!entry)
+            continue;
+
+        // the new value isn't in the message, drop it so the next read fetches it again
+        cache.remove(entry->id);
+        changed->insert(entry->id);
+    }
+}
+
+void DBlockDevicePrivate::dropInterface(const QString &interface)
+{
+    for (const PropertyEntry &entry : propertyEntries) {
+        if (interface.endsWith(QLatin1String(entry.interface)))
+            cache.remove(entry.id);
+    }
+}
+
 void DBlockDevice::onInterfacesAdded(const QDBusObjectPath &object_path, const QMap<QString, QVariantMap> &interfaces_and_properties)
 {
     Q_D(DBlockDevice);
@@ -33,6 +211,28 @@ void DBlockDevice::onInterfacesAdded(const QDBusObjectPath &object_path, const Q
     if (interfaces_and_properties.contains(QStringLiteral(UDISKS2_SERVICE ".Encrypted"))) {
         Q_EMIT isEncryptedChanged(true);
     }
+
+    QSet<PropertyId> changed;
+
+    for (auto begin = interfaces_and_properties.constBegin(); begin != interfaces_and_properties.constEnd(); ++begin) {
+        d->applyProperties(begin.key(), begin.value(), QStringList(), &changed);
+    }
+
+    if (!changed.isEmpty()) {
+        Q_EMIT this->changed(changed);
+    }
+}
+
+// udisksd was restarted, the object path stays valid but the cached values may be stale
+void DBlockDevice::onServiceOwnerChanged(const QString &service, const QString &oldOwner, const QString &newOwner)
+{
+    Q_UNUSED(service)
+    Q_UNUSED(oldOwner)
+    Q_UNUSED(newOwner)
+
+    Q_D(DBlockDevice);
+
+    d->cache.clear();
 }
 
 void DBlockDevice::onInterfacesRemoved(const QDBusObjectPath &object_path, const QStringList &interfaces)
@@ -45,6 +245,8 @@ void DBlockDevice::onInterfacesRemoved(const QDBusObjectPath &object_path, const
         return;
 
     for (const QString &i : interfaces) {
+        d->dropInterface(i);
+
         if (i == QStringLiteral(UDISKS2_SERVICE ".Filesystem")) {
             Q_EMIT hasFileSystemChanged(false);
         } else if (i == QStringLiteral(UDISKS2_SERVICE ".Partition")) {
@@ -55,43 +257,16 @@ void DBlockDevice::onInterfacesRemoved(const QDBusObjectPath &object_path, const
     }
 }
 
-void DBlockDevice::onPropertiesChanged(const QString &interface, const QVariantMap &changed_properties)
+void DBlockDevice::onPropertiesChanged(const QString &interface, const QVariantMap &changed_properties, const QStringList &invalidated_properties)
 {
-    if (interface.endsWith(".PartitionTable")) {
-        auto begin = changed_properties.begin();
-
-        while (begin != changed_properties.constEnd()) {
-            if (begin.key() == "Type") {
-                Q_EMIT ptTypeChanged();
-                break;
-            }
-
-            ++begin;
-        }
-    } else {
-        auto begin = changed_properties.begin();
-
-        for (; begin != changed_properties.constEnd(); ++begin) {
-            QString property_name = begin.key();
-
-            int pindex = this->metaObject()->indexOfProperty(property_name.toLatin1().constData());
-
-            if (pindex < 0) {
-                property_name[0] = property_name.at(0).toLower();
-
-                pindex = this->metaObject()->indexOfProperty(property_name.toLatin1().constData());
-            }
-
-            if (pindex < 0)
-                continue;
+    Q_D(DBlockDevice);
 
-            const QMetaProperty &mp = this->metaObject()->property(pindex);
+    QSet<PropertyId> changed;
 
-            if (!mp.hasNotifySignal())
-                continue;
+    d->applyProperties(interface, changed_properties, invalidated_properties, &changed);
 
-            mp.notifySignal().invoke(this, QGenericArgument(begin.value().typeName(), begin.value().constData()));
-        }
+    if (!changed.isEmpty()) {
+        Q_EMIT this->changed(changed);
     }
 }
 
@@ -130,14 +305,14 @@ QList<QPair<QString, QVariantMap> > DBlockDevice::configuration() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->configuration();
+    return d->cachedValue<QList<QPair<QString, QVariantMap>>>(ConfigurationProperty, [d] { return d->dbus->configuration(); });
 }
 
 QString DBlockDevice::cryptoBackingDevice() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->cryptoBackingDevice().path();
+    return d->cachedValue<QString>(CryptoBackingDeviceProperty, [d] { return d->dbus->cryptoBackingDevice().path(); });
 }
 
 /*!
@@ -149,14 +324,14 @@ QByteArray DBlockDevice::device() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->device();
+    return d->cachedValue<QByteArray>(DeviceProperty, [d] { return d->dbus->device(); });
 }
 
 qulonglong DBlockDevice::deviceNumber() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->deviceNumber();
+    return d->cachedValue<qulonglong>(DeviceNumberProperty, [d] { return d->dbus->deviceNumber(); });
 }
 
 /*!
@@ -168,204 +343,187 @@ QString DBlockDevice::drive() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->drive().path();
+    return d->cachedValue<QString>(DriveProperty, [d] { return d->dbus->drive().path(); });
 }
 
 bool DBlockDevice::hintAuto() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->hintAuto();
+    return d->cachedValue<bool>(HintAutoProperty, [d] { return d->dbus->hintAuto(); });
 }
 
 QString DBlockDevice::hintIconName() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->hintIconName();
+    return d->cachedValue<QString>(HintIconNameProperty, [d] { return d->dbus->hintIconName(); });
 }
 
 bool DBlockDevice::hintIgnore() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->hintIgnore();
+    return d->cachedValue<bool>(HintIgnoreProperty, [d] { return d->dbus->hintIgnore(); });
 }
 
 QString DBlockDevice::hintName() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->hintName();
+    return d->cachedValue<QString>(HintNameProperty, [d] { return d->dbus->hintName(); });
 }
 
 bool DBlockDevice::hintPartitionable() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->hintPartitionable();
+    return d->cachedValue<bool>(HintPartitionableProperty, [d] { return d->dbus->hintPartitionable(); });
 }
 
 QString DBlockDevice::hintSymbolicIconName() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->hintSymbolicIconName();
+    return d->cachedValue<QString>(HintSymbolicIconNameProperty, [d] { return d->dbus->hintSymbolicIconName(); });
 }
 
 bool DBlockDevice::hintSystem() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->hintSystem();
+    return d->cachedValue<bool>(HintSystemProperty, [d] { return d->dbus->hintSystem(); });
 }
 
 QString DBlockDevice::id() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->id();
+    return d->cachedValue<QString>(IdProperty, [d] { return d->dbus->id(); });
 }
 
 QString DBlockDevice::idLabel() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->idLabel();
+    return d->cachedValue<QString>(IdLabelProperty, [d] { return d->dbus->idLabel(); });
 }
 
 QString DBlockDevice::idType() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->idType();
+    return d->cachedValue<QString>(IdTypeProperty, [d] { return d->dbus->idType(); });
 }
 
 DBlockDevice::FSType DBlockDevice::fsType() const
 {
-    const QString &fs_type = idType();
-
-    if (fs_type.isEmpty())
-        return InvalidFS;
-
-    if (fs_type == "hfs+")
-        return hfs_plus;
-
-    bool ok = false;
-    const QMetaEnum me = QMetaEnum::fromType<FSType>();
-
-    int value = me.keyToValue(fs_type.toLatin1().constData(), &ok);
-
-    if (!ok) {
-        return UnknowFS;
-    }
-
-    return static_cast<FSType>(value);
+    return DBlockDevicePrivate::toFSType(idType());
 }
 
 QString DBlockDevice::idUUID() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->idUUID();
+    return d->cachedValue<QString>(IdUUIDProperty, [d] { return d->dbus->idUUID(); });
 }
 
 QString DBlockDevice::idUsage() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->idUsage();
+    return d->cachedValue<QString>(IdUsageProperty, [d] { return d->dbus->idUsage(); });
 }
 
 QString DBlockDevice::idVersion() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->idVersion();
+    return d->cachedValue<QString>(IdVersionProperty, [d] { return d->dbus->idVersion(); });
 }
 
 QString DBlockDevice::mDRaid() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->mDRaid().path();
+    return d->cachedValue<QString>(MDRaidProperty, [d] { return d->dbus->mDRaid().path(); });
 }
 
 QString DBlockDevice::mDRaidMember() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->mDRaidMember().path();
+    return d->cachedValue<QString>(MDRaidMemberProperty, [d] { return d->dbus->mDRaidMember().path(); });
 }
 
 QByteArray DBlockDevice::preferredDevice() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->preferredDevice();
+    return d->cachedValue<QByteArray>(PreferredDeviceProperty, [d] { return d->dbus->preferredDevice(); });
 }
 
 bool DBlockDevice::readOnly() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->readOnly();
+    return d->cachedValue<bool>(ReadOnlyProperty, [d] { return d->dbus->readOnly(); });
 }
 
 qulonglong DBlockDevice::size() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->size();
+    return d->cachedValue<qulonglong>(SizeProperty, [d] { return d->dbus->size(); });
 }
 
 QByteArrayList DBlockDevice::symlinks() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->symlinks();
+    return d->cachedValue<QByteArrayList>(SymlinksProperty, [d] { return d->dbus->symlinks(); });
 }
 
 QStringList DBlockDevice::userspaceMountOptions() const
 {
     Q_D(const DBlockDevice);
 
-    return d->dbus->userspaceMountOptions();
+    return d->cachedValue<QStringList>(UserspaceMountOptionsProperty, [d] { return d->dbus->userspaceMountOptions(); });
 }
 
 bool DBlockDevice::hasFileSystem() const
 {
     Q_D(const DBlockDevice);
 
-    return hasFileSystem(d->dbus->path());
+    return UDisks2::interfaceExists(d->dbus->path(), UDISKS2_SERVICE ".Filesystem", d->dbus->connection());
 }
 
 bool DBlockDevice::hasPartitionTable() const
 {
     Q_D(const DBlockDevice);
 
-    return hasPartitionTable(d->dbus->path());
+    return UDisks2::interfaceExists(d->dbus->path(), UDISKS2_SERVICE ".PartitionTable", d->dbus->connection());
 }
 
 bool DBlockDevice::hasPartition() const
 {
     Q_D(const DBlockDevice);
 
-    return hasPartition(d->dbus->path());
+    return UDisks2::interfaceExists(d->dbus->path(), UDISKS2_SERVICE ".Partition", d->dbus->connection());
 }
 
 bool DBlockDevice::isEncrypted() const
 {
     Q_D(const DBlockDevice);
 
-    return isEncrypted(d->dbus->path());
+    return UDisks2::interfaceExists(d->dbus->path(), UDISKS2_SERVICE ".Encrypted", d->dbus->connection());
 }
 
 bool DBlockDevice::isLoopDevice() const
 {
     Q_D(const DBlockDevice);
 
-    return UDisks2::interfaceExists(d->dbus->path(), UDISKS2_SERVICE ".Loop");
+    return UDisks2::interfaceExists(d->dbus->path(), UDISKS2_SERVICE ".Loop", d->dbus->connection());
 }
 
 bool DBlockDevice::hasFileSystem(const QString &path)
@@ -390,52 +548,43 @@ bool DBlockDevice::isEncrypted(const QString &path)
 
 QByteArrayList DBlockDevice::mountPoints() const
 {
-    if (!hasFileSystem())
-        return QByteArrayList();
-
     Q_D(const DBlockDevice);
 
-    OrgFreedesktopUDisks2FilesystemInterface fsif(UDISKS2_SERVICE, d->dbus->path(), QDBusConnection::systemBus());
-    return fsif.mountPoints();
+    return d->cachedValue<QByteArrayList>(MountPointsProperty, [this, d] {
+        if (!hasFileSystem())
+            return QByteArrayList();
+
+        OrgFreedesktopUDisks2FilesystemInterface fsif(UDISKS2_SERVICE, d->dbus->path(), d->dbus->connection());
+        return fsif.mountPoints();
+    });
 }
 
 DBlockDevice::PTType DBlockDevice::ptType() const
 {
     Q_D(const DBlockDevice);
 
-    if (!UDisks2::interfaceExists(d->dbus->path(), UDISKS2_SERVICE ".PartitionTable")) {
-        return InvalidPT;
-    }
-
-    OrgFreedesktopUDisks2PartitionTableInterface ptif(UDISKS2_SERVICE, d->dbus->path(), QDBusConnection::systemBus());
-
-    const QString &type = ptif.type();
-
-    if (type.isEmpty()) {
-        return InvalidPT;
-    }
-
-    if (type == "dos") {
-        return MBR;
-    }
+    const QString &type = d->cachedValue<QString>(PTTypeProperty, [d] {
+        if (!UDisks2::interfaceExists(d->dbus->path(), UDISKS2_SERVICE ".PartitionTable", d->dbus->connection()))
+            return QString();
 
-    if (type == "gpt") {
-        return GPT;
-    }
+        OrgFreedesktopUDisks2PartitionTableInterface ptif(UDISKS2_SERVICE, d->dbus->path(), d->dbus->connection());
+        return ptif.type();
+    });
 
-    return UnknowPT;
+    return DBlockDevicePrivate::toPTType(type);
 }
 
 QList<QPair<QString, QVariantMap> > DBlockDevice::childConfiguration() const
 {
     Q_D(const DBlockDevice);
 
-    if (!isEncrypted()) {
-        return QList<QPair<QString, QVariantMap>>();
-    }
+    return d->cachedValue<QList<QPair<QString, QVariantMap>>>(ChildConfigurationProperty, [this, d] {
+        if (!isEncrypted())
+            return QList<QPair<QString, QVariantMap>>();
 
-    OrgFreedesktopUDisks2EncryptedInterface eif(UDISKS2_SERVICE, d->dbus->path(), QDBusConnection::systemBus());
-    return eif.childConfiguration();
+        OrgFreedesktopUDisks2EncryptedInterface eif(UDISKS2_SERVICE, d->dbus->path(), d->dbus->connection());
+        return eif.childConfiguration();
+    });
 }
 
 QDBusError DBlockDevice::lastError() const
@@ -444,6 +593,16 @@ QDBusError DBlockDevice::lastError() const
     return d->err;
 }
 
+/*!
+ * \brief The D-Bus connection used to talk to UDisks2, the system bus by default.
+ */
+QDBusConnection DBlockDevice::connection() const
+{
+    Q_D(const DBlockDevice);
+
+    return d->dbus->connection();
+}
+
 void DBlockDevice::setWatchChanges(bool watchChanges)
 {
     Q_D(DBlockDevice);
@@ -453,8 +612,8 @@ void DBlockDevice::setWatchChanges(bool watchChanges)
 
     d->watchChanges = watchChanges;
 
-    OrgFreedesktopDBusObjectManagerInterface *object_manager = UDisks2::objectManager();
-    auto sb = QDBusConnection::systemBus();
+    auto sb = d->dbus->connection();
+    OrgFreedesktopDBusObjectManagerInterface *object_manager = UDisks2::objectManager(sb);
 
     if (watchChanges) {
         connect(object_manager, &OrgFreedesktopDBusObjectManagerInterface::InterfacesAdded,
@@ -462,16 +621,23 @@ void DBlockDevice::setWatchChanges(bool watchChanges)
         connect(object_manager, &OrgFreedesktopDBusObjectManagerInterface::InterfacesRemoved,
                 this, &DBlockDevice::onInterfacesRemoved);
 
-        sb.connect(UDISKS2_SERVICE, d->dbus->path(), "org.freedesktop.DBus.Properties",
-                   "PropertiesChanged", this, SLOT(onPropertiesChanged(const QString &, const QVariantMap &)));
+        DPropertiesDispatcher::instance(sb)->subscribe(d->dbus->path(), this, [this] (const QString &interface, const QVariantMap &changed_properties,
+                                                                                      const QStringList &invalidated_properties) {
+            onPropertiesChanged(interface, changed_properties, invalidated_properties);
+        });
+        connect(UDisks2::serviceWatcher(sb), &QDBusServiceWatcher::serviceOwnerChanged,
+                this, &DBlockDevice::onServiceOwnerChanged);
     } else {
         disconnect(object_manager, &OrgFreedesktopDBusObjectManagerInterface::InterfacesAdded,
                    this, &DBlockDevice::onInterfacesAdded);
         disconnect(object_manager, &OrgFreedesktopDBusObjectManagerInterface::InterfacesRemoved,
                    this, &DBlockDevice::onInterfacesRemoved);
 
-        sb.disconnect(UDISKS2_SERVICE, d->dbus->path(), "org.freedesktop.DBus.Properties",
-                      "PropertiesChanged", this, SLOT(onPropertiesChanged(const QString &, const QVariantMap &)));
+        DPropertiesDispatcher::instance(sb)->unsubscribe(d->dbus->path(), this);
+        disconnect(UDisks2::serviceWatcher(sb), &QDBusServiceWatcher::serviceOwnerChanged,
+                   this, &DBlockDevice::onServiceOwnerChanged);
+
+        d->cache.clear();
     }
 }
 
@@ -597,7 +763,7 @@ QString DBlockDevice::mount(const QVariantMap &options)
 
     Q_D(DBlockDevice);
 
-    OrgFreedesktopUDisks2FilesystemInterface fsif(UDISKS2_SERVICE, d->dbus->path(), QDBusConnection::systemBus());
+    OrgFreedesktopUDisks2FilesystemInterface fsif(UDISKS2_SERVICE, d->dbus->path(), d->dbus->connection());
 
     auto r = fsif.Mount(options);
     r.waitForFinished();
@@ -613,7 +779,7 @@ void DBlockDevice::unmount(const QVariantMap &options)
 
     Q_D(DBlockDevice);
 
-    OrgFreedesktopUDisks2FilesystemInterface fsif(UDISKS2_SERVICE, d->dbus->path(), QDBusConnection::systemBus());
+    OrgFreedesktopUDisks2FilesystemInterface fsif(UDISKS2_SERVICE, d->dbus->path(), d->dbus->connection());
     auto r = fsif.Unmount(options);
     r.waitForFinished();
     d->err = r.error();
@@ -653,12 +819,67 @@ void DBlockDevice::setLabel(const QString &label, const QVariantMap &options)
 
     Q_D(DBlockDevice);
 
-    OrgFreedesktopUDisks2FilesystemInterface fsif(UDISKS2_SERVICE, d->dbus->path(), QDBusConnection::systemBus());
+    OrgFreedesktopUDisks2FilesystemInterface fsif(UDISKS2_SERVICE, d->dbus->path(), d->dbus->connection());
     auto r = fsif.SetLabel(label, options);
     r.waitForFinished();
     d->err = r.error();
 }
 
+/*!
+ * \brief Checks the filesystem for consistency.
+ *
+ * \return true if the filesystem is undamaged.
+ *
+ * \sa DFileSystemCheckScheduler
+ */
+bool DBlockDevice::checkFileSystem(const QVariantMap &options)
+{
+    Q_D(DBlockDevice);
+
+    OrgFreedesktopUDisks2FilesystemInterface fsif(UDISKS2_SERVICE, d->dbus->path(), d->dbus->connection());
+    fsif.setTimeout(INT_MAX);
+
+    auto r = fsif.Check(options);
+    r.waitForFinished();
+    d->err = r.error();
+    return !r.isError() && r.value();
+}
+
+/*!
+ * \brief Tries to repair the filesystem.
+ *
+ * \return true if the filesystem could be repaired.
+ */
+bool DBlockDevice::repairFileSystem(const QVariantMap &options)
+{
+    Q_D(DBlockDevice);
+
+    OrgFreedesktopUDisks2FilesystemInterface fsif(UDISKS2_SERVICE, d->dbus->path(), d->dbus->connection());
+    fsif.setTimeout(INT_MAX);
+
+    auto r = fsif.Repair(options);
+    r.waitForFinished();
+    d->err = r.error();
+    return !r.isError() && r.value();
+}
+
+/*!
+ * \brief Resizes the filesystem.
+ *
+ * \param size The target size in bytes, 0 for maximum.
+ */
+void DBlockDevice::resizeFileSystem(qulonglong size, const QVariantMap &options)
+{
+    Q_D(DBlockDevice);
+
+    OrgFreedesktopUDisks2FilesystemInterface fsif(UDISKS2_SERVICE, d->dbus->path(), d->dbus->connection());
+    fsif.setTimeout(INT_MAX);
+
+    auto r = fsif.Resize(size, options);
+    r.waitForFinished();
+    d->err = r.error();
+}
+
 void DBlockDevice::changePassphrase(const QString &passphrase, const QString &new_passphrase, const QVariantMap &options)
 {
     if (!isEncrypted()) {
@@ -667,7 +888,7 @@ void DBlockDevice::changePassphrase(const QString &passphrase, const QString &ne
 
     Q_D(DBlockDevice);
 
-    OrgFreedesktopUDisks2EncryptedInterface eif(UDISKS2_SERVICE, d->dbus->path(), QDBusConnection::systemBus());
+    OrgFreedesktopUDisks2EncryptedInterface eif(UDISKS2_SERVICE, d->dbus->path(), d->dbus->connection());
     auto r = eif.ChangePassphrase(passphrase, new_passphrase, options);
     r.waitForFinished();
     d->err = r.error();
@@ -681,7 +902,7 @@ void DBlockDevice::lock(const QVariantMap &options)
 
     Q_D(DBlockDevice);
 
-    OrgFreedesktopUDisks2EncryptedInterface eif(UDISKS2_SERVICE, d->dbus->path(), QDBusConnection::systemBus());
+    OrgFreedesktopUDisks2EncryptedInterface eif(UDISKS2_SERVICE, d->dbus->path(), d->dbus->connection());
     QDBusPendingReply<void> r = eif.Lock(options);
     r.waitForFinished();
     d->err = r.error();
@@ -695,7 +916,7 @@ QString DBlockDevice::unlock(const QString &passphrase, const QVariantMap &optio
 
     Q_D(DBlockDevice);
 
-    OrgFreedesktopUDisks2EncryptedInterface eif(UDISKS2_SERVICE, d->dbus->path(), QDBusConnection::systemBus());
+    OrgFreedesktopUDisks2EncryptedInterface eif(UDISKS2_SERVICE, d->dbus->path(), d->dbus->connection());
 
     auto r = eif.Unlock(passphrase, options);
     r.waitForFinished();
@@ -705,27 +926,40 @@ QString DBlockDevice::unlock(const QString &passphrase, const QVariantMap &optio
 
 QString DBlockDevice::cleartextDevice()
 {
-    if (!isEncrypted()) {
-        return QString();
-    }
-
     Q_D(const DBlockDevice);
 
-    OrgFreedesktopUDisks2EncryptedInterface eif(UDISKS2_SERVICE, d->dbus->path(), QDBusConnection::systemBus());
-    return eif.cleartextDevice().path();
+    return d->cachedValue<QString>(CleartextDeviceProperty, [this, d] {
+        if (!isEncrypted())
+            return QString();
+
+        OrgFreedesktopUDisks2EncryptedInterface eif(UDISKS2_SERVICE, d->dbus->path(), d->dbus->connection());
+        return eif.cleartextDevice().path();
+    });
 }
 
 DBlockDevice::DBlockDevice(const QString &path, QObject *parent)
-    : DBlockDevice(*new DBlockDevicePrivate(this), path, parent)
+    : DBlockDevice(*new DBlockDevicePrivate(this), path, QDBusConnection::systemBus(), parent)
+{
+
+}
+
+DBlockDevice::DBlockDevice(const QString &path, const QDBusConnection &connection, QObject *parent)
+    : DBlockDevice(*new DBlockDevicePrivate(this), path, connection, parent)
 {
 
 }
 
 DBlockDevice::DBlockDevice(DBlockDevicePrivate &dd, const QString &path, QObject *parent)
+    : DBlockDevice(dd, path, QDBusConnection::systemBus(), parent)
+{
+
+}
+
+DBlockDevice::DBlockDevice(DBlockDevicePrivate &dd, const QString &path, const QDBusConnection &connection, QObject *parent)
     : QObject(parent)
     , d_ptr(&dd)
 {
-    dd.dbus = new OrgFreedesktopUDisks2BlockInterface(UDISKS2_SERVICE, path, QDBusConnection::systemBus(), this);
+    dd.dbus = new OrgFreedesktopUDisks2BlockInterface(UDISKS2_SERVICE, path, connection, this);
 
     connect(this, &DBlockDevice::idTypeChanged, this, &DBlockDevice::fsTypeChanged);
 }
@@ -6,8 +6,10 @@
 #define DBLOCKDEVICE_H
 
 #include <QObject>
+#include <QSet>
 #include <QVariantMap>
 #include <QDBusUnixFileDescriptor>
+#include <QDBusConnection>
 #include <QDBusError>
 
 class QDBusObjectPath;
@@ -96,6 +98,60 @@ public:
 
     Q_ENUM(FSType)
 
+    enum PropertyId {
+        InvalidProperty,
+        // of Block
+        ConfigurationProperty,
+        CryptoBackingDeviceProperty,
+        DeviceProperty,
+        DeviceNumberProperty,
+        DriveProperty,
+        HintAutoProperty,
+        HintIconNameProperty,
+        HintIgnoreProperty,
+        HintNameProperty,
+        HintPartitionableProperty,
+        HintSymbolicIconNameProperty,
+        HintSystemProperty,
+        IdProperty,
+        IdLabelProperty,
+        IdTypeProperty,
+        IdUUIDProperty,
+        IdUsageProperty,
+        IdVersionProperty,
+        MDRaidProperty,
+        MDRaidMemberProperty,
+        PreferredDeviceProperty,
+        ReadOnlyProperty,
+        SizeProperty,
+        SymlinksProperty,
+        UserspaceMountOptionsProperty,
+        // of Filesystem
+        MountPointsProperty,
+        FileSystemSizeProperty,
+        // of PartitionTable
+        PTTypeProperty,
+        PTPartitionsProperty,
+        // of Encrypted
+        ChildConfigurationProperty,
+        CleartextDeviceProperty,
+        HintEncryptionTypeProperty,
+        MetadataSizeProperty,
+        // of Partition
+        PartitionFlagsProperty,
+        PartitionIsContainedProperty,
+        PartitionIsContainerProperty,
+        PartitionNameProperty,
+        PartitionNumberProperty,
+        PartitionOffsetProperty,
+        PartitionSizeProperty,
+        PartitionTableProperty,
+        PartitionTypeProperty,
+        PartitionUUIDProperty
+    };
+
+    Q_ENUM(PropertyId)
+
     ~DBlockDevice();
 
     bool isValid() const;
@@ -146,6 +202,7 @@ public:
     QList<QPair<QString, QVariantMap>> childConfiguration() const;
 
     QDBusError lastError() const;
+    QDBusConnection connection() const;
 
 public Q_SLOTS:
     void setWatchChanges(bool watchChanges);
@@ -167,6 +224,9 @@ public Q_SLOTS:
     void unmount(const QVariantMap &options);
     bool canSetLabel() const;
     void setLabel(const QString &label, const QVariantMap &options);
+    bool checkFileSystem(const QVariantMap &options);
+    bool repairFileSystem(const QVariantMap &options);
+    void resizeFileSystem(qulonglong size, const QVariantMap &options);
 
     // of Encrypted
     void changePassphrase(const QString &passphrase, const QString &new_passphrase, const QVariantMap &options);
@@ -203,17 +263,22 @@ Q_SIGNALS:
     void mountPointsChanged(const QByteArrayList &mountPoints);
     void childConfigurationChanged(QList<QPair<QString, QVariantMap>> childConfiguration);
     void cleartextDeviceChanged(const QString &cleartextDevice);
+    // emitted once per PropertiesChanged message, only contains the properties whose value really changed
+    void changed(const QSet<DBlockDevice::PropertyId> &properties);
 
 protected:
     explicit DBlockDevice(const QString &path, QObject *parent = nullptr);
+    explicit DBlockDevice(const QString &path, const QDBusConnection &connection, QObject *parent = nullptr);
     explicit DBlockDevice(DBlockDevicePrivate &dd, const QString &path, QObject *parent = nullptr);
+    explicit DBlockDevice(DBlockDevicePrivate &dd, const QString &path, const QDBusConnection &connection, QObject *parent = nullptr);
 
     QScopedPointer<DBlockDevicePrivate> d_ptr;
 
 private Q_SLOTS:
     void onInterfacesAdded(const QDBusObjectPath &object_path, const QMap<QString, QVariantMap> &interfaces_and_properties);
     void onInterfacesRemoved(const QDBusObjectPath &object_path, const QStringList &interfaces);
-    void onPropertiesChanged(const QString &interface, const QVariantMap &changed_properties);
+    void onPropertiesChanged(const QString &interface, const QVariantMap &changed_properties, const QStringList &invalidated_properties);
+    void onServiceOwnerChanged(const QString &service, const QString &oldOwner, const QString &newOwner);
 //    Q_PRIVATE_SLOT(d_ptr, void _q_onPropertiesChanged(const QString &, const QVariantMap &))
 
     friend class DDiskManager;
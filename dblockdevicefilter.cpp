@@ -0,0 +1,201 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dblockdevicefilter.h"
+#include "private/dblockdevicefilter_p.h"
+#include "dblockdeviceinfo.h"
+#include "ddriveinfo.h"
+#include "udisks2_dbus_common.h"
+
+/*!
+ * \class DBlockDeviceFilter
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief A predicate over the properties of a block device and of its drive.
+ *
+ * Filters are combined with &&, || and !, for example:
+ *
+ * \code
+ * DBlockDeviceFilter::removable() && !DBlockDeviceFilter::mounted()
+ *         && DBlockDeviceFilter::idType("vfat") && !DBlockDeviceFilter::hintIgnore()
+ * \endcode
+ *
+ * \sa DDiskManager::query(), DDiskManager::createQuery()
+ */
+
+DBlockDeviceFilter::DBlockDeviceFilter()
+    : d(new DBlockDeviceFilterData)
+{
+
+}
+
+DBlockDeviceFilter::DBlockDeviceFilter(DBlockDeviceFilterData *data)
+    : d(data)
+{
+
+}
+
+DBlockDeviceFilter::DBlockDeviceFilter(const DBlockDeviceFilter &other)
+    : d(other.d)
+{
+
+}
+
+DBlockDeviceFilter &DBlockDeviceFilter::operator=(const DBlockDeviceFilter &other)
+{
+    d = other.d;
+
+    return *this;
+}
+
+DBlockDeviceFilter::~DBlockDeviceFilter()
+{
+
+}
+
+DBlockDeviceFilter DBlockDeviceFilter::property(const QString &interface, const QString &name, const QVariant &value)
+{
+    DBlockDeviceFilterData *data = new DBlockDeviceFilterData;
+
+    data->type = DBlockDeviceFilterData::Property;
+    data->interface = QStringLiteral(UDISKS2_SERVICE ".") + interface;
+    data->name = name;
+    data->value = value;
+
+    return DBlockDeviceFilter(data);
+}
+
+DBlockDeviceFilter DBlockDeviceFilter::hasInterface(const QString &interface)
+{
+    DBlockDeviceFilterData *data = new DBlockDeviceFilterData;
+
+    data->type = DBlockDeviceFilterData::HasInterface;
+    data->interface = QStringLiteral(UDISKS2_SERVICE ".") + interface;
+
+    return DBlockDeviceFilter(data);
+}
+
+DBlockDeviceFilter DBlockDeviceFilter::custom(const std::function<bool (const DBlockDeviceInfo &, const DDriveInfo &)> &predicate)
+{
+    DBlockDeviceFilterData *data = new DBlockDeviceFilterData;
+
+    data->type = DBlockDeviceFilterData::Custom;
+    data->predicate = predicate;
+
+    return DBlockDeviceFilter(data);
+}
+
+DBlockDeviceFilter DBlockDeviceFilter::hintSystem(bool hintSystem)
+{
+    return property("Block", "HintSystem", hintSystem);
+}
+
+DBlockDeviceFilter DBlockDeviceFilter::hintIgnore(bool hintIgnore)
+{
+    return property("Block", "HintIgnore", hintIgnore);
+}
+
+DBlockDeviceFilter DBlockDeviceFilter::removable(bool removable)
+{
+    return property("Drive", "Removable", removable);
+}
+
+DBlockDeviceFilter DBlockDeviceFilter::idType(const QString &idType)
+{
+    return property("Block", "IdType", idType);
+}
+
+DBlockDeviceFilter DBlockDeviceFilter::mounted(bool mounted)
+{
+    DBlockDeviceFilterData *data = new DBlockDeviceFilterData;
+
+    data->type = DBlockDeviceFilterData::Mounted;
+    data->value = mounted;
+
+    return DBlockDeviceFilter(data);
+}
+
+DBlockDeviceFilter DBlockDeviceFilter::hasFileSystem()
+{
+    return hasInterface("Filesystem");
+}
+
+DBlockDeviceFilter DBlockDeviceFilter::hasPartition()
+{
+    return hasInterface("Partition");
+}
+
+DBlockDeviceFilter DBlockDeviceFilter::operator&&(const DBlockDeviceFilter &other) const
+{
+    DBlockDeviceFilterData *data = new DBlockDeviceFilterData;
+
+    data->type = DBlockDeviceFilterData::And;
+    data->children << *this << other;
+
+    return DBlockDeviceFilter(data);
+}
+
+DBlockDeviceFilter DBlockDeviceFilter::operator||(const DBlockDeviceFilter &other) const
+{
+    DBlockDeviceFilterData *data = new DBlockDeviceFilterData;
+
+    data->type = DBlockDeviceFilterData::Or;
+    data->children << *this << other;
+
+    return DBlockDeviceFilter(data);
+}
+
+DBlockDeviceFilter DBlockDeviceFilter::operator!() const
+{
+    DBlockDeviceFilterData *data = new DBlockDeviceFilterData;
+
+    data->type = DBlockDeviceFilterData::Not;
+    data->children << *this;
+
+    return DBlockDeviceFilter(data);
+}
+
+bool DBlockDeviceFilter::matches(const DBlockDeviceInfo &info, const DDriveInfo &drive) const
+{
+    switch (d->type) {
+    case DBlockDeviceFilterData::All:
+        return true;
+    case DBlockDeviceFilterData::Property: {
+        const QVariant &value = d->interface == QStringLiteral(UDISKS2_SERVICE ".Drive")
+                ? drive.value(d->interface, d->name) : info.value(d->interface, d->name);
+
+        // e.g. a loop device has no drive, so it is not "Removable"
+        if (!value.isValid())
+            return d->value == QVariant(d->value.userType(), nullptr);
+
+        // the second comparison converts between the numeric types
+        return UDisks2::valueEquals(value, d->value) || value == d->value;
+    }
+    case DBlockDeviceFilterData::HasInterface:
+        return d->interface == QStringLiteral(UDISKS2_SERVICE ".Drive")
+                ? drive.isValid() : info.interfaces().contains(d->interface);
+    case DBlockDeviceFilterData::Mounted:
+        return info.mountPoints().isEmpty() != d->value.toBool();
+    case DBlockDeviceFilterData::Custom:
+        return d->predicate && d->predicate(info, drive);
+    case DBlockDeviceFilterData::And:
+        for (const DBlockDeviceFilter &f : d->children) {
+            if (!f.matches(info, drive))
+                return false;
+        }
+
+        return true;
+    case DBlockDeviceFilterData::Or:
+        for (const DBlockDeviceFilter &f : d->children) {
+            if (f.matches(info, drive))
+                return true;
+        }
+
+        return false;
+    case DBlockDeviceFilterData::Not:
+        return !d->children.first().matches(info, drive);
+    }
+
+    return false;
+}
@@ -0,0 +1,56 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DBLOCKDEVICEFILTER_H
+#define DBLOCKDEVICEFILTER_H
+
+#include <QSharedDataPointer>
+#include <QVariant>
+
+#include <functional>
+
+class DBlockDeviceInfo;
+class DDriveInfo;
+class DBlockDeviceFilterData;
+class DBlockDeviceFilter
+{
+public:
+    // matches every block device
+    DBlockDeviceFilter();
+    DBlockDeviceFilter(const DBlockDeviceFilter &other);
+    DBlockDeviceFilter &operator=(const DBlockDeviceFilter &other);
+    ~DBlockDeviceFilter();
+
+    // interface is the short name: "Block", "Filesystem", "Partition", "Drive" (of the drive of the device)...
+    static DBlockDeviceFilter property(const QString &interface, const QString &name, const QVariant &value);
+    static DBlockDeviceFilter hasInterface(const QString &interface);
+    static DBlockDeviceFilter custom(const std::function<bool(const DBlockDeviceInfo &, const DDriveInfo &)> &predicate);
+
+    // these are served by the indexes of DDiskManager
+    static DBlockDeviceFilter hintSystem(bool hintSystem = true);
+    static DBlockDeviceFilter hintIgnore(bool hintIgnore = true);
+    static DBlockDeviceFilter removable(bool removable = true);
+    static DBlockDeviceFilter idType(const QString &idType);
+    static DBlockDeviceFilter mounted(bool mounted = true);
+
+    static DBlockDeviceFilter hasFileSystem();
+    static DBlockDeviceFilter hasPartition();
+
+    DBlockDeviceFilter operator&&(const DBlockDeviceFilter &other) const;
+    DBlockDeviceFilter operator||(const DBlockDeviceFilter &other) const;
+    DBlockDeviceFilter operator!() const;
+
+    bool matches(const DBlockDeviceInfo &info, const DDriveInfo &drive) const;
+
+private:
+    explicit DBlockDeviceFilter(DBlockDeviceFilterData *data);
+
+    QSharedDataPointer<DBlockDeviceFilterData> d;
+
+    friend class DDiskManagerPrivate;
+};
+
+Q_DECLARE_METATYPE(DBlockDeviceFilter)
+
+#endif // DBLOCKDEVICEFILTER_H
@@ -0,0 +1,265 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dblockdeviceinfo.h"
+#include "private/dblockdevice_p.h"
+#include "udisks2_dbus_common.h"
+
+class DBlockDeviceInfoData : public QSharedData
+{
+public:
+    QVariant block(const char *name) const
+    {
+        return interfaces.value(QStringLiteral(UDISKS2_SERVICE ".Block")).value(QLatin1String(name));
+    }
+
+    QString path;
+    // interface -> properties, the values are demarshalled (see UDisks2::demarshal)
+    QMap<QString, QVariantMap> interfaces;
+};
+
+/*!
+ * \class DBlockDeviceInfo
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief A read-only snapshot of the properties of a block device.
+ *
+ * Unlike DBlockDevice this is not a QObject and doesn't talk to UDisks2: it is
+ * implicitly shared, so copying it into containers or passing it to another
+ * thread only copies a pointer. Get them from DDiskManager::blockDeviceInfo()
+ * and DDiskManager::blockDeviceInfoList().
+ *
+ * \sa DDriveInfo, DBlockDevice
+ */
+
+DBlockDeviceInfo::DBlockDeviceInfo()
+    : d(new DBlockDeviceInfoData)
+{
+
+}
+
+DBlockDeviceInfo::DBlockDeviceInfo(const QString &path, const QMap<QString, QVariantMap> &interfaces)
+    : d(new DBlockDeviceInfoData)
+{
+    d->path = path;
+    d->interfaces = interfaces;
+}
+
+DBlockDeviceInfo::DBlockDeviceInfo(const DBlockDeviceInfo &other)
+    : d(other.d)
+{
+
+}
+
+DBlockDeviceInfo &DBlockDeviceInfo::operator=(const DBlockDeviceInfo &other)
+{
+    d = other.d;
+
+    return *this;
+}
+
+DBlockDeviceInfo::~DBlockDeviceInfo()
+{
+
+}
+
+bool DBlockDeviceInfo::isValid() const
+{
+    return d->interfaces.contains(QStringLiteral(UDISKS2_SERVICE ".Block"));
+}
+
+QString DBlockDeviceInfo::path() const
+{
+    return d->path;
+}
+
+QString DBlockDeviceInfo::cryptoBackingDevice() const
+{
+    return d->block("CryptoBackingDevice").toString();
+}
+
+QByteArray DBlockDeviceInfo::device() const
+{
+    return d->block("Device").toByteArray();
+}
+
+qulonglong DBlockDeviceInfo::deviceNumber() const
+{
+    return d->block("DeviceNumber").toULongLong();
+}
+
+QString DBlockDeviceInfo::drive() const
+{
+    return d->block("Drive").toString();
+}
+
+bool DBlockDeviceInfo::hintAuto() const
+{
+    return d->block("HintAuto").toBool();
+}
+
+QString DBlockDeviceInfo::hintIconName() const
+{
+    return d->block("HintIconName").toString();
+}
+
+bool DBlockDeviceInfo::hintIgnore() const
+{
+    return d->block("HintIgnore").toBool();
+}
+
+QString DBlockDeviceInfo::hintName() const
+{
+    return d->block("HintName").toString();
+}
+
+bool DBlockDeviceInfo::hintPartitionable() const
+{
+    return d->block("HintPartitionable").toBool();
+}
+
+QString DBlockDeviceInfo::hintSymbolicIconName() const
+{
+    return d->block("HintSymbolicIconName").toString();
+}
+
+bool DBlockDeviceInfo::hintSystem() const
+{
+    return d->block("HintSystem").toBool();
+}
+
+QString DBlockDeviceInfo::id() const
+{
+    return d->block("Id").toString();
+}
+
+QString DBlockDeviceInfo::idLabel() const
+{
+    return d->block("IdLabel").toString();
+}
+
+QString DBlockDeviceInfo::idType() const
+{
+    return d->block("IdType").toString();
+}
+
+DBlockDevice::FSType DBlockDeviceInfo::fsType() const
+{
+    return DBlockDevicePrivate::toFSType(idType());
+}
+
+QString DBlockDeviceInfo::idUUID() const
+{
+    return d->block("IdUUID").toString();
+}
+
+QString DBlockDeviceInfo::idUsage() const
+{
+    return d->block("IdUsage").toString();
+}
+
+QString DBlockDeviceInfo::idVersion() const
+{
+    return d->block("IdVersion").toString();
+}
+
+QString DBlockDeviceInfo::mDRaid() const
+{
+    return d->block("MDRaid").toString();
+}
+
+QString DBlockDeviceInfo::mDRaidMember() const
+{
+    return d->block("MDRaidMember").toString();
+}
+
+QByteArray DBlockDeviceInfo::preferredDevice() const
+{
+    return d->block("PreferredDevice").toByteArray();
+}
+
+bool DBlockDeviceInfo::readOnly() const
+{
+    return d->block("ReadOnly").toBool();
+}
+
+qulonglong DBlockDeviceInfo::size() const
+{
+    return d->block("Size").toULongLong();
+}
+
+QByteArrayList DBlockDeviceInfo::symlinks() const
+{
+    return d->block("Symlinks").value<QByteArrayList>();
+}
+
+QStringList DBlockDeviceInfo::userspaceMountOptions() const
+{
+    return d->block("UserspaceMountOptions").toStringList();
+}
+
+bool DBlockDeviceInfo::hasFileSystem() const
+{
+    return d->interfaces.contains(QStringLiteral(UDISKS2_SERVICE ".Filesystem"));
+}
+
+bool DBlockDeviceInfo::hasPartitionTable() const
+{
+    return d->interfaces.contains(QStringLiteral(UDISKS2_SERVICE ".PartitionTable"));
+}
+
+bool DBlockDeviceInfo::hasPartition() const
+{
+    return d->interfaces.contains(QStringLiteral(UDISKS2_SERVICE ".Partition"));
+}
+
+bool DBlockDeviceInfo::isEncrypted() const
+{
+    return d->interfaces.contains(QStringLiteral(UDISKS2_SERVICE ".Encrypted"));
+}
+
+bool DBlockDeviceInfo::isLoopDevice() const
+{
+    return d->interfaces.contains(QStringLiteral(UDISKS2_SERVICE ".Loop"));
+}
+
+QByteArrayList DBlockDeviceInfo::mountPoints() const
+{
+    return value(UDISKS2_SERVICE ".Filesystem", "MountPoints").value<QByteArrayList>();
+}
+
+DBlockDevice::PTType DBlockDeviceInfo::ptType() const
+{
+    return DBlockDevicePrivate::toPTType(value(UDISKS2_SERVICE ".PartitionTable", "Type").toString());
+}
+
+QStringList DBlockDeviceInfo::partitions() const
+{
+    return value(UDISKS2_SERVICE ".PartitionTable", "Partitions").toStringList();
+}
+
+QString DBlockDeviceInfo::cleartextDevice() const
+{
+    return value(UDISKS2_SERVICE ".Encrypted", "CleartextDevice").toString();
+}
+
+QString DBlockDeviceInfo::partitionTable() const
+{
+    return value(UDISKS2_SERVICE ".Partition", "Table").toString();
+}
+
+uint DBlockDeviceInfo::partitionNumber() const
+{
+    return value(UDISKS2_SERVICE ".Partition", "Number").toUInt();
+}
+
+QStringList DBlockDeviceInfo::interfaces() const
+{
+    return d->interfaces.keys();
+}
+
+QVariant DBlockDeviceInfo::value(const QString &interface, const QString &name) const
+{
+    return d->interfaces.value(interface).value(name);
+}
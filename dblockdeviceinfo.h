@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DBLOCKDEVICEINFO_H
+#define DBLOCKDEVICEINFO_H
+
+#include "dblockdevice.h"
+
+#include <QSharedDataPointer>
+
+class DBlockDeviceInfoData;
+class DBlockDeviceInfo
+{
+public:
+    DBlockDeviceInfo();
+    DBlockDeviceInfo(const DBlockDeviceInfo &other);
+    DBlockDeviceInfo &operator=(const DBlockDeviceInfo &other);
+    ~DBlockDeviceInfo();
+
+    void swap(DBlockDeviceInfo &other) noexcept { d.swap(other.d); }
+
+    bool isValid() const;
+    QString path() const;
+
+    QString cryptoBackingDevice() const;
+    QByteArray device() const;
+    qulonglong deviceNumber() const;
+    QString drive() const;
+    bool hintAuto() const;
+    QString hintIconName() const;
+    bool hintIgnore() const;
+    QString hintName() const;
+    bool hintPartitionable() const;
+    QString hintSymbolicIconName() const;
+    bool hintSystem() const;
+    QString id() const;
+    QString idLabel() const;
+    QString idType() const;
+    DBlockDevice::FSType fsType() const;
+    QString idUUID() const;
+    QString idUsage() const;
+    QString idVersion() const;
+    QString mDRaid() const;
+    QString mDRaidMember() const;
+    QByteArray preferredDevice() const;
+    bool readOnly() const;
+    qulonglong size() const;
+    QByteArrayList symlinks() const;
+    QStringList userspaceMountOptions() const;
+
+    bool hasFileSystem() const;
+    bool hasPartitionTable() const;
+    bool hasPartition() const;
+    bool isEncrypted() const;
+    bool isLoopDevice() const;
+
+    QByteArrayList mountPoints() const;
+    DBlockDevice::PTType ptType() const;
+    QStringList partitions() const;
+    QString cleartextDevice() const;
+    QString partitionTable() const;
+    uint partitionNumber() const;
+
+    QStringList interfaces() const;
+    // the raw value of any property of the snapshot, interface is like "org.freedesktop.UDisks2.Block"
+    QVariant value(const QString &interface, const QString &name) const;
+
+private:
+    DBlockDeviceInfo(const QString &path, const QMap<QString, QVariantMap> &interfaces);
+
+    QSharedDataPointer<DBlockDeviceInfoData> d;
+
+    friend class DDiskManager;
+    friend class DDiskManagerPrivate;
+};
+
+Q_DECLARE_SHARED(DBlockDeviceInfo)
+Q_DECLARE_METATYPE(DBlockDeviceInfo)
+
+#endif // DBLOCKDEVICEINFO_H
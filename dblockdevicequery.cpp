@@ -0,0 +1,138 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dblockdevicequery.h"
+#include "dblockdevicefilter.h"
+#include "ddiskmanager.h"
+
+#include <QSet>
+
+#include <algorithm>
+
+class DBlockDeviceQueryPrivate
+{
+public:
+    DBlockDeviceQueryPrivate(DBlockDeviceQuery *qq, DDiskManager *manager, const DBlockDeviceFilter &filter)
+        : manager(manager)
+        , filter(filter)
+        , q_ptr(qq)
+    {
+
+    }
+
+    void update(const QString &path, bool match);
+
+    DDiskManager *manager;
+    DBlockDeviceFilter filter;
+    QSet<QString> results;
+
+    DBlockDeviceQuery *q_ptr;
+
+    Q_DECLARE_PUBLIC(DBlockDeviceQuery)
+};
+
+void DBlockDeviceQueryPrivate::update(const QString &path, bool match)
+{
+    Q_Q(DBlockDeviceQuery);
+
+    if (match == results.contains(path))
+        return;
+
+    if (match) {
+        results.insert(path);
+        Q_EMIT q->added(path);
+    } else {
+        results.remove(path);
+        Q_EMIT q->removed(path);
+    }
+
+    Q_EMIT q->resultsChanged(q->results());
+}
+
+/*!
+ * \class DBlockDeviceQuery
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief The live result of a DBlockDeviceFilter.
+ *
+ * Only the devices touched by a change are evaluated again, added() and
+ * removed() report the devices entering and leaving the result.
+ *
+ * \sa DDiskManager::createQuery()
+ */
+
+DBlockDeviceQuery::DBlockDeviceQuery(DDiskManager *manager, const DBlockDeviceFilter &filter, QObject *parent)
+    : QObject(parent)
+    , d_ptr(new DBlockDeviceQueryPrivate(this, manager, filter))
+{
+    Q_D(DBlockDeviceQuery);
+
+    for (const QString &path : manager->query(filter)) {
+        d->results.insert(path);
+    }
+
+    connect(manager, &DDiskManager::blockDeviceAdded, this, &DBlockDeviceQuery::onChanged);
+    connect(manager, &DDiskManager::blockDeviceRemoved, this, &DBlockDeviceQuery::onBlockDeviceRemoved);
+    connect(manager, &DDiskManager::fileSystemAdded, this, &DBlockDeviceQuery::onChanged);
+    connect(manager, &DDiskManager::fileSystemRemoved, this, &DBlockDeviceQuery::onChanged);
+    connect(manager, &DDiskManager::diskDeviceAdded, this, &DBlockDeviceQuery::onChanged);
+    connect(manager, &DDiskManager::diskDeviceRemoved, this, &DBlockDeviceQuery::onChanged);
+    connect(manager, &DDiskManager::propertiesChanged, this, &DBlockDeviceQuery::onChanged);
+}
+
+DBlockDeviceQuery::~DBlockDeviceQuery()
+{
+
+}
+
+DBlockDeviceFilter DBlockDeviceQuery::filter() const
+{
+    Q_D(const DBlockDeviceQuery);
+
+    return d->filter;
+}
+
+QStringList DBlockDeviceQuery::results() const
+{
+    Q_D(const DBlockDeviceQuery);
+
+    QStringList list = d->results.values();
+
+    std::sort(list.begin(), list.end());
+
+    return list;
+}
+
+bool DBlockDeviceQuery::contains(const QString &blockDevicePath) const
+{
+    Q_D(const DBlockDeviceQuery);
+
+    return d->results.contains(blockDevicePath);
+}
+
+void DBlockDeviceQuery::onChanged(const QString &path)
+{
+    Q_D(DBlockDeviceQuery);
+
+    if (path.startsWith(QStringLiteral("/org/freedesktop/UDisks2/drives/"))) {
+        // the drive properties (Removable...) are evaluated on its block devices
+        for (const QString &block : d->manager->query(DBlockDeviceFilter::property("Block", "Drive", path))) {
+            d->update(block, d->manager->matches(d->filter, block));
+        }
+
+        return;
+    }
+
+    if (!path.startsWith(QStringLiteral("/org/freedesktop/UDisks2/block_devices/")))
+        return;
+
+    d->update(path, d->manager->matches(d->filter, path));
+}
+
+void DBlockDeviceQuery::onBlockDeviceRemoved(const QString &path)
+{
+    Q_D(DBlockDeviceQuery);
+
+    d->update(path, false);
+}
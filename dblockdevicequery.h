@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DBLOCKDEVICEQUERY_H
+#define DBLOCKDEVICEQUERY_H
+
+#include <QObject>
+#include <QStringList>
+
+class DDiskManager;
+class DBlockDeviceFilter;
+class DBlockDeviceQueryPrivate;
+class DBlockDeviceQuery : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(DBlockDeviceQuery)
+
+    Q_PROPERTY(QStringList results READ results NOTIFY resultsChanged)
+
+public:
+    ~DBlockDeviceQuery();
+
+    DBlockDeviceFilter filter() const;
+    QStringList results() const;
+    bool contains(const QString &blockDevicePath) const;
+
+Q_SIGNALS:
+    void added(const QString &blockDevicePath);
+    void removed(const QString &blockDevicePath);
+    void resultsChanged(const QStringList &results);
+
+private:
+    explicit DBlockDeviceQuery(DDiskManager *manager, const DBlockDeviceFilter &filter, QObject *parent = nullptr);
+
+    QScopedPointer<DBlockDeviceQueryPrivate> d_ptr;
+
+    friend class DDiskManager;
+
+private Q_SLOTS:
+    void onChanged(const QString &path);
+    void onBlockDeviceRemoved(const QString &path);
+};
+
+#endif // DBLOCKDEVICEQUERY_H
@@ -24,63 +24,63 @@ qulonglong DBlockPartition::flags() const
 {
     Q_D(const DBlockPartition);
 
-    return d->dbus->flags();
+    return d->cachedValue<qulonglong>(PartitionFlagsProperty, [d] { return d->dbus->flags(); });
 }
 
 bool DBlockPartition::isContained() const
 {
     Q_D(const DBlockPartition);
 
-    return d->dbus->isContained();
+    return d->cachedValue<bool>(PartitionIsContainedProperty, [d] { return d->dbus->isContained(); });
 }
 
 bool DBlockPartition::isContainer() const
 {
     Q_D(const DBlockPartition);
 
-    return d->dbus->isContainer();
+    return d->cachedValue<bool>(PartitionIsContainerProperty, [d] { return d->dbus->isContainer(); });
 }
 
 QString DBlockPartition::name() const
 {
     Q_D(const DBlockPartition);
 
-    return d->dbus->name();
+    return d->cachedValue<QString>(PartitionNameProperty, [d] { return d->dbus->name(); });
 }
 
 uint DBlockPartition::number() const
 {
     Q_D(const DBlockPartition);
 
-    return d->dbus->number();
+    return d->cachedValue<uint>(PartitionNumberProperty, [d] { return d->dbus->number(); });
 }
 
 qulonglong DBlockPartition::offset() const
 {
     Q_D(const DBlockPartition);
 
-    return d->dbus->offset();
+    return d->cachedValue<qulonglong>(PartitionOffsetProperty, [d] { return d->dbus->offset(); });
 }
 
 qulonglong DBlockPartition::size() const
 {
     Q_D(const DBlockPartition);
 
-    return d->dbus->size();
+    return d->cachedValue<qulonglong>(PartitionSizeProperty, [d] { return d->dbus->size(); });
 }
 
 QString DBlockPartition::table() const
 {
     Q_D(const DBlockPartition);
 
-    return d->dbus->table().path();
+    return d->cachedValue<QString>(PartitionTableProperty, [d] { return d->dbus->table().path(); });
 }
 
 QString DBlockPartition::type() const
 {
     Q_D(const DBlockPartition);
 
-    return d->dbus->type();
+    return d->cachedValue<QString>(PartitionTypeProperty, [d] { return d->dbus->type(); });
 }
 
 DBlockPartition::Type DBlockPartition::eType() const
@@ -104,7 +104,7 @@ QString DBlockPartition::UUID() const
 {
     Q_D(const DBlockPartition);
 
-    return d->dbus->uUID();
+    return d->cachedValue<QString>(PartitionUUIDProperty, [d] { return d->dbus->uUID(); });
 }
 
 DBlockPartition::GUIDType DBlockPartition::guidType() const
@@ -734,9 +734,15 @@ void DBlockPartition::setType(DBlockPartition::Type type, const QVariantMap &opt
  */
 
 DBlockPartition::DBlockPartition(const QString &path, QObject *parent)
-    : DBlockDevice(*new DBlockPartitionPrivate(this), path, parent)
+    : DBlockPartition(path, QDBusConnection::systemBus(), parent)
 {
-    d_func()->dbus = new OrgFreedesktopUDisks2PartitionInterface(UDISKS2_SERVICE, path, QDBusConnection::systemBus(), this);
+
+}
+
+DBlockPartition::DBlockPartition(const QString &path, const QDBusConnection &connection, QObject *parent)
+    : DBlockDevice(*new DBlockPartitionPrivate(this), path, connection, parent)
+{
+    d_func()->dbus = new OrgFreedesktopUDisks2PartitionInterface(UDISKS2_SERVICE, path, connection, this);
 
     connect(this, &DBlockPartition::typeChanged, this, &DBlockPartition::eTypeChanged);
     connect(this, &DBlockPartition::UUIDChanged, this, &DBlockPartition::guidTypeChanged);
@@ -298,6 +298,7 @@ Q_SIGNALS:
 
 private:
     explicit DBlockPartition(const QString &path, QObject *parent = nullptr);
+    explicit DBlockPartition(const QString &path, const QDBusConnection &connection, QObject *parent = nullptr);
 
     friend class DDiskManager;
 };
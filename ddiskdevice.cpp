@@ -4,19 +4,125 @@
 
 #include "ddiskdevice.h"
 #include "udisks2_interface.h"
+#include "private/dpropertiesdispatcher_p.h"
+
+#include <QDBusServiceWatcher>
+#include <QHash>
+#include <QMetaProperty>
+
+namespace {
+struct PropertyEntry
+{
+    const char *name; // of org.freedesktop.UDisks2.Drive
+    DDiskDevice::PropertyId id;
+    const char *qtProperty; // the Q_PROPERTY whose NOTIFY signal is emitted
+};
+}
+
+static const PropertyEntry propertyEntries[] = {
+    {"CanPowerOff", DDiskDevice::CanPowerOffProperty, "canPowerOff"},
+    {"Configuration", DDiskDevice::ConfigurationProperty, "configuration"},
+    {"ConnectionBus", DDiskDevice::ConnectionBusProperty, "connectionBus"},
+    {"Ejectable", DDiskDevice::EjectableProperty, "ejectable"},
+    {"Id", DDiskDevice::IdProperty, "id"},
+    {"Media", DDiskDevice::MediaProperty, "media"},
+    {"MediaAvailable", DDiskDevice::MediaAvailableProperty, "mediaAvailable"},
+    {"MediaChangeDetected", DDiskDevice::MediaChangeDetectedProperty, "mediaChangeDetected"},
+    {"MediaCompatibility", DDiskDevice::MediaCompatibilityProperty, "mediaCompatibility"},
+    {"MediaRemovable", DDiskDevice::MediaRemovableProperty, "mediaRemovable"},
+    {"Model", DDiskDevice::ModelProperty, "model"},
+    {"Optical", DDiskDevice::OpticalProperty, "optical"},
+    {"OpticalBlank", DDiskDevice::OpticalBlankProperty, "opticalBlank"},
+    {"OpticalNumAudioTracks", DDiskDevice::OpticalNumAudioTracksProperty, "opticalNumAudioTracks"},
+    {"OpticalNumDataTracks", DDiskDevice::OpticalNumDataTracksProperty, "opticalNumDataTracks"},
+    {"OpticalNumSessions", DDiskDevice::OpticalNumSessionsProperty, "opticalNumSessions"},
+    {"OpticalNumTracks", DDiskDevice::OpticalNumTracksProperty, "opticalNumTracks"},
+    {"Removable", DDiskDevice::RemovableProperty, "removable"},
+    {"Revision", DDiskDevice::RevisionProperty, "revision"},
+    {"RotationRate", DDiskDevice::RotationRateProperty, "rotationRate"},
+    {"Seat", DDiskDevice::SeatProperty, "seat"},
+    {"Serial", DDiskDevice::SerialProperty, "serial"},
+    {"SiblingId", DDiskDevice::SiblingIdProperty, "siblingId"},
+    {"Size", DDiskDevice::SizeProperty, "size"},
+    {"SortKey", DDiskDevice::SortKeyProperty, "sortKey"},
+    {"TimeDetected", DDiskDevice::TimeDetectedProperty, "timeDetected"},
+    {"TimeMediaDetected", DDiskDevice::TimeMediaDetectedProperty, "timeMediaDetected"},
+    {"Vendor", DDiskDevice::VendorProperty, "vendor"},
+    {"WWN", DDiskDevice::WWNProperty, "WWN"},
+};
+
+static const PropertyEntry *findPropertyEntry(const QString &name)
+{
+    for (const PropertyEntry &entry : propertyEntries) {
+        if (name == QLatin1String(entry.name))
+            return &entry;
+    }
+
+    return nullptr;
+}
+
+static void emitNotifySignal(DDiskDevice *device, const PropertyEntry *entry, QVariant value)
+{
+    const QMetaProperty &mp = DDiskDevice::staticMetaObject.property(DDiskDevice::staticMetaObject.indexOfProperty(entry->qtProperty));
+    const QMetaMethod &signal = mp.notifySignal();
+
+    if (value.userType() != signal.parameterType(0) && !value.convert(signal.parameterType(0)))
+        return;
+
+    signal.invoke(device, QGenericArgument(signal.parameterTypes().first().constData(), value.constData()));
+}
 
 class DDiskDevicePrivate
 {
 public:
     OrgFreedesktopUDisks2DriveInterface *dbus = nullptr;
     QDBusError err;
+    bool watchChanges = false;
+    // property values kept up to date by PropertiesChanged while watchChanges is enabled
+    mutable QHash<DDiskDevice::PropertyId, QVariant> cache;
+
+    template<typename T, typename Fetch>
+    T cachedValue(DDiskDevice::PropertyId id, Fetch fetch) const
+    {
+        if (!watchChanges)
+            return fetch();
+
+        auto it = cache.constFind(id);
+
+        if (it != cache.constEnd())
+            return it->template value<T>();
+
+        const T value = fetch();
+        cache.insert(id, QVariant::fromValue(value));
+
+        return value;
+    }
 };
 
+/*!
+ * \class DDiskDevice
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief A drive of UDisks2.
+ *
+ * By default every getter reads the property from udisksd. With watchChanges()
+ * enabled the values are cached and kept up to date by PropertiesChanged (an
+ * invalidated property is read again), and the NOTIFY signal of every
+ * property whose value really changed is emitted,
+ * so the media of a card reader or an optical drive can be followed without
+ * polling. All the devices of a connection share one subscription.
+ */
 DDiskDevice::DDiskDevice(const QString &path, QObject *parent)
+    : DDiskDevice(path, QDBusConnection::systemBus(), parent)
+{
+
+}
+
+DDiskDevice::DDiskDevice(const QString &path, const QDBusConnection &connection, QObject *parent)
     : QObject(parent)
     , d_ptr(new DDiskDevicePrivate())
 {
-    d_ptr->dbus = new OrgFreedesktopUDisks2DriveInterface(UDISKS2_SERVICE, path, QDBusConnection::systemBus(), this);
+    d_ptr->dbus = new OrgFreedesktopUDisks2DriveInterface(UDISKS2_SERVICE, path, connection, this);
 }
 
 DDiskDevice::~DDiskDevice()
@@ -33,147 +139,363 @@ QString DDiskDevice::path() const
 
 bool DDiskDevice::canPowerOff() const
 {
-    return d_ptr->dbus->canPowerOff();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<bool>(CanPowerOffProperty, [d] {
+        return d->dbus->canPowerOff();
+    });
 }
 
 QVariantMap DDiskDevice::configuration() const
 {
-    return d_ptr->dbus->configuration();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<QVariantMap>(ConfigurationProperty, [d] {
+        return d->dbus->configuration();
+    });
 }
 
 QString DDiskDevice::connectionBus() const
 {
-    return d_ptr->dbus->connectionBus();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<QString>(ConnectionBusProperty, [d] {
+        return d->dbus->connectionBus();
+    });
 }
 
 bool DDiskDevice::ejectable() const
 {
-    return d_ptr->dbus->ejectable();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<bool>(EjectableProperty, [d] {
+        return d->dbus->ejectable();
+    });
 }
 
 QString DDiskDevice::id() const
 {
-    return d_ptr->dbus->id();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<QString>(IdProperty, [d] {
+        return d->dbus->id();
+    });
 }
 
 QString DDiskDevice::media() const
 {
-    return d_ptr->dbus->media();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<QString>(MediaProperty, [d] {
+        return d->dbus->media();
+    });
 }
 
 bool DDiskDevice::mediaAvailable() const
 {
-    return d_ptr->dbus->mediaAvailable();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<bool>(MediaAvailableProperty, [d] {
+        return d->dbus->mediaAvailable();
+    });
 }
 
 bool DDiskDevice::mediaChangeDetected() const
 {
-    return d_ptr->dbus->mediaChangeDetected();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<bool>(MediaChangeDetectedProperty, [d] {
+        return d->dbus->mediaChangeDetected();
+    });
 }
 
 QStringList DDiskDevice::mediaCompatibility() const
 {
-    return d_ptr->dbus->mediaCompatibility();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<QStringList>(MediaCompatibilityProperty, [d] {
+        return d->dbus->mediaCompatibility();
+    });
 }
 
 bool DDiskDevice::mediaRemovable() const
 {
-    return d_ptr->dbus->mediaRemovable();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<bool>(MediaRemovableProperty, [d] {
+        return d->dbus->mediaRemovable();
+    });
 }
 
 QString DDiskDevice::model() const
 {
-    return d_ptr->dbus->model();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<QString>(ModelProperty, [d] {
+        return d->dbus->model();
+    });
 }
 
 bool DDiskDevice::optical() const
 {
-    return d_ptr->dbus->optical();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<bool>(OpticalProperty, [d] {
+        return d->dbus->optical();
+    });
 }
 
 bool DDiskDevice::opticalBlank() const
 {
-    return d_ptr->dbus->opticalBlank();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<bool>(OpticalBlankProperty, [d] {
+        return d->dbus->opticalBlank();
+    });
 }
 
 uint DDiskDevice::opticalNumAudioTracks() const
 {
-    return d_ptr->dbus->opticalNumAudioTracks();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<uint>(OpticalNumAudioTracksProperty, [d] {
+        return d->dbus->opticalNumAudioTracks();
+    });
 }
 
 uint DDiskDevice::opticalNumDataTracks() const
 {
-    return d_ptr->dbus->opticalNumDataTracks();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<uint>(OpticalNumDataTracksProperty, [d] {
+        return d->dbus->opticalNumDataTracks();
+    });
 }
 
 uint DDiskDevice::opticalNumSessions() const
 {
-    return d_ptr->dbus->opticalNumSessions();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<uint>(OpticalNumSessionsProperty, [d] {
+        return d->dbus->opticalNumSessions();
+    });
 }
 
 uint DDiskDevice::opticalNumTracks() const
 {
-    return d_ptr->dbus->opticalNumTracks();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<uint>(OpticalNumTracksProperty, [d] {
+        return d->dbus->opticalNumTracks();
+    });
 }
 
 bool DDiskDevice::removable() const
 {
-    return d_ptr->dbus->removable();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<bool>(RemovableProperty, [d] {
+        return d->dbus->removable();
+    });
 }
 
 QString DDiskDevice::revision() const
 {
-    return d_ptr->dbus->revision();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<QString>(RevisionProperty, [d] {
+        return d->dbus->revision();
+    });
 }
 
 int DDiskDevice::rotationRate() const
 {
-    return d_ptr->dbus->rotationRate();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<int>(RotationRateProperty, [d] {
+        return d->dbus->rotationRate();
+    });
 }
 
 QString DDiskDevice::seat() const
 {
-    return d_ptr->dbus->seat();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<QString>(SeatProperty, [d] {
+        return d->dbus->seat();
+    });
 }
 
 QString DDiskDevice::serial() const
 {
-    return d_ptr->dbus->serial();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<QString>(SerialProperty, [d] {
+        return d->dbus->serial();
+    });
 }
 
 QString DDiskDevice::siblingId() const
 {
-    return d_ptr->dbus->siblingId();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<QString>(SiblingIdProperty, [d] {
+        return d->dbus->siblingId();
+    });
 }
 
 qulonglong DDiskDevice::size() const
 {
-    return d_ptr->dbus->size();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<qulonglong>(SizeProperty, [d] {
+        return d->dbus->size();
+    });
 }
 
 QString DDiskDevice::sortKey() const
 {
-    return d_ptr->dbus->sortKey();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<QString>(SortKeyProperty, [d] {
+        return d->dbus->sortKey();
+    });
 }
 
 qulonglong DDiskDevice::timeDetected() const
 {
-    return d_ptr->dbus->timeDetected();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<qulonglong>(TimeDetectedProperty, [d] {
+        return d->dbus->timeDetected();
+    });
 }
 
 qulonglong DDiskDevice::timeMediaDetected() const
 {
-    return d_ptr->dbus->timeMediaDetected();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<qulonglong>(TimeMediaDetectedProperty, [d] {
+        return d->dbus->timeMediaDetected();
+    });
 }
 
 QString DDiskDevice::vendor() const
 {
-    return d_ptr->dbus->vendor();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<QString>(VendorProperty, [d] {
+        return d->dbus->vendor();
+    });
 }
 
 QString DDiskDevice::WWN() const
 {
-    return d_ptr->dbus->wWN();
+    Q_D(const DDiskDevice);
+
+    return d->cachedValue<QString>(WWNProperty, [d] {
+        return d->dbus->wWN();
+    });
+}
+
+bool DDiskDevice::watchChanges() const
+{
+    Q_D(const DDiskDevice);
+
+    return d->watchChanges;
+}
+
+void DDiskDevice::setWatchChanges(bool watchChanges)
+{
+    Q_D(DDiskDevice);
+
+    if (d->watchChanges == watchChanges)
+        return;
+
+    d->watchChanges = watchChanges;
+
+    const QDBusConnection &connection = d->dbus->connection();
+
+    if (watchChanges) {
+        DPropertiesDispatcher::instance(connection)->subscribe(d->dbus->path(), this, [this] (const QString &interface, const QVariantMap &changed_properties,
+                                                                                              const QStringList &invalidated_properties) {
+            onPropertiesChanged(interface, changed_properties, invalidated_properties);
+        });
+        connect(UDisks2::serviceWatcher(connection), &QDBusServiceWatcher::serviceOwnerChanged,
+                this, &DDiskDevice::onServiceOwnerChanged);
+    } else {
+        DPropertiesDispatcher::instance(connection)->unsubscribe(d->dbus->path(), this);
+        disconnect(UDisks2::serviceWatcher(connection), &QDBusServiceWatcher::serviceOwnerChanged,
+                   this, &DDiskDevice::onServiceOwnerChanged);
+
+        d->cache.clear();
+    }
+}
+
+void DDiskDevice::onPropertiesChanged(const QString &interface, const QVariantMap &changed_properties, const QStringList &invalidated_properties)
+{
+    Q_D(DDiskDevice);
+
+    if (interface != QStringLiteral(UDISKS2_SERVICE ".Drive"))
+        return;
+
+    QSet<PropertyId> changed;
+
+    for (auto begin = changed_properties.constBegin(); begin != changed_properties.constEnd(); ++begin) {
+        const PropertyEntry *entry = findPropertyEntry(begin.key());
+
+        if (!entry)
+            continue;
+
+        const QVariant &value = UDisks2::demarshal(begin.value());
+        auto cached = d->cache.find(entry->id);
+
+        if (cached != d->cache.end()) {
+            if (UDisks2::valueEquals(cached.value(), value))
+                continue;
+
+            cached.value() = value;
+        } else {
+            d->cache.insert(entry->id, value);
+        }
+
+        changed.insert(entry->id);
+        emitNotifySignal(this, entry, value);
+    }
+
+    for (const QString &name : invalidated_properties) {
+        const PropertyEntry *entry = findPropertyEntry(name);
+
+        if (!entry)
+            continue;
+
+        // the new value isn't in the message, the getter fetches it again and caches it
+        const QVariant &old = d->cache.take(entry->id);
+        const QMetaProperty &mp = staticMetaObject.property(staticMetaObject.indexOfProperty(entry->qtProperty));
+        const QVariant &value = mp.read(this);
+
+        if (old.isValid() && UDisks2::valueEquals(old, d->cache.value(entry->id)))
+            continue;
+
+        changed.insert(entry->id);
+        emitNotifySignal(this, entry, value);
+    }
+
+    if (!changed.isEmpty()) {
+        Q_EMIT this->changed(changed);
+    }
+}
+
+// udisksd was restarted, the object path stays valid but the cached values may be stale
+void DDiskDevice::onServiceOwnerChanged(const QString &service, const QString &oldOwner, const QString &newOwner)
+{
+    Q_UNUSED(service)
+    Q_UNUSED(oldOwner)
+    Q_UNUSED(newOwner)
+
+    Q_D(DDiskDevice);
+
+    d->cache.clear();
 }
 
 QDBusError DDiskDevice::lastError() const
@@ -182,6 +504,13 @@ QDBusError DDiskDevice::lastError() const
     return d->err;
 }
 
+QDBusConnection DDiskDevice::connection() const
+{
+    Q_D(const DDiskDevice);
+
+    return d->dbus->connection();
+}
+
 void DDiskDevice::eject(const QVariantMap &options)
 {
     Q_D(DDiskDevice);
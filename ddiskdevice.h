@@ -6,7 +6,9 @@
 #define DDISKDEVICE_H
 
 #include <QObject>
+#include <QSet>
 #include <QVariantMap>
+#include <QDBusConnection>
 #include <QDBusError>
 
 class DDiskDevicePrivate;
@@ -16,38 +18,76 @@ class DDiskDevice : public QObject
     Q_DECLARE_PRIVATE(DDiskDevice)
 
     Q_PROPERTY(QString path READ path CONSTANT FINAL)
-    Q_PROPERTY(bool canPowerOff READ canPowerOff CONSTANT FINAL)
-    Q_PROPERTY(QVariantMap configuration READ configuration CONSTANT FINAL)
-    Q_PROPERTY(QString connectionBus READ connectionBus CONSTANT FINAL)
-    Q_PROPERTY(bool ejectable READ ejectable CONSTANT FINAL)
-    Q_PROPERTY(QString id READ id CONSTANT FINAL)
-    Q_PROPERTY(QString media READ media CONSTANT FINAL)
-    Q_PROPERTY(bool mediaAvailable READ mediaAvailable CONSTANT FINAL)
-    Q_PROPERTY(bool mediaChangeDetected READ mediaChangeDetected CONSTANT FINAL)
-    Q_PROPERTY(QStringList mediaCompatibility READ mediaCompatibility CONSTANT FINAL)
-    Q_PROPERTY(bool mediaRemovable READ mediaRemovable CONSTANT FINAL)
-    Q_PROPERTY(QString model READ model CONSTANT FINAL)
-    Q_PROPERTY(bool optical READ optical CONSTANT FINAL)
-    Q_PROPERTY(bool opticalBlank READ opticalBlank CONSTANT FINAL)
-    Q_PROPERTY(uint opticalNumAudioTracks READ opticalNumAudioTracks CONSTANT FINAL)
-    Q_PROPERTY(uint opticalNumDataTracks READ opticalNumDataTracks CONSTANT FINAL)
-    Q_PROPERTY(uint opticalNumSessions READ opticalNumSessions CONSTANT FINAL)
-    Q_PROPERTY(uint opticalNumTracks READ opticalNumTracks CONSTANT FINAL)
-    Q_PROPERTY(bool removable READ removable CONSTANT FINAL)
-    Q_PROPERTY(QString revision READ revision CONSTANT FINAL)
-    Q_PROPERTY(int rotationRate READ rotationRate CONSTANT FINAL)
-    Q_PROPERTY(QString seat READ seat CONSTANT FINAL)
-    Q_PROPERTY(QString serial READ serial CONSTANT FINAL)
-    Q_PROPERTY(QString siblingId READ siblingId CONSTANT FINAL)
-    Q_PROPERTY(qulonglong size READ size CONSTANT FINAL)
-    Q_PROPERTY(QString sortKey READ sortKey CONSTANT FINAL)
-    Q_PROPERTY(qulonglong timeDetected READ timeDetected CONSTANT FINAL)
-    Q_PROPERTY(qulonglong timeMediaDetected READ timeMediaDetected CONSTANT FINAL)
-    Q_PROPERTY(QString vendor READ vendor CONSTANT FINAL)
-    Q_PROPERTY(QString WWN READ WWN CONSTANT FINAL)
+    Q_PROPERTY(bool watchChanges READ watchChanges WRITE setWatchChanges)
+    Q_PROPERTY(bool canPowerOff READ canPowerOff NOTIFY canPowerOffChanged)
+    Q_PROPERTY(QVariantMap configuration READ configuration NOTIFY configurationChanged)
+    Q_PROPERTY(QString connectionBus READ connectionBus NOTIFY connectionBusChanged)
+    Q_PROPERTY(bool ejectable READ ejectable NOTIFY ejectableChanged)
+    Q_PROPERTY(QString id READ id NOTIFY idChanged)
+    Q_PROPERTY(QString media READ media NOTIFY mediaChanged)
+    Q_PROPERTY(bool mediaAvailable READ mediaAvailable NOTIFY mediaAvailableChanged)
+    Q_PROPERTY(bool mediaChangeDetected READ mediaChangeDetected NOTIFY mediaChangeDetectedChanged)
+    Q_PROPERTY(QStringList mediaCompatibility READ mediaCompatibility NOTIFY mediaCompatibilityChanged)
+    Q_PROPERTY(bool mediaRemovable READ mediaRemovable NOTIFY mediaRemovableChanged)
+    Q_PROPERTY(QString model READ model NOTIFY modelChanged)
+    Q_PROPERTY(bool optical READ optical NOTIFY opticalChanged)
+    Q_PROPERTY(bool opticalBlank READ opticalBlank NOTIFY opticalBlankChanged)
+    Q_PROPERTY(uint opticalNumAudioTracks READ opticalNumAudioTracks NOTIFY opticalNumAudioTracksChanged)
+    Q_PROPERTY(uint opticalNumDataTracks READ opticalNumDataTracks NOTIFY opticalNumDataTracksChanged)
+    Q_PROPERTY(uint opticalNumSessions READ opticalNumSessions NOTIFY opticalNumSessionsChanged)
+    Q_PROPERTY(uint opticalNumTracks READ opticalNumTracks NOTIFY opticalNumTracksChanged)
+    Q_PROPERTY(bool removable READ removable NOTIFY removableChanged)
+    Q_PROPERTY(QString revision READ revision NOTIFY revisionChanged)
+    Q_PROPERTY(int rotationRate READ rotationRate NOTIFY rotationRateChanged)
+    Q_PROPERTY(QString seat READ seat NOTIFY seatChanged)
+    Q_PROPERTY(QString serial READ serial NOTIFY serialChanged)
+    Q_PROPERTY(QString siblingId READ siblingId NOTIFY siblingIdChanged)
+    Q_PROPERTY(qulonglong size READ size NOTIFY sizeChanged)
+    Q_PROPERTY(QString sortKey READ sortKey NOTIFY sortKeyChanged)
+    Q_PROPERTY(qulonglong timeDetected READ timeDetected NOTIFY timeDetectedChanged)
+    Q_PROPERTY(qulonglong timeMediaDetected READ timeMediaDetected NOTIFY timeMediaDetectedChanged)
+    Q_PROPERTY(QString vendor READ vendor NOTIFY vendorChanged)
+    Q_PROPERTY(QString WWN READ WWN NOTIFY WWNChanged)
 
 public:
+    enum PropertyId {
+        InvalidProperty,
+        CanPowerOffProperty,
+        ConfigurationProperty,
+        ConnectionBusProperty,
+        EjectableProperty,
+        IdProperty,
+        MediaProperty,
+        MediaAvailableProperty,
+        MediaChangeDetectedProperty,
+        MediaCompatibilityProperty,
+        MediaRemovableProperty,
+        ModelProperty,
+        OpticalProperty,
+        OpticalBlankProperty,
+        OpticalNumAudioTracksProperty,
+        OpticalNumDataTracksProperty,
+        OpticalNumSessionsProperty,
+        OpticalNumTracksProperty,
+        RemovableProperty,
+        RevisionProperty,
+        RotationRateProperty,
+        SeatProperty,
+        SerialProperty,
+        SiblingIdProperty,
+        SizeProperty,
+        SortKeyProperty,
+        TimeDetectedProperty,
+        TimeMediaDetectedProperty,
+        VendorProperty,
+        WWNProperty
+    };
+
+    Q_ENUM(PropertyId)
+
     ~DDiskDevice();
+
+    bool watchChanges() const;
     QString path() const;
     bool canPowerOff() const;
     QVariantMap configuration() const;
@@ -80,18 +120,60 @@ public:
     QString WWN() const;
 
     QDBusError lastError() const;
+    QDBusConnection connection() const;
+
+public Q_SLOTS:
+    void setWatchChanges(bool watchChanges);
 
 public Q_SLOTS: // METHODS
     void eject(const QVariantMap &options);
     void powerOff(const QVariantMap &options);
     void setConfiguration(const QVariantMap &value, const QVariantMap &options);
 
+Q_SIGNALS:
+    void canPowerOffChanged(bool canPowerOff);
+    void configurationChanged(QVariantMap configuration);
+    void connectionBusChanged(QString connectionBus);
+    void ejectableChanged(bool ejectable);
+    void idChanged(QString id);
+    void mediaChanged(QString media);
+    void mediaAvailableChanged(bool mediaAvailable);
+    void mediaChangeDetectedChanged(bool mediaChangeDetected);
+    void mediaCompatibilityChanged(QStringList mediaCompatibility);
+    void mediaRemovableChanged(bool mediaRemovable);
+    void modelChanged(QString model);
+    void opticalChanged(bool optical);
+    void opticalBlankChanged(bool opticalBlank);
+    void opticalNumAudioTracksChanged(uint opticalNumAudioTracks);
+    void opticalNumDataTracksChanged(uint opticalNumDataTracks);
+    void opticalNumSessionsChanged(uint opticalNumSessions);
+    void opticalNumTracksChanged(uint opticalNumTracks);
+    void removableChanged(bool removable);
+    void revisionChanged(QString revision);
+    void rotationRateChanged(int rotationRate);
+    void seatChanged(QString seat);
+    void serialChanged(QString serial);
+    void siblingIdChanged(QString siblingId);
+    void sizeChanged(qulonglong size);
+    void sortKeyChanged(QString sortKey);
+    void timeDetectedChanged(qulonglong timeDetected);
+    void timeMediaDetectedChanged(qulonglong timeMediaDetected);
+    void vendorChanged(QString vendor);
+    void WWNChanged(QString WWN);
+    // emitted once per PropertiesChanged message, only contains the properties whose value really changed
+    void changed(const QSet<DDiskDevice::PropertyId> &properties);
+
 private:
     explicit DDiskDevice(const QString &path, QObject *parent = nullptr);
+    explicit DDiskDevice(const QString &path, const QDBusConnection &connection, QObject *parent = nullptr);
 
     QScopedPointer<DDiskDevicePrivate> d_ptr;
 
     friend class DDiskManager;
+
+private Q_SLOTS:
+    void onPropertiesChanged(const QString &interface, const QVariantMap &changed_properties, const QStringList &invalidated_properties);
+    void onServiceOwnerChanged(const QString &service, const QString &oldOwner, const QString &newOwner);
 };
 
 #endif // DDISKDEVICE_H
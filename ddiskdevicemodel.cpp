@@ -0,0 +1,375 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "ddiskdevicemodel.h"
+#include "ddiskmanager.h"
+#include "dblockdeviceinfo.h"
+#include "udisks2_dbus_common.h"
+
+#include <algorithm>
+
+class DDiskDeviceModelPrivate
+{
+public:
+    explicit DDiskDeviceModelPrivate(DDiskDeviceModel *qq)
+        : q_ptr(qq)
+    {
+
+    }
+
+    int rowOf(const QString &path) const;
+    const DBlockDeviceInfo &info(int row) const;
+    void emitChanged(const QString &path, const QVector<int> &roles);
+
+    DDiskManager *manager = nullptr;
+    // sorted by path, rows are found by binary search
+    QStringList paths;
+    // of the row, invalid until data() needs it and again after a change of the device
+    mutable QVector<DBlockDeviceInfo> infos;
+
+    DDiskDeviceModel *q_ptr;
+
+    Q_DECLARE_PUBLIC(DDiskDeviceModel)
+};
+
+int DDiskDeviceModelPrivate::rowOf(const QString &path) const
+{
+    auto it = std::lower_bound(paths.constBegin(), paths.constEnd(), path);
+
+    if (it == paths.constEnd() || *it != path)
+        return -1;
+
+    return static_cast<int>(it - paths.constBegin());
+}
+
+// the manager builds the info from all the interfaces of the device, once per change
+const DBlockDeviceInfo &DDiskDeviceModelPrivate::info(int row) const
+{
+    DBlockDeviceInfo &info = infos[row];
+
+    if (!info.isValid())
+        info = manager->blockDeviceInfo(paths.at(row));
+
+    return info;
+}
+
+void DDiskDeviceModelPrivate::emitChanged(const QString &path, const QVector<int> &roles)
+{
+    Q_Q(DDiskDeviceModel);
+
+    const int row = rowOf(path);
+
+    if (row < 0)
+        return;
+
+    infos[row] = DBlockDeviceInfo();
+
+    const QModelIndex &index = q->index(row);
+
+    Q_EMIT q->dataChanged(index, index, roles);
+}
+
+// "<interface suffix>.<property>" -> role, for the notifications of DDiskManager::propertiesChanged
+static const QHash<QString, int> &propertyRoles()
+{
+    static const QHash<QString, int> roles {
+        {"Block.Device", DDiskDeviceModel::DeviceRole},
+        {"Block.PreferredDevice", DDiskDeviceModel::DeviceRole},
+        {"Block.Drive", DDiskDeviceModel::DriveRole},
+        {"Block.IdLabel", DDiskDeviceModel::IdLabelRole},
+        {"Block.IdType", DDiskDeviceModel::IdTypeRole},
+        {"Block.IdUUID", DDiskDeviceModel::IdUUIDRole},
+        {"Block.IdUsage", DDiskDeviceModel::IdUsageRole},
+        {"Block.Size", DDiskDeviceModel::SizeRole},
+        {"Block.ReadOnly", DDiskDeviceModel::ReadOnlyRole},
+        {"Block.HintIgnore", DDiskDeviceModel::HintIgnoreRole},
+        {"Block.HintSystem", DDiskDeviceModel::HintSystemRole},
+        {"Block.HintName", DDiskDeviceModel::HintNameRole},
+        {"Block.HintIconName", DDiskDeviceModel::HintIconNameRole},
+        {"Block.CryptoBackingDevice", DDiskDeviceModel::CryptoBackingDeviceRole},
+        {"Filesystem.MountPoints", DDiskDeviceModel::MountPointsRole},
+        {"Encrypted.CleartextDevice", DDiskDeviceModel::CleartextDeviceRole}
+    };
+
+    return roles;
+}
+
+/*!
+ * \class DDiskDeviceModel
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief A list model of the block devices, one row per device.
+ *
+ * The rows follow the signals of DDiskManager: a device added or removed
+ * inserts or removes only its row, and a property change emits dataChanged()
+ * for that row with only the affected roles, as does an interface gained or
+ * lost by an existing device. data() reads the state kept by the manager and
+ * never calls UDisks2; the DBlockDeviceInfo of a row is built once and again
+ * only after a change of the device.
+ *
+ * \sa DDiskManager::blockDeviceInfo()
+ */
+
+DDiskDeviceModel::DDiskDeviceModel(QObject *parent)
+    : DDiskDeviceModel(new DDiskManager(), parent)
+{
+    d_ptr->manager->setParent(this);
+}
+
+DDiskDeviceModel::DDiskDeviceModel(DDiskManager *manager, QObject *parent)
+    : QAbstractListModel(parent)
+    , d_ptr(new DDiskDeviceModelPrivate(this))
+{
+    Q_D(DDiskDeviceModel);
+
+    d->manager = manager;
+    manager->setWatchChanges(true);
+
+    connect(manager, &DDiskManager::blockDeviceAdded, this, &DDiskDeviceModel::onBlockDeviceAdded);
+    connect(manager, &DDiskManager::blockDeviceRemoved, this, &DDiskDeviceModel::onBlockDeviceRemoved);
+    connect(manager, &DDiskManager::fileSystemAdded, this, &DDiskDeviceModel::onFileSystemChanged);
+    connect(manager, &DDiskManager::fileSystemRemoved, this, &DDiskDeviceModel::onFileSystemChanged);
+    connect(manager, &DDiskManager::propertiesChanged, this, &DDiskDeviceModel::onPropertiesChanged);
+    connect(manager, &DDiskManager::interfacesAdded, this, &DDiskDeviceModel::onInterfacesChanged);
+    connect(manager, &DDiskManager::interfacesRemoved, this, &DDiskDeviceModel::onInterfacesChanged);
+
+    QList<DBlockDeviceInfo> infos = manager->blockDeviceInfoList();
+
+    std::sort(infos.begin(), infos.end(), [] (const DBlockDeviceInfo &info1, const DBlockDeviceInfo &info2) {
+        return info1.path() < info2.path();
+    });
+
+    for (const DBlockDeviceInfo &info : infos) {
+        d->paths << info.path();
+        d->infos << info;
+    }
+}
+
+DDiskDeviceModel::~DDiskDeviceModel()
+{
+
+}
+
+DDiskManager *DDiskDeviceModel::manager() const
+{
+    Q_D(const DDiskDeviceModel);
+
+    return d->manager;
+}
+
+QModelIndex DDiskDeviceModel::indexOf(const QString &blockDevicePath) const
+{
+    Q_D(const DDiskDeviceModel);
+
+    const int row = d->rowOf(blockDevicePath);
+
+    return row < 0 ? QModelIndex() : index(row);
+}
+
+QString DDiskDeviceModel::pathOf(const QModelIndex &index) const
+{
+    Q_D(const DDiskDeviceModel);
+
+    if (!index.isValid() || index.model() != this || index.row() >= d->paths.count())
+        return QString();
+
+    return d->paths.at(index.row());
+}
+
+int DDiskDeviceModel::rowCount(const QModelIndex &parent) const
+{
+    Q_D(const DDiskDeviceModel);
+
+    return parent.isValid() ? 0 : d->paths.count();
+}
+
+QVariant DDiskDeviceModel::data(const QModelIndex &index, int role) const
+{
+    Q_D(const DDiskDeviceModel);
+
+    const QString &path = pathOf(index);
+
+    if (path.isEmpty())
+        return QVariant();
+
+    if (role == PathRole)
+        return path;
+
+    // 设备状态由 DDiskManager 维护，这里不会有 D-Bus 调用
+    const DBlockDeviceInfo &info = d->info(index.row());
+
+    switch (role) {
+    case Qt::DisplayRole: {
+        if (!info.hintName().isEmpty())
+            return info.hintName();
+
+        if (!info.idLabel().isEmpty())
+            return info.idLabel();
+
+        QByteArray device = info.preferredDevice();
+
+        if (device.endsWith('\0'))
+            device.chop(1);
+
+        return QString::fromLocal8Bit(device);
+    }
+    case InfoRole:
+        return QVariant::fromValue(info);
+    case DeviceRole:
+        return info.device();
+    case DriveRole:
+        return info.drive();
+    case IdLabelRole:
+        return info.idLabel();
+    case IdTypeRole:
+        return info.idType();
+    case IdUUIDRole:
+        return info.idUUID();
+    case IdUsageRole:
+        return info.idUsage();
+    case SizeRole:
+        return info.size();
+    case ReadOnlyRole:
+        return info.readOnly();
+    case HintIgnoreRole:
+        return info.hintIgnore();
+    case HintSystemRole:
+        return info.hintSystem();
+    case HintNameRole:
+        return info.hintName();
+    case HintIconNameRole:
+        return info.hintIconName();
+    case CryptoBackingDeviceRole:
+        return info.cryptoBackingDevice();
+    case HasFileSystemRole:
+        return info.hasFileSystem();
+    case MountPointsRole:
+        return QVariant::fromValue(info.mountPoints());
+    case IsEncryptedRole:
+        return info.isEncrypted();
+    case CleartextDeviceRole:
+        return info.cleartextDevice();
+    default:
+        break;
+    }
+
+    return QVariant();
+}
+
+QHash<int, QByteArray> DDiskDeviceModel::roleNames() const
+{
+    QHash<int, QByteArray> names = QAbstractListModel::roleNames();
+
+    names[PathRole] = "path";
+    names[InfoRole] = "info";
+    names[DeviceRole] = "device";
+    names[DriveRole] = "drive";
+    names[IdLabelRole] = "idLabel";
+    names[IdTypeRole] = "idType";
+    names[IdUUIDRole] = "idUUID";
+    names[IdUsageRole] = "idUsage";
+    names[SizeRole] = "size";
+    names[ReadOnlyRole] = "readOnly";
+    names[HintIgnoreRole] = "hintIgnore";
+    names[HintSystemRole] = "hintSystem";
+    names[HintNameRole] = "hintName";
+    names[HintIconNameRole] = "hintIconName";
+    names[CryptoBackingDeviceRole] = "cryptoBackingDevice";
+    names[HasFileSystemRole] = "hasFileSystem";
+    names[MountPointsRole] = "mountPoints";
+    names[IsEncryptedRole] = "isEncrypted";
+    names[CleartextDeviceRole] = "cleartextDevice";
+
+    return names;
+}
+
+void DDiskDeviceModel::onBlockDeviceAdded(const QString &path)
+{
+    Q_D(DDiskDeviceModel);
+
+    auto it = std::lower_bound(d->paths.begin(), d->paths.end(), path);
+
+    if (it != d->paths.end() && *it == path)
+        return;
+
+    const int row = static_cast<int>(it - d->paths.begin());
+
+    beginInsertRows(QModelIndex(), row, row);
+    d->paths.insert(row, path);
+    d->infos.insert(row, DBlockDeviceInfo());
+    endInsertRows();
+}
+
+void DDiskDeviceModel::onBlockDeviceRemoved(const QString &path)
+{
+    Q_D(DDiskDeviceModel);
+
+    const int row = d->rowOf(path);
+
+    if (row < 0)
+        return;
+
+    beginRemoveRows(QModelIndex(), row, row);
+    d->paths.removeAt(row);
+    d->infos.remove(row);
+    endRemoveRows();
+}
+
+void DDiskDeviceModel::onFileSystemChanged(const QString &path)
+{
+    Q_D(DDiskDeviceModel);
+
+    d->emitChanged(path, {InfoRole, HasFileSystemRole, MountPointsRole});
+}
+
+void DDiskDeviceModel::onPropertiesChanged(const QString &path, const QString &interface, const QStringList &properties)
+{
+    Q_D(DDiskDeviceModel);
+
+    static const QString prefix = QStringLiteral(UDISKS2_SERVICE ".");
+
+    if (!interface.startsWith(prefix))
+        return;
+
+    const QString &suffix = interface.mid(prefix.length());
+    QVector<int> roles {InfoRole};
+
+    for (const QString &name : properties) {
+        const int role = propertyRoles().value(suffix + '.' + name);
+
+        if (role > 0 && !roles.contains(role))
+            roles << role;
+
+        // the display text is made of these
+        if ((role == HintNameRole || role == IdLabelRole || name == "PreferredDevice") && !roles.contains(Qt::DisplayRole))
+            roles << Qt::DisplayRole;
+    }
+
+    d->emitChanged(path, roles);
+}
+
+// An existing device gaining or losing an interface, like Encrypted after a format
+void DDiskDeviceModel::onInterfacesChanged(const QString &path, const QStringList &interfaces)
+{
+    Q_D(DDiskDeviceModel);
+
+    static const QString prefix = QStringLiteral(UDISKS2_SERVICE ".");
+    QVector<int> roles {InfoRole};
+
+    for (const QString &interface : interfaces) {
+        const QString &suffix = interface.mid(prefix.length());
+
+        // the row itself is inserted or removed by blockDeviceAdded() and blockDeviceRemoved()
+        if (suffix == "Block")
+            return;
+
+        if (suffix == "Encrypted") {
+            roles << IsEncryptedRole << CleartextDeviceRole;
+        } else if (suffix == "Filesystem") {
+            roles << HasFileSystemRole << MountPointsRole;
+        }
+    }
+
+    d->emitChanged(path, roles);
+}
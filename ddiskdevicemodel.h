@@ -0,0 +1,67 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DDISKDEVICEMODEL_H
+#define DDISKDEVICEMODEL_H
+
+#include <QAbstractListModel>
+
+class DDiskManager;
+class DDiskDeviceModelPrivate;
+class DDiskDeviceModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(DDiskDeviceModel)
+
+public:
+    enum Role {
+        PathRole = Qt::UserRole + 1,
+        InfoRole, // DBlockDeviceInfo
+        DeviceRole,
+        DriveRole,
+        IdLabelRole,
+        IdTypeRole,
+        IdUUIDRole,
+        IdUsageRole,
+        SizeRole,
+        ReadOnlyRole,
+        HintIgnoreRole,
+        HintSystemRole,
+        HintNameRole,
+        HintIconNameRole,
+        CryptoBackingDeviceRole,
+        HasFileSystemRole,
+        MountPointsRole,
+        IsEncryptedRole,
+        CleartextDeviceRole
+    };
+
+    Q_ENUM(Role)
+
+    explicit DDiskDeviceModel(QObject *parent = nullptr);
+    // manager must outlive the model, its changes are watched from now on
+    explicit DDiskDeviceModel(DDiskManager *manager, QObject *parent = nullptr);
+    ~DDiskDeviceModel();
+
+    DDiskManager *manager() const;
+
+    QModelIndex indexOf(const QString &blockDevicePath) const;
+    QString pathOf(const QModelIndex &index) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+private:
+    QScopedPointer<DDiskDeviceModelPrivate> d_ptr;
+
+private Q_SLOTS:
+    void onBlockDeviceAdded(const QString &path);
+    void onBlockDeviceRemoved(const QString &path);
+    void onFileSystemChanged(const QString &path);
+    void onPropertiesChanged(const QString &path, const QString &interface, const QStringList &properties);
+    void onInterfacesChanged(const QString &path, const QStringList &interfaces);
+};
+
+#endif // DDISKDEVICEMODEL_H
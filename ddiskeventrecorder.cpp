@@ -0,0 +1,137 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "ddiskeventrecorder.h"
+#include "ddiskmanager.h"
+#include "private/ddiskeventjournal_p.h"
+
+#include <QFile>
+#include <QPointer>
+
+class DDiskEventRecorderPrivate
+{
+public:
+    QPointer<DDiskManager> manager;
+    QScopedPointer<QFile> file; // when recording to a file name
+    QIODevice *device = nullptr;
+    QScopedPointer<DDiskEventWriter> writer;
+    int eventCount = 0;
+    QString errorString;
+};
+
+/*!
+ * \class DDiskEventRecorder
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief Records the UDisks2 notifications received by a DDiskManager in a binary journal.
+ *
+ * The journal starts with the objects known when recording starts, followed by
+ * every InterfacesAdded, InterfacesRemoved, PropertiesChanged and owner change
+ * of org.freedesktop.UDisks2 with its time, as the manager received them. The
+ * strings are written once and then referred to by index, so a hotplug storm
+ * takes little space. DDiskEventReplayer feeds a journal back to a manager.
+ *
+ * \sa DDiskEventReplayer
+ */
+
+DDiskEventRecorder::DDiskEventRecorder(DDiskManager *manager, QObject *parent)
+    : QObject(parent)
+    , d_ptr(new DDiskEventRecorderPrivate)
+{
+    d_ptr->manager = manager;
+}
+
+DDiskEventRecorder::~DDiskEventRecorder()
+{
+    stop();
+}
+
+bool DDiskEventRecorder::isRecording() const
+{
+    Q_D(const DDiskEventRecorder);
+
+    return !d->writer.isNull();
+}
+
+int DDiskEventRecorder::eventCount() const
+{
+    Q_D(const DDiskEventRecorder);
+
+    return d->writer ? d->writer->eventCount() : d->eventCount;
+}
+
+QString DDiskEventRecorder::errorString() const
+{
+    Q_D(const DDiskEventRecorder);
+
+    return d->errorString;
+}
+
+bool DDiskEventRecorder::start(const QString &fileName)
+{
+    Q_D(DDiskEventRecorder);
+
+    stop();
+
+    QScopedPointer<QFile> file(new QFile(fileName));
+
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        d->errorString = file->errorString();
+        return false;
+    }
+
+    if (!start(file.data())) {
+        file->remove();
+        return false;
+    }
+
+    d->file.swap(file);
+
+    return true;
+}
+
+bool DDiskEventRecorder::start(QIODevice *device)
+{
+    Q_D(DDiskEventRecorder);
+
+    stop();
+    d->errorString.clear();
+
+    if (!d->manager) {
+        d->errorString = QStringLiteral("The manager was destroyed");
+        return false;
+    }
+
+    d->writer.reset(new DDiskEventWriter(device));
+
+    if (!d->manager->addEventWriter(d->writer.data())) {
+        d->writer.reset();
+        d->errorString = device->errorString();
+        return false;
+    }
+
+    d->device = device;
+
+    return true;
+}
+
+void DDiskEventRecorder::stop()
+{
+    Q_D(DDiskEventRecorder);
+
+    if (!d->writer)
+        return;
+
+    if (d->manager)
+        d->manager->removeEventWriter(d->writer.data());
+
+    d->eventCount = d->writer->eventCount();
+    d->writer.reset();
+    d->device = nullptr;
+
+    if (d->file) {
+        d->file->close();
+        d->file.reset();
+    }
+}
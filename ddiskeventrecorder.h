@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DDISKEVENTRECORDER_H
+#define DDISKEVENTRECORDER_H
+
+#include <QObject>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+class DDiskManager;
+class DDiskEventRecorderPrivate;
+class DDiskEventRecorder : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(DDiskEventRecorder)
+
+public:
+    // the changes of manager are watched from now on
+    explicit DDiskEventRecorder(DDiskManager *manager, QObject *parent = nullptr);
+    ~DDiskEventRecorder();
+
+    bool isRecording() const;
+    int eventCount() const;
+    QString errorString() const;
+
+    bool start(const QString &fileName);
+    // device must be open for writing and stay open until stop(), it is not owned
+    bool start(QIODevice *device);
+
+public Q_SLOTS:
+    void stop();
+
+private:
+    QScopedPointer<DDiskEventRecorderPrivate> d_ptr;
+};
+
+#endif // DDISKEVENTRECORDER_H
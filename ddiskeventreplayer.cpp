@@ -0,0 +1,225 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "ddiskeventreplayer.h"
+#include "ddiskmanager.h"
+#include "private/ddiskeventjournal_p.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QPointer>
+#include <QTimer>
+
+class DDiskEventReplayerPrivate
+{
+public:
+    explicit DDiskEventReplayerPrivate(DDiskEventReplayer *qq)
+        : q_ptr(qq)
+    {
+
+    }
+
+    void next();
+    void finish(bool success);
+
+    QPointer<DDiskManager> manager;
+    QScopedPointer<QFile> file;
+    QScopedPointer<DDiskEventReader> reader;
+    DDiskEvent pending;
+    bool hasPending = false;
+    qreal speed = 1;
+    QTimer timer;
+    QElapsedTimer clock;
+    int eventCount = 0;
+    QString errorString;
+
+    DDiskEventReplayer *q_ptr;
+
+    Q_DECLARE_PUBLIC(DDiskEventReplayer)
+};
+
+// Replays the events due now, then waits for the next one
+void DDiskEventReplayerPrivate::next()
+{
+    while (reader) {
+        if (!hasPending) {
+            if (reader->atEnd()) {
+                finish(true);
+                return;
+            }
+
+            if (!reader->read(&pending)) {
+                errorString = reader->errorString;
+                finish(false);
+                return;
+            }
+
+            hasPending = true;
+        }
+
+        if (speed > 0) {
+            const qint64 wait = static_cast<qint64>(pending.time / 1000 / speed) - clock.elapsed();
+
+            if (wait > 0) {
+                timer.start(static_cast<int>(qMin<qint64>(wait, std::numeric_limits<int>::max())));
+                return;
+            }
+        }
+
+        if (!manager) {
+            errorString = QStringLiteral("The manager was destroyed");
+            finish(false);
+            return;
+        }
+
+        hasPending = false;
+        ++eventCount;
+        // may stop() from a slot connected to the manager
+        manager->replayEvent(pending);
+    }
+}
+
+void DDiskEventReplayerPrivate::finish(bool success)
+{
+    Q_Q(DDiskEventReplayer);
+
+    timer.stop();
+    reader.reset();
+    hasPending = false;
+    pending = DDiskEvent();
+
+    if (file) {
+        file->close();
+        file.reset();
+    }
+
+    Q_EMIT q->finished(success);
+}
+
+/*!
+ * \class DDiskEventReplayer
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief Feeds a journal of DDiskEventRecorder back into a DDiskManager.
+ *
+ * The manager handles every event like the notification it was recorded from,
+ * with the same signals, so the event handling of the manager and of its users
+ * can be profiled and tested without the devices. The events keep their
+ * original timing, scaled by speed(), or are replayed in one go with a speed
+ * of 0. The manager must not watch the changes of UDisks2 itself, the first
+ * event of the journal makes it watch the recorded objects instead; reset it
+ * with DDiskManager::setWatchChanges(false) before replaying again.
+ *
+ * \sa DDiskEventRecorder
+ */
+
+DDiskEventReplayer::DDiskEventReplayer(DDiskManager *manager, QObject *parent)
+    : QObject(parent)
+    , d_ptr(new DDiskEventReplayerPrivate(this))
+{
+    Q_D(DDiskEventReplayer);
+
+    d->manager = manager;
+    d->timer.setSingleShot(true);
+    d->timer.setTimerType(Qt::PreciseTimer);
+    connect(&d->timer, &QTimer::timeout, this, [d] {
+        d->next();
+    });
+}
+
+DDiskEventReplayer::~DDiskEventReplayer()
+{
+
+}
+
+qreal DDiskEventReplayer::speed() const
+{
+    Q_D(const DDiskEventReplayer);
+
+    return d->speed;
+}
+
+bool DDiskEventReplayer::isRunning() const
+{
+    Q_D(const DDiskEventReplayer);
+
+    return !d->reader.isNull();
+}
+
+int DDiskEventReplayer::eventCount() const
+{
+    Q_D(const DDiskEventReplayer);
+
+    return d->eventCount;
+}
+
+QString DDiskEventReplayer::errorString() const
+{
+    Q_D(const DDiskEventReplayer);
+
+    return d->errorString;
+}
+
+bool DDiskEventReplayer::start(const QString &fileName)
+{
+    Q_D(DDiskEventReplayer);
+
+    stop();
+
+    QScopedPointer<QFile> file(new QFile(fileName));
+
+    if (!file->open(QIODevice::ReadOnly)) {
+        d->errorString = file->errorString();
+        return false;
+    }
+
+    if (!start(file.data()))
+        return false;
+
+    d->file.swap(file);
+
+    return true;
+}
+
+bool DDiskEventReplayer::start(QIODevice *device)
+{
+    Q_D(DDiskEventReplayer);
+
+    stop();
+    d->errorString.clear();
+    d->eventCount = 0;
+
+    if (!d->manager || d->manager->watchChanges()) {
+        d->errorString = QStringLiteral("The manager must exist and not watch changes");
+        return false;
+    }
+
+    QScopedPointer<DDiskEventReader> reader(new DDiskEventReader(device));
+
+    if (!reader->readHeader()) {
+        d->errorString = reader->errorString;
+        return false;
+    }
+
+    d->reader.swap(reader);
+    d->clock.start();
+    d->timer.start(0);
+
+    return true;
+}
+
+void DDiskEventReplayer::setSpeed(qreal speed)
+{
+    Q_D(DDiskEventReplayer);
+
+    d->speed = qMax<qreal>(0, speed);
+}
+
+void DDiskEventReplayer::stop()
+{
+    Q_D(DDiskEventReplayer);
+
+    if (d->reader)
+        d->finish(false);
+}
@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DDISKEVENTREPLAYER_H
+#define DDISKEVENTREPLAYER_H
+
+#include <QObject>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+class DDiskManager;
+class DDiskEventReplayerPrivate;
+class DDiskEventReplayer : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(DDiskEventReplayer)
+
+    Q_PROPERTY(qreal speed READ speed WRITE setSpeed)
+
+public:
+    // manager must not watch changes, its state comes only from the journal
+    explicit DDiskEventReplayer(DDiskManager *manager, QObject *parent = nullptr);
+    ~DDiskEventReplayer();
+
+    // 1 is the original timing, 2 twice faster..., 0 as fast as possible
+    qreal speed() const;
+    bool isRunning() const;
+    int eventCount() const; // replayed so far
+    QString errorString() const;
+
+    // the events are replayed from the event loop, after start() returned
+    bool start(const QString &fileName);
+    // device must be open for reading and stay open until finished, it is not owned
+    bool start(QIODevice *device);
+
+public Q_SLOTS:
+    void setSpeed(qreal speed);
+    void stop();
+
+Q_SIGNALS:
+    // success is false if the journal is corrupted or stop() was called
+    void finished(bool success);
+
+private:
+    QScopedPointer<DDiskEventReplayerPrivate> d_ptr;
+};
+
+#endif // DDISKEVENTREPLAYER_H
@@ -0,0 +1,433 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "ddiskiomonitor.h"
+#include "ddiskmanager.h"
+#include "dblockdeviceinfo.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QTimer>
+
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/sysmacros.h>
+
+class DDiskIoMonitorPrivate
+{
+public:
+    // the fields of /proc/diskstats used, see Documentation/admin-guide/iostats.rst
+    struct Counters
+    {
+        quint64 reads = 0;
+        quint64 sectorsRead = 0;
+        quint64 writes = 0;
+        quint64 sectorsWritten = 0;
+        quint64 inFlight = 0;
+        quint64 ioMs = 0;
+        quint64 weightedMs = 0;
+    };
+
+    struct Device
+    {
+        QString path;
+        Counters last;
+        qint64 lastTime = 0;
+        int errorsFd = -1;
+        QVector<DDiskIoSample> ring;
+        int head = 0;
+        int count = 0;
+    };
+
+    explicit DDiskIoMonitorPrivate(DDiskIoMonitor *qq)
+        : q_ptr(qq)
+    {
+
+    }
+
+    ~DDiskIoMonitorPrivate();
+
+    void addDevice(const QString &path);
+    void removeDevice(const QString &path);
+    void sample();
+    void update(Device &device, const Counters &counters, qint64 now);
+    quint32 readErrors(const Device &device);
+
+    DDiskManager *manager = nullptr;
+    QString procRoot = QStringLiteral("/proc");
+    QString sysfsRoot = QStringLiteral("/sys");
+    QTimer timer;
+    int historySize = 60;
+    int statsFd = -1;
+    // reused by every sample, grows only if /proc/diskstats gets larger
+    std::vector<char> buffer = std::vector<char>(16 * 1024);
+    QHash<quint64, Device> devices; // by device number
+    QHash<QString, quint64> numbers; // block device path -> device number
+
+    DDiskIoMonitor *q_ptr;
+
+    Q_DECLARE_PUBLIC(DDiskIoMonitor)
+};
+
+DDiskIoMonitorPrivate::~DDiskIoMonitorPrivate()
+{
+    for (const Device &device : devices) {
+        if (device.errorsFd >= 0)
+            ::close(device.errorsFd);
+    }
+
+    if (statsFd >= 0)
+        ::close(statsFd);
+}
+
+void DDiskIoMonitorPrivate::addDevice(const QString &path)
+{
+    const quint64 number = manager->blockDeviceInfo(path).deviceNumber();
+
+    if (number == 0 || numbers.contains(path))
+        return;
+
+    Device &device = devices[number];
+
+    device.path = path;
+    device.ring.resize(historySize);
+
+    // only SCSI disks have it, /proc/diskstats doesn't count errors
+    const QString &errors = QStringLiteral("%1/dev/block/%2:%3/device/ioerr_cnt").arg(sysfsRoot).arg(major(number)).arg(minor(number));
+
+    device.errorsFd = ::open(errors.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    numbers.insert(path, number);
+}
+
+void DDiskIoMonitorPrivate::removeDevice(const QString &path)
+{
+    auto device = devices.find(numbers.take(path));
+
+    if (device == devices.end())
+        return;
+
+    if (device->errorsFd >= 0)
+        ::close(device->errorsFd);
+
+    devices.erase(device);
+}
+
+static inline quint64 nextNumber(const char *&p, const char *end)
+{
+    quint64 value = 0;
+
+    while (p < end && (*p == ' ' || *p == '\t'))
+        ++p;
+
+    while (p < end && *p >= '0' && *p <= '9')
+        value = value * 10 + static_cast<quint64>(*p++ - '0');
+
+    return value;
+}
+
+// No allocation here: the file is read into the same buffer and parsed in place
+void DDiskIoMonitorPrivate::sample()
+{
+    Q_Q(DDiskIoMonitor);
+
+    if (statsFd < 0) {
+        statsFd = ::open(QString(procRoot + "/diskstats").toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+
+        if (statsFd < 0)
+            return;
+    }
+
+    ssize_t size = 0;
+
+    for (;;) {
+        size = ::pread(statsFd, buffer.data(), buffer.size(), 0);
+
+        if (size < 0)
+            return;
+
+        if (static_cast<size_t>(size) < buffer.size())
+            break;
+
+        buffer.resize(buffer.size() * 2);
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const char *p = buffer.data();
+    const char *end = p + size;
+
+    while (p < end) {
+        const char *eol = static_cast<const char *>(memchr(p, '\n', static_cast<size_t>(end - p)));
+
+        if (!eol)
+            eol = end;
+
+        const quint64 major_number = nextNumber(p, eol);
+        const quint64 minor_number = nextNumber(p, eol);
+        auto device = devices.find(makedev(major_number, minor_number));
+
+        if (device != devices.end()) {
+            // skip the name
+            while (p < eol && *p == ' ')
+                ++p;
+
+            while (p < eol && *p != ' ')
+                ++p;
+
+            Counters counters;
+
+            counters.reads = nextNumber(p, eol);
+            nextNumber(p, eol); // reads merged
+            counters.sectorsRead = nextNumber(p, eol);
+            nextNumber(p, eol); // time reading
+            counters.writes = nextNumber(p, eol);
+            nextNumber(p, eol); // writes merged
+            counters.sectorsWritten = nextNumber(p, eol);
+            nextNumber(p, eol); // time writing
+            counters.inFlight = nextNumber(p, eol);
+            counters.ioMs = nextNumber(p, eol);
+            counters.weightedMs = nextNumber(p, eol);
+
+            update(*device, counters, now);
+        }
+
+        p = eol + 1;
+    }
+
+    Q_EMIT q->sampled();
+}
+
+void DDiskIoMonitorPrivate::update(Device &device, const Counters &counters, qint64 now)
+{
+    const Counters last = device.last;
+    const qint64 last_time = device.lastTime;
+
+    device.last = counters;
+    device.lastTime = now;
+
+    // the first sample is the reference of the next one
+    if (last_time == 0 || now <= last_time || device.ring.isEmpty())
+        return;
+
+    const double seconds = (now - last_time) / 1000.0;
+    const quint64 reads = counters.reads - last.reads;
+    const quint64 writes = counters.writes - last.writes;
+    DDiskIoSample &sample = device.ring[device.head];
+
+    sample.timestamp = now;
+    sample.readIops = reads / seconds;
+    sample.writeIops = writes / seconds;
+    sample.readBytesPerSecond = (counters.sectorsRead - last.sectorsRead) * 512.0 / seconds;
+    sample.writeBytesPerSecond = (counters.sectorsWritten - last.sectorsWritten) * 512.0 / seconds;
+    sample.averageQueueTime = reads + writes > 0 ? double(counters.weightedMs - last.weightedMs) / (reads + writes) : 0;
+    sample.utilization = qMin(1.0, (counters.ioMs - last.ioMs) / (seconds * 1000));
+    sample.inFlight = static_cast<quint32>(counters.inFlight);
+    sample.ioErrors = readErrors(device);
+
+    device.head = (device.head + 1) % device.ring.size();
+    device.count = qMin(device.count + 1, device.ring.size());
+}
+
+quint32 DDiskIoMonitorPrivate::readErrors(const Device &device)
+{
+    if (device.errorsFd < 0)
+        return 0;
+
+    char value[32];
+    const ssize_t size = ::pread(device.errorsFd, value, sizeof(value) - 1, 0);
+
+    if (size <= 0)
+        return 0;
+
+    value[size] = '\0';
+
+    // like "0x1a"
+    return static_cast<quint32>(strtoul(value, nullptr, 0));
+}
+
+/*!
+ * \class DDiskIoMonitor
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief Samples /proc/diskstats and keeps the I/O rates of the block devices.
+ *
+ * The devices are those of DDiskManager, matched to the lines of diskstats by
+ * their device number, so the statistics are keyed by block device path. Each
+ * device keeps the last historySize() samples in a ring buffer. Sampling reads
+ * and parses the file in a reused buffer and doesn't allocate.
+ */
+
+DDiskIoMonitor::DDiskIoMonitor(QObject *parent)
+    : DDiskIoMonitor(new DDiskManager(), parent)
+{
+    d_ptr->manager->setParent(this);
+}
+
+DDiskIoMonitor::DDiskIoMonitor(DDiskManager *manager, QObject *parent)
+    : QObject(parent)
+    , d_ptr(new DDiskIoMonitorPrivate(this))
+{
+    Q_D(DDiskIoMonitor);
+
+    d->manager = manager;
+    d->timer.setInterval(1000);
+    connect(&d->timer, &QTimer::timeout, this, [d] {
+        d->sample();
+    });
+
+    manager->setWatchChanges(true);
+    connect(manager, &DDiskManager::blockDeviceAdded, this, &DDiskIoMonitor::onBlockDeviceAdded);
+    connect(manager, &DDiskManager::blockDeviceRemoved, this, &DDiskIoMonitor::onBlockDeviceRemoved);
+
+    for (const DBlockDeviceInfo &info : manager->blockDeviceInfoList()) {
+        d->addDevice(info.path());
+    }
+
+    d->sample();
+    d->timer.start();
+}
+
+DDiskIoMonitor::~DDiskIoMonitor()
+{
+
+}
+
+int DDiskIoMonitor::interval() const
+{
+    Q_D(const DDiskIoMonitor);
+
+    return d->timer.interval();
+}
+
+int DDiskIoMonitor::historySize() const
+{
+    Q_D(const DDiskIoMonitor);
+
+    return d->historySize;
+}
+
+bool DDiskIoMonitor::isActive() const
+{
+    Q_D(const DDiskIoMonitor);
+
+    return d->timer.isActive();
+}
+
+void DDiskIoMonitor::setProcRoot(const QString &procRoot)
+{
+    Q_D(DDiskIoMonitor);
+
+    d->procRoot = procRoot;
+
+    if (d->statsFd >= 0) {
+        ::close(d->statsFd);
+        d->statsFd = -1;
+    }
+}
+
+void DDiskIoMonitor::setSysfsRoot(const QString &sysfsRoot)
+{
+    Q_D(DDiskIoMonitor);
+
+    d->sysfsRoot = sysfsRoot;
+
+    for (const QString &path : d->numbers.keys()) {
+        d->removeDevice(path);
+        d->addDevice(path);
+    }
+}
+
+QStringList DDiskIoMonitor::blockDevices() const
+{
+    Q_D(const DDiskIoMonitor);
+
+    return d->numbers.keys();
+}
+
+DDiskIoSample DDiskIoMonitor::current(const QString &blockDevicePath) const
+{
+    Q_D(const DDiskIoMonitor);
+
+    auto device = d->devices.constFind(d->numbers.value(blockDevicePath));
+
+    if (device == d->devices.constEnd() || device->count == 0)
+        return DDiskIoSample();
+
+    return device->ring.at((device->head + device->ring.size() - 1) % device->ring.size());
+}
+
+QVector<DDiskIoSample> DDiskIoMonitor::history(const QString &blockDevicePath) const
+{
+    Q_D(const DDiskIoMonitor);
+
+    auto device = d->devices.constFind(d->numbers.value(blockDevicePath));
+    QVector<DDiskIoSample> list;
+
+    if (device == d->devices.constEnd())
+        return list;
+
+    const int size = device->ring.size();
+
+    list.reserve(device->count);
+
+    for (int i = device->count; i > 0; --i) {
+        list << device->ring.at((device->head + size - i) % size);
+    }
+
+    return list;
+}
+
+void DDiskIoMonitor::setInterval(int msec)
+{
+    Q_D(DDiskIoMonitor);
+
+    d->timer.setInterval(qMax(100, msec));
+}
+
+void DDiskIoMonitor::setHistorySize(int size)
+{
+    Q_D(DDiskIoMonitor);
+
+    size = qMax(1, size);
+
+    if (size == d->historySize)
+        return;
+
+    d->historySize = size;
+
+    // the history is dropped, the rates of the next sample are still relative to the last one
+    for (DDiskIoMonitorPrivate::Device &device : d->devices) {
+        device.ring = QVector<DDiskIoSample>(size);
+        device.head = 0;
+        device.count = 0;
+    }
+}
+
+void DDiskIoMonitor::setActive(bool active)
+{
+    Q_D(DDiskIoMonitor);
+
+    if (active) {
+        d->timer.start();
+    } else {
+        d->timer.stop();
+    }
+}
+
+void DDiskIoMonitor::onBlockDeviceAdded(const QString &path)
+{
+    Q_D(DDiskIoMonitor);
+
+    d->addDevice(path);
+}
+
+void DDiskIoMonitor::onBlockDeviceRemoved(const QString &path)
+{
+    Q_D(DDiskIoMonitor);
+
+    d->removeDevice(path);
+}
@@ -0,0 +1,75 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DDISKIOMONITOR_H
+#define DDISKIOMONITOR_H
+
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+// I/O activity of a block device between two samples
+struct DDiskIoSample
+{
+    qint64 timestamp = 0; // msecs since epoch, 0 if not sampled yet
+    double readIops = 0;
+    double writeIops = 0;
+    double readBytesPerSecond = 0;
+    double writeBytesPerSecond = 0;
+    double averageQueueTime = 0; // msecs per request, from the weighted time in queue
+    double utilization = 0; // 0..1, part of the interval the device was busy
+    quint32 inFlight = 0; // requests in flight when sampled
+    quint32 ioErrors = 0; // device/ioerr_cnt of SCSI devices, 0 if not available
+};
+
+Q_DECLARE_METATYPE(DDiskIoSample)
+
+class DDiskManager;
+class DDiskIoMonitorPrivate;
+class DDiskIoMonitor : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(DDiskIoMonitor)
+
+    Q_PROPERTY(int interval READ interval WRITE setInterval)
+    Q_PROPERTY(int historySize READ historySize WRITE setHistorySize)
+    Q_PROPERTY(bool active READ isActive WRITE setActive)
+
+public:
+    explicit DDiskIoMonitor(QObject *parent = nullptr);
+    // manager must outlive the monitor, its changes are watched from now on
+    explicit DDiskIoMonitor(DDiskManager *manager, QObject *parent = nullptr);
+    ~DDiskIoMonitor();
+
+    int interval() const;
+    int historySize() const;
+    bool isActive() const;
+
+    // for tests, "/proc" and "/sys" by default
+    void setProcRoot(const QString &procRoot);
+    void setSysfsRoot(const QString &sysfsRoot);
+
+    QStringList blockDevices() const;
+    DDiskIoSample current(const QString &blockDevicePath) const;
+    // the oldest first
+    QVector<DDiskIoSample> history(const QString &blockDevicePath) const;
+
+public Q_SLOTS:
+    void setInterval(int msec);
+    void setHistorySize(int size);
+    void setActive(bool active);
+
+Q_SIGNALS:
+    // once per sample of all the devices
+    void sampled();
+
+private:
+    QScopedPointer<DDiskIoMonitorPrivate> d_ptr;
+
+private Q_SLOTS:
+    void onBlockDeviceAdded(const QString &path);
+    void onBlockDeviceRemoved(const QString &path);
+};
+
+#endif // DDISKIOMONITOR_H
@@ -10,14 +10,34 @@
 #include "dblockpartition.h"
 #include "ddiskdevice.h"
 #include "dudisksjob.h"
-
+#include "dpartitiontable.h"
+#include "dblockdeviceinfo.h"
+#include "ddriveinfo.h"
+#include "dblockdevicefilter.h"
+#include "dblockdevicequery.h"
+#include "private/dblockdevicefilter_p.h"
+#include "private/ddbuscallqueue_p.h"
+#include "private/dcapabilitycache_p.h"
+#include "private/ddiskeventjournal_p.h"
+#include "private/dudisks2ids_p.h"
+
+#include <QCoreApplication>
 #include <QDBusInterface>
+#include <QDBusPendingCallWatcher>
+#include <QDBusServiceWatcher>
 #include <QDBusReply>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QXmlStreamReader>
 #include <QDBusMetaType>
 #include <QScopedPointer>
+#include <QSharedPointer>
+#include <QTimer>
 #include <QDebug>
 
+#include <algorithm>
+#include <functional>
+
 const QString ManagerPath = "/org/freedesktop/UDisks2/Manager";
 
 static int udisks2VersionCompare(const QString &version)
@@ -53,241 +73,1761 @@ static bool fixUDisks2DiskAddSignal()
     return fix;
 }
 
-class DDiskManagerPrivate
+static const char *capabilityMethods[] = {"CanFormat", "CanCheck", "CanRepair", "CanResize"};
+
+DCapabilityCache *DCapabilityCache::instance()
 {
-public:
-    DDiskManagerPrivate(DDiskManager *qq);
+    // 不释放，进程退出时 D-Bus 连接可能已经断开
+    static DCapabilityCache *cache = new DCapabilityCache();
+
+    return cache;
+}
+
+DCapabilityCache::DCapabilityCache()
+    : serviceWatcher(new QDBusServiceWatcher(UDISKS2_SERVICE, QDBusConnection::systemBus(),
+                                             QDBusServiceWatcher::WatchForOwnerChange, this))
+{
+    connect(serviceWatcher, &QDBusServiceWatcher::serviceOwnerChanged, this, &DCapabilityCache::onServiceOwnerChanged);
+    QDBusConnection::systemBus().connect(UDISKS2_SERVICE, ManagerPath, "org.freedesktop.DBus.Properties", "PropertiesChanged",
+                                         this, SLOT(onManagerPropertiesChanged()));
+
+    // the first caller may be a short lived thread, the notifications need the main event loop
+    if (QCoreApplication::instance()) {
+        moveToThread(QCoreApplication::instance()->thread());
+    }
+}
+
+QStringList DCapabilityCache::supportedFilesystems()
+{
+    QStringList list;
+
+    managerProperties(&list, nullptr);
+
+    return list;
+}
+
+QStringList DCapabilityCache::supportedEncryptionTypes()
+{
+    QStringList list;
+
+    managerProperties(nullptr, &list);
+
+    return list;
+}
+
+bool DCapabilityCache::can(Kind kind, const QString &type, QString *requiredUtil)
+{
+    QMutexLocker locker(&lock);
+    Capability capability = capabilities[kind].value(type, {false, true, QString()});
+
+    if (!capabilities[kind].contains(type)) {
+        const quint64 gen = generation;
+
+        locker.unlock();
+
+        QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, ManagerPath, UDISKS2_SERVICE ".Manager", capabilityMethods[kind]);
+        message << type;
+
+        store(gen, kind, type, QDBusConnection::systemBus().call(message), &capability);
+    }
+
+    if (capability.error) {
+        return false;
+    }
+
+    if (requiredUtil) {
+        *requiredUtil = capability.requiredUtil;
+    }
+
+    return capability.available;
+}
+
+/*!
+ * \brief Query the supported filesystems and all their capabilities in the background.
+ *
+ * Does nothing if it was already done since the last invalidate().
+ */
+void DCapabilityCache::prefetch()
+{
+    QMutexLocker locker(&lock);
+
+    if (prefetched) {
+        return;
+    }
+
+    prefetched = true;
+    locker.unlock();
+
+    QMetaObject::invokeMethod(this, [this] {
+        doPrefetch();
+    }, Qt::QueuedConnection);
+}
+
+void DCapabilityCache::invalidate()
+{
+    QMutexLocker locker(&lock);
+
+    ++generation;
+    prefetched = false;
+    hasProperties = false;
+    filesystems.clear();
+    encryptionTypes.clear();
+
+    for (QHash<QString, Capability> &hash : capabilities) {
+        hash.clear();
+    }
+}
+
+void DCapabilityCache::onManagerPropertiesChanged()
+{
+    // SupportedFilesystems changes when a module is loaded, the Can* answers may follow
+    invalidate();
+    prefetch();
+}
+
+void DCapabilityCache::onServiceOwnerChanged(const QString &service, const QString &oldOwner, const QString &newOwner)
+{
+    Q_UNUSED(service)
+    Q_UNUSED(oldOwner)
+
+    invalidate();
+
+    if (!newOwner.isEmpty()) {
+        prefetch();
+    }
+}
+
+void DCapabilityCache::doPrefetch()
+{
+    QMutexLocker locker(&lock);
+    const quint64 gen = generation;
+    locker.unlock();
+
+    QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, ManagerPath, "org.freedesktop.DBus.Properties", "GetAll");
+    message << QStringLiteral(UDISKS2_SERVICE ".Manager");
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(message), this);
+
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, gen] (QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+
+        QStringList types;
+
+        storeProperties(gen, w->reply(), &types, nullptr);
+
+        // 所有的查询同时发出，不互相等待
+        for (const QString &type : types) {
+            for (int kind = Format; kind < KindCount; ++kind) {
+                QMutexLocker locker(&lock);
+
+                if (gen != generation || capabilities[kind].contains(type)) {
+                    continue;
+                }
+
+                locker.unlock();
+
+                QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, ManagerPath, UDISKS2_SERVICE ".Manager", capabilityMethods[kind]);
+                message << type;
+
+                QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(message), this);
+
+                connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, gen, kind, type] (QDBusPendingCallWatcher *w) {
+                    w->deleteLater();
+
+                    Capability capability;
+
+                    store(gen, static_cast<Kind>(kind), type, w->reply(), &capability);
+                });
+            }
+        }
+    });
+}
+
+void DCapabilityCache::managerProperties(QStringList *filesystems, QStringList *encryptionTypes)
+{
+    QMutexLocker locker(&lock);
+
+    if (!hasProperties) {
+        const quint64 gen = generation;
+
+        locker.unlock();
+
+        QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, ManagerPath, "org.freedesktop.DBus.Properties", "GetAll");
+        message << QStringLiteral(UDISKS2_SERVICE ".Manager");
+
+        storeProperties(gen, QDBusConnection::systemBus().call(message), filesystems, encryptionTypes);
+
+        return;
+    }
+
+    if (filesystems) {
+        *filesystems = this->filesystems;
+    }
+
+    if (encryptionTypes) {
+        *encryptionTypes = this->encryptionTypes;
+    }
+}
 
-    void updateBlockDeviceMountPointsMap();
+void DCapabilityCache::storeProperties(quint64 generation, const QDBusMessage &reply, QStringList *filesystems, QStringList *encryptionTypes)
+{
+    if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().isEmpty()) {
+        return;
+    }
+
+    const QVariantMap &properties = qdbus_cast<QVariantMap>(reply.arguments().first());
+    const QStringList &fs = properties.value("SupportedFilesystems").toStringList();
+    const QStringList &enc = properties.value("SupportedEncryptionTypes").toStringList();
+
+    if (filesystems) {
+        *filesystems = fs;
+    }
+
+    if (encryptionTypes) {
+        *encryptionTypes = enc;
+    }
+
+    QMutexLocker locker(&lock);
+
+    if (generation != this->generation) {
+        return;
+    }
+
+    hasProperties = true;
+    this->filesystems = fs;
+    this->encryptionTypes = enc;
+}
+
+// the reply is (bs), or (bts) for CanResize
+void DCapabilityCache::store(quint64 generation, Kind kind, const QString &type, const QDBusMessage &reply, Capability *capability)
+{
+    *capability = {false, true, QString()};
 
+    if (reply.type() == QDBusMessage::ReplyMessage && !reply.arguments().isEmpty()) {
+        const QDBusArgument &argument = reply.arguments().first().value<QDBusArgument>();
+
+        argument.beginStructure();
+        capability->available = argument.asVariant().toBool();
+
+        while (!argument.atEnd()) {
+            const QVariant &value = argument.asVariant();
+
+            if (value.type() == QVariant::String) {
+                capability->requiredUtil = value.toString();
+            }
+        }
+
+        argument.endStructure();
+        capability->error = false;
+    } else if (!reply.errorName().startsWith(UDISKS2_SERVICE ".Error.")) {
+        // no answer from udisksd (timeout, restarting...), ask again next time
+        return;
+    }
+
+    QMutexLocker locker(&lock);
+
+    if (generation == this->generation) {
+        capabilities[kind].insert(type, *capability);
+    }
+}
+
+class DDiskManagerPrivate
+{
+public:
+    typedef QMap<QString, QMap<QString, QVariantMap>> ObjectMap;
+    // interface id -> properties
+    typedef QHash<int, QVariantMap> InterfaceMap;
+
+    DDiskManagerPrivate(DDiskManager *qq, const QDBusConnection &connection);
+
+    static ObjectMap toObjectMap(const QMap<QDBusObjectPath, QMap<QString, QVariantMap>> &objects);
+    static QVariantMap demarshalProperties(const QVariantMap &properties);
+
+    ObjectMap snapshot() const;
+    QMap<QString, QVariantMap> interfaces(const QString &path) const;
+    QMap<QString, QVariantMap> toInterfaces(const InterfaceMap &interfaces) const;
+    QByteArrayList mountPoints(int path) const;
+    void handlePropertiesChanged(const QString &path, const QString &interface, const QVariantMap &changed_properties, const QStringList &invalidated_properties);
+    void resync(const ObjectMap &snapshot);
+    void reset(const ObjectMap &snapshot);
+    void clearObjects();
+    void record(const DDiskEvent &event);
+    void waitForBlockDevice(const QString &path, int msec, const std::function<void(bool)> &callback);
+    void notifyBlockWaiters(const QString &path);
+    void releaseBlockWaiterConnection();
+    int unlockMany(const QStringList &paths, const QString &passphrase, const QVariantMap &options);
+
+    struct Removal
+    {
+        int id;
+        QString drive;
+        QVariantMap options;
+        int chains = 0; // running, see safelyRemove()
+        QSet<int> visited; // the block devices already in a chain
+        QList<DDiskRemovalStep> steps;
+        QDBusError error;
+    };
+    typedef QSharedPointer<Removal> RemovalPointer;
+
+    QList<int> stackedBlocks(int block) const;
+    void removalStep(const RemovalPointer &removal, DDiskRemovalStep::Action action, const QString &path, const std::function<void(bool)> &next);
+    void removalTeardown(const RemovalPointer &removal, int block, const std::function<void(bool)> &done);
+    void removalStopBlock(const RemovalPointer &removal, int block, const std::function<void(bool)> &done);
+    void removalChainFinished(const RemovalPointer &removal);
+    void removalFinished(const RemovalPointer &removal);
+
+    int addObject(const QString &path);
+    void removeObject(int path);
+    void updateIndexes(int path);
+    void unlinkDrive(int path, int drive);
+    bool candidates(const DBlockDeviceFilter &filter, QSet<int> *result) const;
+    bool matches(const DBlockDeviceFilter &filter, int path) const;
+    bool matches(const DBlockDeviceFilter &filter, const QString &path, const ObjectMap &state) const;
+
+    QDBusConnection connection;
     bool watchChanges = false;
-    QMap<QString, QByteArrayList> blockDeviceMountPointsMap;
+    // the maps and indexes below are keyed on interned paths and interfaces, see dudisks2ids_p.h
+    DStringTable paths;
+    DInterfaceTable interfaceIds;
+    // path -> interface -> properties of all the UDisks2 objects, kept only while watching changes.
+    // Each object holds a reference to its path.
+    QHash<int, InterfaceMap> objects;
+    // secondary indexes of the block devices on the fields queried the most, see query()
+    QSet<int> blockIndex;
+    QSet<int> hintSystemIndex;
+    QSet<int> hintIgnoreIndex;
+    QSet<int> removableIndex;
+    QSet<int> mountedIndex;
+    QHash<QString, QSet<int>> idTypeIndex;
+    QHash<int, QString> idTypeOf;
+    QHash<int, int> driveOf; // -1 if no drive, holds a reference to the path of the drive
+    QHash<int, QSet<int>> blocksOfDrive;
+    int resyncSerial = 0;
+    // journals of DDiskEventRecorder, the notifications derived from another one are not recorded
+    QList<DDiskEventWriter *> eventWriters;
+    bool recordSuspended = false;
     QSet<QString> diskDeviceAddSignalFlag;
+    // callbacks waiting for the Block interface of a path, see waitForBlockDevice()
+    struct BlockWaiter
+    {
+        int id;
+        std::function<void(bool)> callback;
+    };
+    QHash<QString, QList<BlockWaiter>> blockWaiters;
+    int lastWaiterId = 0;
+    // InterfacesAdded while there are waiters and watchChanges is off
+    QMetaObject::Connection blockWaiterConnection;
+    DDBusCallQueue callQueue;
+    int lastBatchId = 0;
 
     DDiskManager *q_ptr;
+
+    Q_DECLARE_PUBLIC(DDiskManager)
 };
 
-DDiskManagerPrivate::DDiskManagerPrivate(DDiskManager *qq)
-    : q_ptr(qq)
+DDiskManagerPrivate::DDiskManagerPrivate(DDiskManager *qq, const QDBusConnection &connection)
+    : connection(connection)
+    , callQueue(qq)
+    , q_ptr(qq)
 {
 
 }
 
-void DDiskManagerPrivate::updateBlockDeviceMountPointsMap()
+DDiskManagerPrivate::ObjectMap DDiskManagerPrivate::toObjectMap(const QMap<QDBusObjectPath, QMap<QString, QVariantMap>> &objects)
 {
-    blockDeviceMountPointsMap.clear();
+    ObjectMap map;
+
+    for (auto i = objects.constBegin(); i != objects.constEnd(); ++i) {
+        QMap<QString, QVariantMap> &interfaces = map[i.key().path()];
 
-    auto om = UDisks2::objectManager();
-    const QMap<QDBusObjectPath, QMap<QString, QVariantMap>> &objects = om->GetManagedObjects().value();
-    auto begin = objects.constBegin();
+        for (auto j = i.value().constBegin(); j != i.value().constEnd(); ++j) {
+            interfaces.insert(j.key(), demarshalProperties(j.value()));
+        }
+    }
 
-    while (begin != objects.constEnd()) {
-        const QString path = begin.key().path();
-        const QMap<QString, QVariantMap> object = begin.value();
+    return map;
+}
 
-        ++begin;
+QVariantMap DDiskManagerPrivate::demarshalProperties(const QVariantMap &properties)
+{
+    QVariantMap map;
 
-        if (!path.startsWith(QStringLiteral("/org/freedesktop/UDisks2/block_devices/"))) {
-            continue;
+    for (auto i = properties.constBegin(); i != properties.constEnd(); ++i) {
+        map.insert(i.key(), UDisks2::demarshal(i.value()));
+    }
+
+    return map;
+}
+
+// the known objects while watching changes, a fresh GetManagedObjects otherwise
+DDiskManagerPrivate::ObjectMap DDiskManagerPrivate::snapshot() const
+{
+    if (!watchChanges) {
+        return toObjectMap(UDisks2::objectManager(connection)->GetManagedObjects().value());
+    }
+
+    ObjectMap map;
+
+    for (auto i = objects.constBegin(); i != objects.constEnd(); ++i) {
+        map.insert(paths.name(i.key()), toInterfaces(i.value()));
+    }
+
+    return map;
+}
+
+// the interfaces of one object, without D-Bus call while watching changes
+QMap<QString, QVariantMap> DDiskManagerPrivate::interfaces(const QString &path) const
+{
+    if (!watchChanges) {
+        return snapshot().value(path);
+    }
+
+    return toInterfaces(objects.value(paths.id(path)));
+}
+
+QMap<QString, QVariantMap> DDiskManagerPrivate::toInterfaces(const InterfaceMap &interfaces) const
+{
+    QMap<QString, QVariantMap> map;
+
+    for (auto i = interfaces.constBegin(); i != interfaces.constEnd(); ++i) {
+        map.insert(interfaceIds.name(i.key()), i.value());
+    }
+
+    return map;
+}
+
+QByteArrayList DDiskManagerPrivate::mountPoints(int path) const
+{
+    return objects.value(path).value(DInterfaceTable::Filesystem).value("MountPoints").value<QByteArrayList>();
+}
+
+void DDiskManagerPrivate::handlePropertiesChanged(const QString &path, const QString &interface,
+                                                  const QVariantMap &changed_properties, const QStringList &invalidated_properties)
+{
+    Q_Q(DDiskManager);
+
+    const int path_id = paths.id(path);
+    const int interface_id = interfaceIds.find(interface);
+    const QByteArrayList old_mount_points = mountPoints(path_id);
+    auto object = path_id < 0 ? objects.end() : objects.find(path_id);
+    QStringList names;
+
+    // 还没有收到 InterfacesAdded，不能记录下来，否则之后的 InterfacesAdded 会被当成重复的
+    if (object == objects.end() || !object->contains(interface_id)) {
+        names = changed_properties.keys() + invalidated_properties;
+    } else {
+        QVariantMap &properties = (*object)[interface_id];
+
+        for (auto i = changed_properties.constBegin(); i != changed_properties.constEnd(); ++i) {
+            const QVariant &value = UDisks2::demarshal(i.value());
+
+            // 只通知真正发生了变化的属性
+            if (properties.contains(i.key()) && UDisks2::valueEquals(properties.value(i.key()), value))
+                continue;
+
+            properties.insert(i.key(), value);
+            names << i.key();
         }
 
-        const QVariantMap &filesystem = object.value(QStringLiteral(UDISKS2_SERVICE ".Filesystem"));
+        for (const QString &name : invalidated_properties) {
+            // the value is unknown, not empty: dropping it would take a mounted filesystem out
+            // of mountedIndex. onPropertiesChanged() reads it again for the live notifications.
+            if (interface_id == DInterfaceTable::Filesystem && name == "MountPoints")
+                continue;
 
-        if (filesystem.isEmpty()) {
-            continue;
+            if (properties.remove(name) > 0)
+                names << name;
         }
+    }
+
+    if (names.isEmpty()) {
+        return;
+    }
+
+    if (path_id >= 0) {
+        updateIndexes(path_id);
+    }
+
+    Q_EMIT q->propertiesChanged(path, interface, names);
 
-        blockDeviceMountPointsMap[path] = qdbus_cast<QByteArrayList>(filesystem.value("MountPoints"));
+    if (names.contains("Optical")) {
+        Q_EMIT q->opticalChanged(path);
+    }
+
+    // without the new value the filesystem may still be mounted, nothing is known to have changed
+    if (interface_id != DInterfaceTable::Filesystem || !names.contains("MountPoints")
+            || !changed_properties.contains("MountPoints")) {
+        return;
+    }
+
+    const QByteArrayList &new_mount_points = UDisks2::demarshal(changed_properties.value("MountPoints")).value<QByteArrayList>();
+
+    Q_EMIT q->mountPointsChanged(path, old_mount_points, new_mount_points);
+
+    if (old_mount_points.isEmpty()) {
+        if (!new_mount_points.isEmpty()) {
+            Q_EMIT q->mountAdded(path, new_mount_points.first());
+        }
+    } else if (new_mount_points.isEmpty()) {
+        Q_EMIT q->mountRemoved(path, old_mount_points.first());
     }
 }
 
-void DDiskManager::onInterfacesAdded(const QDBusObjectPath &object_path, const QMap<QString, QVariantMap> &interfaces_and_properties)
+// the id of path, with an empty object if it is not known yet
+int DDiskManagerPrivate::addObject(const QString &path)
 {
-    const QString &path = object_path.path();
-    const QString &path_drive = QStringLiteral("/org/freedesktop/UDisks2/drives/");
-    const QString &path_device = QStringLiteral("/org/freedesktop/UDisks2/block_devices/");
-    const QString &path_job = QStringLiteral("/org/freedesktop/UDisks2/jobs/");
+    const int id = paths.id(path);
 
-    Q_D(DDiskManager);
+    if (id >= 0 && objects.contains(id))
+        return id;
 
-    if (path.startsWith(path_drive)) {
-        if (interfaces_and_properties.contains(QStringLiteral(UDISKS2_SERVICE ".Drive"))) {
-            if (fixUDisks2DiskAddSignal()) {
-                if (!d->diskDeviceAddSignalFlag.contains(path)) {
-                    d->diskDeviceAddSignalFlag.insert(path);
-                    // 防止flag未清除导致再也收不到此设备的信号
-                    QTimer::singleShot(1000, this, [d, path] {
-                        d->diskDeviceAddSignalFlag.remove(path);
-                    });
+    const int new_id = paths.ref(path);
 
-                    Q_EMIT diskDeviceAdded(path);
-                }
-            } else {
-                Q_EMIT diskDeviceAdded(path);
-            }
+    objects.insert(new_id, InterfaceMap());
+
+    return new_id;
+}
+
+void DDiskManagerPrivate::removeObject(int path)
+{
+    if (objects.remove(path) > 0)
+        paths.deref(path);
+}
+
+static void setIndexed(QSet<int> &index, int path, bool on)
+{
+    if (on) {
+        index.insert(path);
+    } else {
+        index.remove(path);
+    }
+}
+
+void DDiskManagerPrivate::updateIndexes(int path)
+{
+    const InterfaceMap &interfaces = objects.value(path);
+
+    if (interfaces.contains(DInterfaceTable::Drive) || blocksOfDrive.contains(path)) {
+        // Removable belongs to the drive but is queried on its block devices
+        const bool removable = interfaces.value(DInterfaceTable::Drive).value("Removable").toBool();
+
+        for (int block : blocksOfDrive.value(path)) {
+            setIndexed(removableIndex, block, removable);
         }
-    } else if (path.startsWith(path_device)) {
-        if (interfaces_and_properties.contains(QStringLiteral(UDISKS2_SERVICE ".Block"))) {
-            if (fixUDisks2DiskAddSignal()) {
-                QScopedPointer<DBlockDevice> bd(createBlockDevice(path));
-                const QString &drive = bd->drive();
 
-                if (!d->diskDeviceAddSignalFlag.contains(drive)) {
-                    d->diskDeviceAddSignalFlag.insert(drive);
-                    // 防止flag未清除导致再也收不到此设备的信号
-                    QTimer::singleShot(1000, this, [d, drive] {
-                        d->diskDeviceAddSignalFlag.remove(drive);
-                    });
+        return;
+    }
 
-                    Q_EMIT diskDeviceAdded(drive);
-                }
-            }
+    const int old_drive = driveOf.value(path, -1);
+    const QString old_id_type = idTypeOf.value(path);
+
+    if (!interfaces.contains(DInterfaceTable::Block)) {
+        if (!blockIndex.remove(path))
+            return;
+
+        hintSystemIndex.remove(path);
+        hintIgnoreIndex.remove(path);
+        removableIndex.remove(path);
+        mountedIndex.remove(path);
+        idTypeIndex[old_id_type].remove(path);
+        idTypeOf.remove(path);
+        driveOf.remove(path);
+        unlinkDrive(path, old_drive);
+
+        return;
+    }
+
+    const QVariantMap &block = interfaces.value(DInterfaceTable::Block);
+    const QString &id_type = block.value("IdType").toString();
+    const QString &drive_path = block.value("Drive").toString();
+    // "/" means no drive
+    const bool has_drive = drive_path.length() > 1;
+    const int drive = has_drive ? paths.id(drive_path) : -1;
+
+    blockIndex.insert(path);
+    setIndexed(hintSystemIndex, path, block.value("HintSystem").toBool());
+    setIndexed(hintIgnoreIndex, path, block.value("HintIgnore").toBool());
+    setIndexed(mountedIndex, path, !mountPoints(path).isEmpty());
+
+    if (id_type != old_id_type || !idTypeOf.contains(path)) {
+        if (idTypeIndex.contains(old_id_type) && idTypeIndex[old_id_type].remove(path) && idTypeIndex[old_id_type].isEmpty())
+            idTypeIndex.remove(old_id_type);
+
+        idTypeIndex[id_type].insert(path);
+        idTypeOf[path] = id_type;
+    }
+
+    // a drive not interned yet can't be the old one
+    if (drive != old_drive || (has_drive && drive < 0) || !driveOf.contains(path)) {
+        const int new_drive = has_drive ? paths.ref(drive_path) : -1;
+
+        if (new_drive >= 0)
+            blocksOfDrive[new_drive].insert(path);
+
+        driveOf[path] = new_drive;
+        unlinkDrive(path, old_drive);
+    }
+
+    setIndexed(removableIndex, path, objects.value(driveOf.value(path, -1)).value(DInterfaceTable::Drive).value("Removable").toBool());
+}
+
+void DDiskManagerPrivate::unlinkDrive(int path, int drive)
+{
+    if (drive < 0)
+        return;
+
+    if (blocksOfDrive.contains(drive) && blocksOfDrive[drive].remove(path) && blocksOfDrive[drive].isEmpty())
+        blocksOfDrive.remove(drive);
+
+    paths.deref(drive);
+}
+
+void DDiskManagerPrivate::clearObjects()
+{
+    objects.clear();
+    blockIndex.clear();
+    hintSystemIndex.clear();
+    hintIgnoreIndex.clear();
+    removableIndex.clear();
+    mountedIndex.clear();
+    idTypeIndex.clear();
+    idTypeOf.clear();
+    driveOf.clear();
+    blocksOfDrive.clear();
+    // no reference is left
+    paths.clear();
+}
+
+// Narrows the filter to the block devices of the indexes, false if it can't be narrowed.
+// The candidates are a superset of the result, they still go through matches().
+bool DDiskManagerPrivate::candidates(const DBlockDeviceFilter &filter, QSet<int> *result) const
+{
+    const DBlockDeviceFilterData *data = filter.d.constData();
+    const int interface = interfaceIds.find(data->interface);
+
+    switch (data->type) {
+    case DBlockDeviceFilterData::Property: {
+        if (interface == DInterfaceTable::Block && data->name == "IdType") {
+            *result = idTypeIndex.value(data->value.toString());
+            return true;
+        }
+
+        if (interface == DInterfaceTable::Block && data->name == "Drive") {
+            *result = blocksOfDrive.value(paths.id(data->value.toString()));
+            return true;
+        }
+
+        // only the positive values, the complements would be as large as a full scan
+        if (data->value.type() != QVariant::Bool || !data->value.toBool())
+            return false;
+
+        if (interface == DInterfaceTable::Block) {
+            if (data->name == "HintSystem") {
+                *result = hintSystemIndex;
+                return true;
+            }
+
+            if (data->name == "HintIgnore") {
+                *result = hintIgnoreIndex;
+                return true;
+            }
+        } else if (interface == DInterfaceTable::Drive && data->name == "Removable") {
+            *result = removableIndex;
+            return true;
+        }
+
+        return false;
+    }
+    case DBlockDeviceFilterData::Mounted:
+        if (!data->value.toBool())
+            return false;
+
+        *result = mountedIndex;
+        return true;
+    case DBlockDeviceFilterData::And: {
+        bool narrowed = false;
+
+        for (const DBlockDeviceFilter &f : data->children) {
+            QSet<int> set;
+
+            if (!candidates(f, &set))
+                continue;
+
+            if (narrowed) {
+                result->intersect(set);
+            } else {
+                *result = set;
+                narrowed = true;
+            }
+        }
+
+        return narrowed;
+    }
+    case DBlockDeviceFilterData::Or: {
+        QSet<int> all;
+
+        for (const DBlockDeviceFilter &f : data->children) {
+            QSet<int> set;
+
+            if (!candidates(f, &set))
+                return false;
+
+            all.unite(set);
+        }
+
+        *result = all;
+        return true;
+    }
+    default:
+        break;
+    }
+
+    return false;
+}
+
+// on the known objects, while watching changes
+bool DDiskManagerPrivate::matches(const DBlockDeviceFilter &filter, int path) const
+{
+    auto object = objects.constFind(path);
+
+    if (object == objects.constEnd() || !object->contains(DInterfaceTable::Block))
+        return false;
+
+    const QString &drive = object->value(DInterfaceTable::Block).value("Drive").toString();
+
+    return filter.matches(DBlockDeviceInfo(paths.name(path), toInterfaces(*object)),
+                          DDriveInfo(drive, toInterfaces(objects.value(driveOf.value(path, -1)))));
+}
+
+bool DDiskManagerPrivate::matches(const DBlockDeviceFilter &filter, const QString &path, const ObjectMap &state) const
+{
+    const QMap<QString, QVariantMap> &interfaces = state.value(path);
+
+    if (!interfaces.contains(QStringLiteral(UDISKS2_SERVICE ".Block")))
+        return false;
+
+    const QString &drive = interfaces.value(QStringLiteral(UDISKS2_SERVICE ".Block")).value("Drive").toString();
+
+    return filter.matches(DBlockDeviceInfo(path, interfaces), DDriveInfo(drive, state.value(drive)));
+}
+
+// Replays the difference between the known objects and a fresh snapshot as the
+// usual InterfacesRemoved, InterfacesAdded and PropertiesChanged notifications.
+void DDiskManagerPrivate::resync(const ObjectMap &snapshot)
+{
+    Q_Q(DDiskManager);
+
+    const ObjectMap old = this->snapshot();
+    const bool was_suspended = recordSuspended;
+
+    recordSuspended = true;
+
+    for (auto i = old.constBegin(); i != old.constEnd(); ++i) {
+        const QMap<QString, QVariantMap> &interfaces = snapshot.value(i.key());
+        QStringList removed;
+
+        for (const QString &interface : i.value().keys()) {
+            if (!interfaces.contains(interface))
+                removed << interface;
+        }
+
+        if (!removed.isEmpty()) {
+            q->onInterfacesRemoved(QDBusObjectPath(i.key()), removed);
+        }
+    }
+
+    for (auto i = snapshot.constBegin(); i != snapshot.constEnd(); ++i) {
+        const QMap<QString, QVariantMap> &interfaces = old.value(i.key());
+        QMap<QString, QVariantMap> added;
+
+        for (auto j = i.value().constBegin(); j != i.value().constEnd(); ++j) {
+            if (!interfaces.contains(j.key())) {
+                added.insert(j.key(), j.value());
+                continue;
+            }
+
+            const QVariantMap &properties = interfaces.value(j.key());
+            QStringList invalidated;
+
+            for (const QString &name : properties.keys()) {
+                if (!j.value().contains(name))
+                    invalidated << name;
+            }
+
+            handlePropertiesChanged(i.key(), j.key(), j.value(), invalidated);
+        }
+
+        if (!added.isEmpty()) {
+            q->onInterfacesAdded(QDBusObjectPath(i.key()), added);
+        }
+    }
+
+    recordSuspended = was_suspended;
+}
+
+void DDiskManagerPrivate::reset(const ObjectMap &snapshot)
+{
+    clearObjects();
+
+    for (auto i = snapshot.constBegin(); i != snapshot.constEnd(); ++i) {
+        InterfaceMap &interfaces = objects[addObject(i.key())];
+
+        for (auto j = i.value().constBegin(); j != i.value().constEnd(); ++j) {
+            interfaces.insert(interfaceIds.id(j.key()), j.value());
+        }
+    }
+
+    for (auto i = objects.constBegin(); i != objects.constEnd(); ++i) {
+        updateIndexes(i.key());
+    }
+}
+
+void DDiskManagerPrivate::record(const DDiskEvent &event)
+{
+    if (recordSuspended)
+        return;
+
+    for (DDiskEventWriter *writer : eventWriters) {
+        writer->write(event);
+    }
+}
+
+// Calls back with true once path has a Block interface, without waiting if it
+// already has one, or with false after msec. Without watchChanges, InterfacesAdded
+// is subscribed to only while there are waiters.
+void DDiskManagerPrivate::waitForBlockDevice(const QString &path, int msec, const std::function<void(bool)> &callback)
+{
+    Q_Q(DDiskManager);
+
+    const int path_id = paths.id(path);
+
+    if (watchChanges && path_id >= 0 && objects.value(path_id).contains(DInterfaceTable::Block)) {
+        callback(true);
+        return;
+    }
+
+    const int id = ++lastWaiterId;
+
+    blockWaiters[path].append({id, callback});
+
+    if (!watchChanges) {
+        if (!blockWaiterConnection) {
+            blockWaiterConnection = QObject::connect(UDisks2::objectManager(connection), &OrgFreedesktopDBusObjectManagerInterface::InterfacesAdded,
+                                                     q, [this] (const QDBusObjectPath &object_path, const QMap<QString, QVariantMap> &interfaces) {
+                if (interfaces.contains(UDISKS2_SERVICE ".Block"))
+                    notifyBlockWaiters(object_path.path());
+            });
+        }
+
+        // it may have been announced before the subscription
+        QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, path, "org.freedesktop.DBus.Properties", "Get");
+        message << QStringLiteral(UDISKS2_SERVICE ".Block") << QStringLiteral("Device");
+
+        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(connection.asyncCall(message), q);
+
+        QObject::connect(watcher, &QDBusPendingCallWatcher::finished, q, [this, path] (QDBusPendingCallWatcher *w) {
+            w->deleteLater();
+
+            if (!w->isError())
+                notifyBlockWaiters(path);
+        });
+    }
+
+    QTimer::singleShot(msec, q, [this, path, id] {
+        auto waiters = blockWaiters.find(path);
+
+        if (waiters == blockWaiters.end())
+            return;
+
+        for (int i = 0; i < waiters->count(); ++i) {
+            if (waiters->at(i).id != id)
+                continue;
+
+            const std::function<void(bool)> callback = waiters->takeAt(i).callback;
+
+            if (waiters->isEmpty())
+                blockWaiters.erase(waiters);
+
+            releaseBlockWaiterConnection();
+            callback(false);
+            return;
+        }
+    });
+}
+
+void DDiskManagerPrivate::notifyBlockWaiters(const QString &path)
+{
+    const QList<BlockWaiter> &waiters = blockWaiters.take(path);
+
+    releaseBlockWaiterConnection();
+
+    for (const BlockWaiter &waiter : waiters) {
+        waiter.callback(true);
+    }
+}
+
+void DDiskManagerPrivate::releaseBlockWaiterConnection()
+{
+    if (blockWaiters.isEmpty() && blockWaiterConnection) {
+        QObject::disconnect(blockWaiterConnection);
+        blockWaiterConnection = QMetaObject::Connection();
+    }
+}
+
+void DDiskManager::onInterfacesAdded(const QDBusObjectPath &object_path, const QMap<QString, QVariantMap> &interfaces_and_properties)
+{
+    const QString &path = object_path.path();
+    const QString &path_drive = QStringLiteral("/org/freedesktop/UDisks2/drives/");
+    const QString &path_device = QStringLiteral("/org/freedesktop/UDisks2/block_devices/");
+    const QString &path_job = QStringLiteral("/org/freedesktop/UDisks2/jobs/");
+
+    Q_D(DDiskManager);
+
+    if (!d->eventWriters.isEmpty()) {
+        DDiskEvent event;
+
+        event.type = DDiskEvent::InterfacesAdded;
+        event.path = path;
+
+        QMap<QString, QVariantMap> &interfaces = event.objects[path];
+
+        for (auto i = interfaces_and_properties.constBegin(); i != interfaces_and_properties.constEnd(); ++i) {
+            interfaces.insert(i.key(), DDiskManagerPrivate::demarshalProperties(i.value()));
+        }
+
+        d->record(event);
+    }
+
+    // a restarted udisksd announces again the objects we already know, only report what is new
+    const int path_id = d->addObject(path);
+    // bit i: the known interface of id i was added
+    uint added = 0;
+    QStringList added_names;
+
+    for (auto i = interfaces_and_properties.constBegin(); i != interfaces_and_properties.constEnd(); ++i) {
+        const int interface = d->interfaceIds.id(i.key());
+        DDiskManagerPrivate::InterfaceMap &known = d->objects[path_id];
+
+        if (known.contains(interface)) {
+            QStringList invalidated;
+
+            for (const QString &name : known.value(interface).keys()) {
+                if (!i.value().contains(name))
+                    invalidated << name;
+            }
+
+            d->handlePropertiesChanged(path, i.key(), i.value(), invalidated);
+        } else {
+            known.insert(interface, DDiskManagerPrivate::demarshalProperties(i.value()));
+            added_names << i.key();
+
+            if (interface < DInterfaceTable::KnownCount)
+                added |= 1u << interface;
+        }
+    }
+
+    if (d->objects.value(path_id).isEmpty()) {
+        d->removeObject(path_id);
+    } else if (!added_names.isEmpty()) {
+        d->updateIndexes(path_id);
+    }
+
+    if (path.startsWith(path_drive)) {
+        if (added & (1u << DInterfaceTable::Drive)) {
+            if (fixUDisks2DiskAddSignal()) {
+                if (!d->diskDeviceAddSignalFlag.contains(path)) {
+                    d->diskDeviceAddSignalFlag.insert(path);
+                    // 防止flag未清除导致再也收不到此设备的信号
+                    QTimer::singleShot(1000, this, [d, path] {
+                        d->diskDeviceAddSignalFlag.remove(path);
+                    });
+
+                    Q_EMIT diskDeviceAdded(path);
+                }
+            } else {
+                Q_EMIT diskDeviceAdded(path);
+            }
+        }
+    } else if (path.startsWith(path_device)) {
+        if (added & (1u << DInterfaceTable::Block)) {
+            if (fixUDisks2DiskAddSignal()) {
+                QScopedPointer<DBlockDevice> bd(createBlockDevice(path, d->connection));
+                const QString &drive = bd->drive();
+
+                if (!d->diskDeviceAddSignalFlag.contains(drive)) {
+                    d->diskDeviceAddSignalFlag.insert(drive);
+                    // 防止flag未清除导致再也收不到此设备的信号
+                    QTimer::singleShot(1000, this, [d, drive] {
+                        d->diskDeviceAddSignalFlag.remove(drive);
+                    });
+
+                    Q_EMIT diskDeviceAdded(drive);
+                }
+            }
+
+            if (!d->blockWaiters.isEmpty()) {
+                d->notifyBlockWaiters(path);
+            }
+
+            Q_EMIT blockDeviceAdded(path);
+        }
+
+        if (added & (1u << DInterfaceTable::Filesystem)) {
+            Q_EMIT fileSystemAdded(path);
+        }
+    } else if (path.startsWith(path_job)) {
+        if (added & (1u << DInterfaceTable::Job)) {
+            Q_EMIT jobAdded(path);
+        }
+    }
+
+    if (!added_names.isEmpty()) {
+        Q_EMIT interfacesAdded(path, added_names);
+    }
+}
+
+void DDiskManager::onInterfacesRemoved(const QDBusObjectPath &object_path, const QStringList &interfaces)
+{
+    const QString &path = object_path.path();
+
+    Q_D(DDiskManager);
+
+    if (!d->eventWriters.isEmpty()) {
+        DDiskEvent event;
+
+        event.type = DDiskEvent::InterfacesRemoved;
+        event.path = path;
+        event.names = interfaces;
+        d->record(event);
+    }
+
+    const int path_id = d->paths.id(path);
+    QStringList removed_names;
+
+    for (const QString &i : interfaces) {
+        const int interface = d->interfaceIds.find(i);
+        auto object = path_id < 0 ? d->objects.end() : d->objects.find(path_id);
+
+        // already gone, or removed twice
+        if (object == d->objects.end() || object->remove(interface) == 0)
+            continue;
+
+        removed_names << i;
+
+        const bool empty = object->isEmpty();
+
+        d->updateIndexes(path_id);
+
+        // the id is released with the object, not before its indexes are updated
+        if (empty)
+            d->removeObject(path_id);
+
+        switch (interface) {
+        case DInterfaceTable::Drive:
+            d->diskDeviceAddSignalFlag.remove(path);
+
+            Q_EMIT diskDeviceRemoved(path);
+            break;
+        case DInterfaceTable::Filesystem:
+            Q_EMIT fileSystemRemoved(path);
+            break;
+        case DInterfaceTable::Block:
+            Q_EMIT blockDeviceRemoved(path);
+            break;
+        default:
+            break;
+        }
+
+        if (empty)
+            break;
+    }
+
+    if (!removed_names.isEmpty()) {
+        Q_EMIT interfacesRemoved(path, removed_names);
+    }
+}
+
+void DDiskManager::onPropertiesChanged(const QString &interface, const QVariantMap &changed_properties,
+                                       const QStringList &invalidated_properties, const QDBusMessage &message)
+{
+    Q_D(DDiskManager);
+
+    QVariantMap changed = changed_properties;
+    QStringList invalidated = invalidated_properties;
+
+    // the mount signals need the new mount points, they are read again like an
+    // invalidated property of DDiskDevice; recorded so as a change
+    if (interface == UDISKS2_SERVICE ".Filesystem" && invalidated.contains("MountPoints") && !changed.contains("MountPoints")) {
+        QDBusMessage get = QDBusMessage::createMethodCall(UDISKS2_SERVICE, message.path(), "org.freedesktop.DBus.Properties", "Get");
+        get << interface << QStringLiteral("MountPoints");
+
+        const QDBusReply<QVariant> reply = d->connection.call(get);
+
+        if (reply.isValid()) {
+            changed.insert("MountPoints", reply.value());
+            invalidated.removeAll("MountPoints");
+        }
+    }
+
+    if (!d->eventWriters.isEmpty()) {
+        DDiskEvent event;
+
+        event.type = DDiskEvent::PropertiesChanged;
+        event.path = message.path();
+        event.interface = interface;
+        event.properties = DDiskManagerPrivate::demarshalProperties(changed);
+        event.names = invalidated;
+        d->record(event);
+    }
+
+    d->handlePropertiesChanged(message.path(), interface, changed, invalidated);
+}
+
+void DDiskManager::onServiceOwnerChanged(const QString &service, const QString &oldOwner, const QString &newOwner)
+{
+    Q_UNUSED(service)
+    Q_UNUSED(oldOwner)
+
+    Q_D(DDiskManager);
+
+    const int serial = ++d->resyncSerial;
+
+    if (!d->eventWriters.isEmpty()) {
+        DDiskEvent event;
+
+        event.type = DDiskEvent::ServiceOwnerChanged;
+        event.path = newOwner;
+        d->record(event);
+    }
+
+    // udisksd stopped, keep the known state until it comes back
+    if (newOwner.isEmpty()) {
+        return;
+    }
+
+    QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, "/org/freedesktop/UDisks2", "org.freedesktop.DBus.ObjectManager", "GetManagedObjects");
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(d->connection.asyncCall(message), this);
+
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, d, serial] (QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+
+        QDBusPendingReply<QMap<QDBusObjectPath, QMap<QString, QVariantMap>>> reply = *w;
+
+        if (reply.isError() || serial != d->resyncSerial || !d->watchChanges) {
+            return;
+        }
+
+        DDiskEvent event;
+
+        event.type = DDiskEvent::Snapshot;
+        event.objects = DDiskManagerPrivate::toObjectMap(reply.value());
+        d->record(event);
+        d->resync(event.objects);
+    });
+}
+
+/*!
+ * \class DDiskManager
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief DDiskManager provide severial ways to manage devices and partitions.
+ *
+ * \sa DBlockPartition, DBlockDevice, UDiskDeviceInfo
+ */
+
+DDiskManager::DDiskManager(QObject *parent)
+    : DDiskManager(QDBusConnection::systemBus(), parent)
+{
+
+}
+
+/*!
+ * \brief Create a manager talking to UDisks2 through \a connection instead of the system bus.
+ *
+ * Useful to keep bulk traffic on its own connection, or to target a daemon
+ * on a private or peer-to-peer bus. The static functions taking no connection
+ * always use the system bus.
+ */
+DDiskManager::DDiskManager(const QDBusConnection &connection, QObject *parent)
+    : QObject(parent)
+    , d_ptr(new DDiskManagerPrivate(this, connection))
+{
+    // 格式化等对话框会频繁地查询这些信息，提前在后台获取
+    if (connection.name() == QDBusConnection::systemBus().name()) {
+        DCapabilityCache::instance()->prefetch();
+    }
+}
+
+DDiskManager::~DDiskManager()
+{
+
+}
+
+static QStringList getDBusNodeNameList(const QString &service, const QString &path, const QDBusConnection &connection)
+{
+    QDBusInterface ud2(service, path, "org.freedesktop.DBus.Introspectable", connection);
+    QDBusReply<QString> reply = ud2.call("Introspect");
+    QXmlStreamReader xml_parser(reply.value());
+    QStringList nodeList;
+
+    while (!xml_parser.atEnd()) {
+        xml_parser.readNext();
+
+        if (xml_parser.tokenType() == QXmlStreamReader::StartElement
+                && xml_parser.name().toString() == "node") {
+            const QString &name = xml_parser.attributes().value("name").toString();
+
+            if (!name.isEmpty()) {
+                nodeList << path + "/" + name;
+            }
+        }
+    }
+
+    return nodeList;
+}
+
+QDBusConnection DDiskManager::connection() const
+{
+    Q_D(const DDiskManager);
+
+    return d->connection;
+}
+
+QStringList DDiskManager::blockDevices() const
+{
+    Q_D(const DDiskManager);
+
+    return getDBusNodeNameList(UDISKS2_SERVICE, "/org/freedesktop/UDisks2/block_devices", d->connection);
+}
+
+QStringList DDiskManager::diskDevices() const
+{
+    Q_D(const DDiskManager);
+
+    return getDBusNodeNameList(UDISKS2_SERVICE, "/org/freedesktop/UDisks2/drives", d->connection);
+}
+
+QStringList DDiskManager::blockDevices(QVariantMap options)
+{
+    OrgFreedesktopUDisks2ManagerInterface udisksmgr(UDISKS2_SERVICE, ManagerPath, QDBusConnection::systemBus());
+
+    auto reply = udisksmgr.GetBlockDevices(options);
+    reply.waitForFinished();
+    QList<QDBusObjectPath> resultList = reply.value();
+    QStringList dbusPaths;
+    for (const QDBusObjectPath &singleResult : resultList) {
+        dbusPaths << singleResult.path();
+    }
+    return dbusPaths;
+}
+
+bool DDiskManager::watchChanges() const
+{
+    Q_D(const DDiskManager);
+
+    return d->watchChanges;
+}
+
+int DDiskManager::batchConcurrency() const
+{
+    Q_D(const DDiskManager);
+
+    return d->callQueue.maxConcurrentCalls();
+}
+
+namespace {
+struct BatchState
+{
+    int pending;
+    QMap<QString, QString> values;
+    QMap<QString, QDBusError> errors;
+};
+}
+
+/*!
+ * \brief Mount the filesystems of all the given block devices at once.
+ *
+ * The Filesystem.Mount calls are sent without waiting for each other (at most
+ * batchConcurrency() of them are in flight) and the results are reported
+ * together by mountAllFinished() with the returned id.
+ *
+ * \sa unmountAll(), DBlockDevice::mount()
+ */
+int DDiskManager::mountAll(const QStringList &paths, const QVariantMap &options)
+{
+    Q_D(DDiskManager);
+
+    const int id = ++d->lastBatchId;
+
+    if (paths.isEmpty()) {
+        QTimer::singleShot(0, this, [this, id] {
+            Q_EMIT mountAllFinished(id, QMap<QString, QString>(), QMap<QString, QDBusError>());
+        });
+
+        return id;
+    }
+
+    QSharedPointer<BatchState> batch(new BatchState {paths.count(), {}, {}});
+
+    for (const QString &path : paths) {
+        d->callQueue.enqueue([d, path, options] {
+            QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, path, UDISKS2_SERVICE ".Filesystem", "Mount");
+            message << options;
+
+            return d->connection.asyncCall(message);
+        }, [this, id, path, batch] (const QDBusPendingCall &call) {
+            QDBusPendingReply<QString> reply = call;
+
+            if (reply.isError()) {
+                batch->errors[path] = reply.error();
+            } else {
+                batch->values[path] = reply.value();
+            }
+
+            if (--batch->pending == 0) {
+                Q_EMIT mountAllFinished(id, batch->values, batch->errors);
+            }
+        });
+    }
+
+    return id;
+}
+
+/*!
+ * \brief Unmount the filesystems of all the given block devices at once.
+ *
+ * \sa mountAll(), unmountAllFinished()
+ */
+int DDiskManager::unmountAll(const QStringList &paths, const QVariantMap &options)
+{
+    Q_D(DDiskManager);
+
+    const int id = ++d->lastBatchId;
+
+    if (paths.isEmpty()) {
+        QTimer::singleShot(0, this, [this, id] {
+            Q_EMIT unmountAllFinished(id, QMap<QString, QDBusError>());
+        });
+
+        return id;
+    }
+
+    QSharedPointer<BatchState> batch(new BatchState {paths.count(), {}, {}});
+
+    for (const QString &path : paths) {
+        d->callQueue.enqueue([d, path, options] {
+            QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, path, UDISKS2_SERVICE ".Filesystem", "Unmount");
+            message << options;
+
+            return d->connection.asyncCall(message);
+        }, [this, id, path, batch] (const QDBusPendingCall &call) {
+            if (call.isError()) {
+                batch->errors[path] = call.error();
+            }
+
+            if (--batch->pending == 0) {
+                Q_EMIT unmountAllFinished(id, batch->errors);
+            }
+        });
+    }
+
+    return id;
+}
+
+int DDiskManagerPrivate::unlockMany(const QStringList &paths, const QString &passphrase, const QVariantMap &options)
+{
+    Q_Q(DDiskManager);
+
+    // udisksd usually exports the cleartext device before replying, but not always
+    static const int cleartext_timeout = 10000;
+    const int id = ++lastBatchId;
+
+    if (paths.isEmpty()) {
+        QTimer::singleShot(0, q, [q, id] {
+            Q_EMIT q->unlockManyFinished(id, QMap<QString, QString>(), QMap<QString, QDBusError>());
+        });
+
+        return id;
+    }
+
+    QSharedPointer<BatchState> batch(new BatchState {paths.count(), {}, {}});
+    const auto done = [q, id, batch] {
+        if (--batch->pending == 0) {
+            Q_EMIT q->unlockManyFinished(id, batch->values, batch->errors);
+        }
+    };
+
+    for (const QString &path : paths) {
+        callQueue.enqueue([this, path, passphrase, options] {
+            QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, path, UDISKS2_SERVICE ".Encrypted", "Unlock");
+            message << passphrase << options;
+
+            return connection.asyncCall(message);
+        }, [this, path, batch, done] (const QDBusPendingCall &call) {
+            QDBusPendingReply<QDBusObjectPath> reply = call;
+
+            if (reply.isError()) {
+                batch->errors[path] = reply.error();
+                done();
+                return;
+            }
+
+            const QString &cleartext = reply.value().path();
+
+            batch->values[path] = cleartext;
+
+            // 等待 InterfacesAdded，不轮询 CleartextDevice
+            waitForBlockDevice(cleartext, cleartext_timeout, [path, cleartext, batch, done] (bool found) {
+                if (!found) {
+                    batch->errors[path] = QDBusError(QDBusError::Timeout, QStringLiteral("%1 was not announced").arg(cleartext));
+                }
+
+                done();
+            });
+        });
+    }
+
+    return id;
+}
+
+/*!
+ * \brief Unlock all the given encrypted block devices at once with \a passphrase.
+ *
+ * The Encrypted.Unlock calls run concurrently, at most batchConcurrency() of
+ * them in flight. A device is done when its cleartext block device has been
+ * announced by InterfacesAdded, so unlockManyFinished() only reports cleartext
+ * devices that blockDeviceInfo() and createBlockDevice() can use right away.
+ * If the announcement doesn't come in time, the path is reported with a
+ * timeout error.
+ *
+ * \sa DBlockDevice::unlock()
+ */
+int DDiskManager::unlockMany(const QStringList &paths, const QString &passphrase, const QVariantMap &options)
+{
+    Q_D(DDiskManager);
+
+    return d->unlockMany(paths, passphrase, options);
+}
+
+/*!
+ * \brief Unlock all the given encrypted block devices at once with a key file.
+ *
+ * The key is read from \a keyfileFd once, before any call is made, and passed
+ * to every Unlock in the "keyfile_contents" option. If it can't be read, every
+ * path is reported with an InvalidArgs error and nothing is unlocked.
+ */
+int DDiskManager::unlockMany(const QStringList &paths, int keyfileFd, const QVariantMap &options)
+{
+    Q_D(DDiskManager);
+
+    QFile file;
+    QVariantMap opts = options;
+    bool ok = file.open(keyfileFd, QIODevice::ReadOnly, QFileDevice::DontCloseHandle);
+
+    if (ok) {
+        opts["keyfile_contents"] = file.readAll();
+        ok = file.error() == QFileDevice::NoError;
+    }
+
+    if (!ok) {
+        const int id = ++d->lastBatchId;
+        const QDBusError error(QDBusError::InvalidArgs, QStringLiteral("cannot read keyfile: %1").arg(file.errorString()));
+        QMap<QString, QDBusError> errors;
+
+        for (const QString &path : paths) {
+            errors[path] = error;
+        }
+
+        QTimer::singleShot(0, this, [this, id, errors] {
+            Q_EMIT unlockManyFinished(id, QMap<QString, QString>(), errors);
+        });
+
+        return id;
+    }
+
+    return d->unlockMany(paths, QString(), opts);
+}
+
+// The block devices directly on top of block: its partitions, its cleartext device
+// and, for a LVM physical volume, the logical volumes of its volume group
+QList<int> DDiskManagerPrivate::stackedBlocks(int block) const
+{
+    const QString &path = paths.name(block);
+    const int physical_volume = interfaceIds.find(UDISKS2_SERVICE ".PhysicalVolume");
+    const int block_lvm2 = interfaceIds.find(UDISKS2_SERVICE ".Block.LVM2");
+    const int logical_volume = interfaceIds.find(UDISKS2_SERVICE ".LogicalVolume");
+    const QString &volume_group = physical_volume < 0 ? QString()
+                                  : objects.value(block).value(physical_volume).value("VolumeGroup").toString();
+    QList<int> blocks;
+
+    for (int other : blockIndex) {
+        if (other == block)
+            continue;
+
+        const InterfaceMap &interfaces = objects.value(other);
+
+        if (interfaces.value(DInterfaceTable::Block).value("CryptoBackingDevice").toString() == path
+                || interfaces.value(DInterfaceTable::Partition).value("Table").toString() == path) {
+            blocks << other;
+            continue;
+        }
+
+        if (volume_group.length() <= 1 || block_lvm2 < 0 || logical_volume < 0)
+            continue;
+
+        const QString &lv = interfaces.value(block_lvm2).value("LogicalVolume").toString();
+
+        if (lv.length() > 1 && objects.value(paths.id(lv)).value(logical_volume).value("VolumeGroup").toString() == volume_group)
+            blocks << other;
+    }
+
+    return blocks;
+}
+
+// Calls the method of the step, then next with false if it failed
+void DDiskManagerPrivate::removalStep(const RemovalPointer &removal, DDiskRemovalStep::Action action,
+                                      const QString &path, const std::function<void(bool)> &next)
+{
+    Q_Q(DDiskManager);
+
+    static const char *methods[][2] = {
+        {UDISKS2_SERVICE ".Filesystem", "Unmount"},
+        {UDISKS2_SERVICE ".Encrypted", "Lock"},
+        {UDISKS2_SERVICE ".Drive", "PowerOff"},
+        {UDISKS2_SERVICE ".Drive", "Eject"},
+        {UDISKS2_SERVICE ".Swapspace", "Stop"},
+        {UDISKS2_SERVICE ".LogicalVolume", "Deactivate"}
+    };
+
+    QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, path, methods[action][0], methods[action][1]);
+    message << removal->options;
+
+    QElapsedTimer clock;
+
+    clock.start();
+
+    // 卸载时要同步缓存，慢速 U 盘可能远超默认的 25 秒
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(connection.asyncCall(message, 10 * 60 * 1000), q);
+
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, q, [this, q, removal, action, path, next, clock] (QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+
+        DDiskRemovalStep step;
+
+        step.action = action;
+        step.path = path;
+        step.elapsed = clock.elapsed();
+        step.error = w->error();
+        removal->steps << step;
+
+        Q_EMIT q->safelyRemoveStepFinished(removal->id, step);
+
+        if (step.error.isValid() && !removal->error.isValid())
+            removal->error = step.error;
+
+        next(!step.error.isValid());
+    });
+}
+
+// Stops block once everything stacked on it is stopped, the leaves first: a
+// cleartext device can't be locked while a partition or a logical volume on it
+// is in use. done is called with false if a step failed, block is then left as is.
+void DDiskManagerPrivate::removalTeardown(const RemovalPointer &removal, int block, const std::function<void(bool)> &done)
+{
+    QList<int> children;
+
+    for (int child : stackedBlocks(block)) {
+        // a logical volume spanning two physical volumes of the drive is stopped once
+        if (!removal->visited.contains(child)) {
+            removal->visited.insert(child);
+            children << child;
+        }
+    }
 
-            Q_EMIT blockDeviceAdded(path);
+    const auto stop = [this, removal, block, done] (bool ok) {
+        if (ok) {
+            removalStopBlock(removal, block, done);
+        } else {
+            done(false);
         }
+    };
 
-        if (interfaces_and_properties.contains(QStringLiteral(UDISKS2_SERVICE ".Filesystem"))) {
-            Q_D(DDiskManager);
+    if (children.isEmpty()) {
+        stop(true);
+        return;
+    }
 
-            d->blockDeviceMountPointsMap.remove(object_path.path());
+    QSharedPointer<int> pending(new int(children.count()));
+    QSharedPointer<bool> ok(new bool(true));
 
-            Q_EMIT fileSystemAdded(path);
-        }
-    } else if (path.startsWith(path_job)) {
-        if (interfaces_and_properties.contains(QStringLiteral(UDISKS2_SERVICE ".Job"))) {
-            Q_EMIT jobAdded(path);
-        }
+    for (int child : children) {
+        removalTeardown(removal, child, [pending, ok, stop] (bool child_ok) {
+            *ok = *ok && child_ok;
+
+            if (--*pending == 0)
+                stop(*ok);
+        });
     }
 }
 
-void DDiskManager::onInterfacesRemoved(const QDBusObjectPath &object_path, const QStringList &interfaces)
+// The steps of block itself, one after another
+void DDiskManagerPrivate::removalStopBlock(const RemovalPointer &removal, int block, const std::function<void(bool)> &done)
 {
-    const QString &path = object_path.path();
+    const InterfaceMap &interfaces = objects.value(block);
+    const QString &path = paths.name(block);
+    const int block_lvm2 = interfaceIds.find(UDISKS2_SERVICE ".Block.LVM2");
+    QList<QPair<DDiskRemovalStep::Action, QString>> steps;
 
-    Q_D(DDiskManager);
+    if (!mountPoints(block).isEmpty())
+        steps << qMakePair(DDiskRemovalStep::Unmount, path);
 
-    for (const QString &i : interfaces) {
-        if (i == QStringLiteral(UDISKS2_SERVICE ".Drive")) {
-            d->diskDeviceAddSignalFlag.remove(path);
+    if (interfaces.value(DInterfaceTable::Swapspace).value("Active").toBool())
+        steps << qMakePair(DDiskRemovalStep::StopSwap, path);
 
-            Q_EMIT diskDeviceRemoved(path);
-        } else if (i == QStringLiteral(UDISKS2_SERVICE ".Filesystem")) {
-            d->blockDeviceMountPointsMap.remove(object_path.path());
+    if (interfaces.contains(DInterfaceTable::Encrypted)) {
+        const QString &cleartext = interfaces.value(DInterfaceTable::Encrypted).value("CleartextDevice").toString();
 
-            Q_EMIT fileSystemRemoved(path);
-        } else if (i == QStringLiteral(UDISKS2_SERVICE ".Block")) {
-            Q_EMIT blockDeviceRemoved(path);
-        }
+        // locked already otherwise
+        if (cleartext.length() > 1)
+            steps << qMakePair(DDiskRemovalStep::Lock, path);
     }
-}
-
-void DDiskManager::onPropertiesChanged(const QString &interface, const QVariantMap &changed_properties, const QDBusMessage &message)
-{
-    Q_D(DDiskManager);
 
-    const QString &path = message.path();
+    if (block_lvm2 >= 0) {
+        const QString &lv = interfaces.value(block_lvm2).value("LogicalVolume").toString();
 
-    if (changed_properties.contains("Optical")) {
-        Q_EMIT opticalChanged(path);
+        if (lv.length() > 1)
+            steps << qMakePair(DDiskRemovalStep::DeactivateLogicalVolume, lv);
     }
 
-    if (interface != UDISKS2_SERVICE ".Filesystem") {
+    if (steps.isEmpty()) {
+        done(true);
         return;
     }
 
-    if (!changed_properties.contains("MountPoints")) {
-        return;
-    }
+    QSharedPointer<QList<QPair<DDiskRemovalStep::Action, QString>>> remaining(new QList<QPair<DDiskRemovalStep::Action, QString>>(steps));
+    QSharedPointer<std::function<void(bool)>> next(new std::function<void(bool)>);
 
-    const QByteArrayList old_mount_points = d->blockDeviceMountPointsMap.value(path);
-    const QByteArrayList &new_mount_points = qdbus_cast<QByteArrayList>(changed_properties.value("MountPoints"));
+    // each step runs once the previous one succeeded, the cycle through next is broken at the end
+    *next = [this, removal, remaining, done, next] (bool ok) {
+        if (!ok || remaining->isEmpty()) {
+            const std::function<void(bool)> callback = done;
 
-    d->blockDeviceMountPointsMap[path] = new_mount_points;
+            *next = nullptr;
+            callback(ok);
+            return;
+        }
 
-    Q_EMIT mountPointsChanged(path, old_mount_points, new_mount_points);
+        const QPair<DDiskRemovalStep::Action, QString> step = remaining->takeFirst();
 
-    if (old_mount_points.isEmpty()) {
-        if (!new_mount_points.isEmpty()) {
-            Q_EMIT mountAdded(path, new_mount_points.first());
-        }
-    } else if (new_mount_points.isEmpty()) {
-        Q_EMIT mountRemoved(path, old_mount_points.first());
+        removalStep(removal, step.first, step.second, *next);
+    };
+
+    (*next)(true);
+}
+
+void DDiskManagerPrivate::removalChainFinished(const RemovalPointer &removal)
+{
+    if (--removal->chains > 0)
+        return;
+
+    // some filesystem is still in use
+    if (removal->error.isValid()) {
+        removalFinished(removal);
+        return;
     }
+
+    const QVariantMap &drive = objects.value(paths.id(removal->drive)).value(DInterfaceTable::Drive);
+    const auto finish = [this, removal] {
+        removalFinished(removal);
+    };
+
+    if (drive.value("CanPowerOff").toBool()) {
+        removalStep(removal, DDiskRemovalStep::PowerOff, removal->drive, [finish] (bool) {
+            finish();
+        });
+    } else if (drive.value("Ejectable").toBool()) {
+        removalStep(removal, DDiskRemovalStep::Eject, removal->drive, [finish] (bool) {
+            finish();
+        });
+    } else {
+        QTimer::singleShot(0, q_ptr, finish);
+    }
+}
+
+void DDiskManagerPrivate::removalFinished(const RemovalPointer &removal)
+{
+    Q_Q(DDiskManager);
+
+    Q_EMIT q->safelyRemoveFinished(removal->id, removal->drive, removal->steps, removal->error);
 }
 
 /*!
- * \class DDiskManager
- * \inmodule dde-file-manager-lib
+ * \brief Unmount, lock and power off the drive \a drivePath in one go.
  *
- * \brief DDiskManager provide severial ways to manage devices and partitions.
+ * The block devices of the drive are found in the known topology, with
+ * everything stacked on them: partitions, cleartext devices and the LVM
+ * logical volumes on them, at any depth. Each tree is taken down from its
+ * leaves, the trees in parallel: a mounted filesystem is unmounted, an active
+ * swap area stopped, a logical volume deactivated and an encrypted device
+ * locked once everything on its cleartext device is. When all succeeded the
+ * drive is powered off, or ejected if it can't be. \a options is passed to
+ * every call, like "auth.no_user_interaction".
  *
- * \sa DBlockPartition, DBlockDevice, UDiskDeviceInfo
+ * Each call is reported with its duration by safelyRemoveStepFinished() and
+ * all of them by safelyRemoveFinished() with the returned id. The first error
+ * stops its chain and cancels the power off. This enables watchChanges().
+ *
+ * \sa DDiskDevice::powerOff(), DDiskDevice::eject()
  */
-
-DDiskManager::DDiskManager(QObject *parent)
-    : QObject(parent)
-    , d_ptr(new DDiskManagerPrivate(this))
+int DDiskManager::safelyRemove(const QString &drivePath, const QVariantMap &options)
 {
+    Q_D(DDiskManager);
 
-}
+    setWatchChanges(true);
 
-DDiskManager::~DDiskManager()
-{
+    DDiskManagerPrivate::RemovalPointer removal(new DDiskManagerPrivate::Removal);
 
-}
+    removal->id = ++d->lastBatchId;
+    removal->drive = drivePath;
+    removal->options = options;
 
-static QStringList getDBusNodeNameList(const QString &service, const QString &path, const QDBusConnection &connection)
-{
-    QDBusInterface ud2(service, path, "org.freedesktop.DBus.Introspectable", connection);
-    QDBusReply<QString> reply = ud2.call("Introspect");
-    QXmlStreamReader xml_parser(reply.value());
-    QStringList nodeList;
+    const int drive = d->paths.id(drivePath);
 
-    while (!xml_parser.atEnd()) {
-        xml_parser.readNext();
+    if (drive < 0 || !d->objects.value(drive).contains(DInterfaceTable::Drive)) {
+        removal->error = QDBusError(QDBusError::InvalidArgs, QStringLiteral("Unknown drive %1").arg(drivePath));
 
-        if (xml_parser.tokenType() == QXmlStreamReader::StartElement
-                && xml_parser.name().toString() == "node") {
-            const QString &name = xml_parser.attributes().value("name").toString();
+        QTimer::singleShot(0, this, [d, removal] {
+            d->removalFinished(removal);
+        });
 
-            if (!name.isEmpty()) {
-                nodeList << path + "/" + name;
-            }
-        }
+        return removal->id;
     }
 
-    return nodeList;
-}
+    const QSet<int> &blocks = d->blocksOfDrive.value(drive);
+    // one chain per tree, its root is a block of the drive not on another one of them
+    QList<int> roots;
 
-QStringList DDiskManager::blockDevices() const
-{
-    return getDBusNodeNameList(UDISKS2_SERVICE, "/org/freedesktop/UDisks2/block_devices", QDBusConnection::systemBus());
-}
+    for (int block : blocks) {
+        const QString &table = d->objects.value(block).value(DInterfaceTable::Partition).value("Table").toString();
 
-QStringList DDiskManager::diskDevices() const
-{
-    return getDBusNodeNameList(UDISKS2_SERVICE, "/org/freedesktop/UDisks2/drives", QDBusConnection::systemBus());
-}
+        if (!blocks.contains(d->paths.id(table))) {
+            roots << block;
+            removal->visited.insert(block);
+        }
+    }
 
-QStringList DDiskManager::blockDevices(QVariantMap options)
-{
-    OrgFreedesktopUDisks2ManagerInterface udisksmgr(UDISKS2_SERVICE, ManagerPath, QDBusConnection::systemBus());
+    // a chain with nothing to stop finishes right away, after all of them are counted
+    removal->chains = roots.count() + 1;
 
-    auto reply = udisksmgr.GetBlockDevices(options);
-    reply.waitForFinished();
-    QList<QDBusObjectPath> resultList = reply.value();
-    QStringList dbusPaths;
-    for (const QDBusObjectPath &singleResult : resultList) {
-        dbusPaths << singleResult.path();
+    for (int root : roots) {
+        d->removalTeardown(removal, root, [d, removal] (bool) {
+            d->removalChainFinished(removal);
+        });
     }
-    return dbusPaths;
-}
 
-bool DDiskManager::watchChanges() const
-{
-    Q_D(const DDiskManager);
+    d->removalChainFinished(removal);
 
-    return d->watchChanges;
+    return removal->id;
 }
 
 QString DDiskManager::objectPrintable(const QObject *object)
@@ -313,15 +1853,144 @@ QString DDiskManager::objectPrintable(const QObject *object)
     return string;
 }
 
+/*!
+ * \brief A snapshot of the properties of the block device \a path.
+ *
+ * While watchChanges() is enabled this doesn't make any D-Bus call.
+ *
+ * \sa blockDeviceInfoList(), DBlockDeviceInfo
+ */
+DBlockDeviceInfo DDiskManager::blockDeviceInfo(const QString &path) const
+{
+    Q_D(const DDiskManager);
+
+    return DBlockDeviceInfo(path, d->interfaces(path));
+}
+
+/*!
+ * \brief Snapshots of all the block devices, taken at once.
+ *
+ * Unlike creating a DBlockDevice per device, this makes at most one D-Bus call
+ * and no QObject.
+ */
+QList<DBlockDeviceInfo> DDiskManager::blockDeviceInfoList() const
+{
+    Q_D(const DDiskManager);
+
+    const DDiskManagerPrivate::ObjectMap &objects = d->snapshot();
+    QList<DBlockDeviceInfo> list;
+
+    for (auto i = objects.constBegin(); i != objects.constEnd(); ++i) {
+        if (i.value().contains(QStringLiteral(UDISKS2_SERVICE ".Block"))) {
+            list << DBlockDeviceInfo(i.key(), i.value());
+        }
+    }
+
+    return list;
+}
+
+DDriveInfo DDiskManager::driveInfo(const QString &path) const
+{
+    Q_D(const DDiskManager);
+
+    return DDriveInfo(path, d->interfaces(path));
+}
+
+QList<DDriveInfo> DDiskManager::driveInfoList() const
+{
+    Q_D(const DDiskManager);
+
+    const DDiskManagerPrivate::ObjectMap &objects = d->snapshot();
+    QList<DDriveInfo> list;
+
+    for (auto i = objects.constBegin(); i != objects.constEnd(); ++i) {
+        if (i.value().contains(QStringLiteral(UDISKS2_SERVICE ".Drive"))) {
+            list << DDriveInfo(i.key(), i.value());
+        }
+    }
+
+    return list;
+}
+
+/*!
+ * \brief The paths of the block devices matching \a filter, sorted.
+ *
+ * While watchChanges() is enabled the query runs on the local state: the
+ * hint, removable, idType and mounted conditions are answered by indexes and
+ * only the remaining candidates are checked one by one. Otherwise it makes one
+ * GetManagedObjects call.
+ *
+ * \sa createQuery(), DBlockDeviceFilter
+ */
+QStringList DDiskManager::query(const DBlockDeviceFilter &filter) const
+{
+    Q_D(const DDiskManager);
+
+    QStringList list;
+
+    if (d->watchChanges) {
+        QSet<int> candidates;
+
+        if (!d->candidates(filter, &candidates))
+            candidates = d->blockIndex;
+
+        for (int path : candidates) {
+            if (d->matches(filter, path))
+                list << d->paths.name(path);
+        }
+    } else {
+        const DDiskManagerPrivate::ObjectMap &objects = d->snapshot();
+
+        for (auto i = objects.constBegin(); i != objects.constEnd(); ++i) {
+            if (d->matches(filter, i.key(), objects))
+                list << i.key();
+        }
+    }
+
+    std::sort(list.begin(), list.end());
+
+    return list;
+}
+
+bool DDiskManager::matches(const DBlockDeviceFilter &filter, const QString &blockDevicePath) const
+{
+    Q_D(const DDiskManager);
+
+    if (d->watchChanges) {
+        return d->matches(filter, d->paths.id(blockDevicePath));
+    }
+
+    return d->matches(filter, blockDevicePath, d->snapshot());
+}
+
+/*!
+ * \brief A live query: its result follows the changes of the devices.
+ *
+ * This enables watchChanges().
+ */
+DBlockDeviceQuery *DDiskManager::createQuery(const DBlockDeviceFilter &filter, QObject *parent)
+{
+    setWatchChanges(true);
+
+    return new DBlockDeviceQuery(this, filter, parent);
+}
+
 DBlockDevice *DDiskManager::createBlockDevice(const QString &path, QObject *parent)
 {
     return new DBlockDevice(path, parent);
 }
 
+DBlockDevice *DDiskManager::createBlockDevice(const QString &path, const QDBusConnection &connection, QObject *parent)
+{
+    return new DBlockDevice(path, connection, parent);
+}
+
 DBlockDevice *DDiskManager::createBlockDeviceByDevicePath(const QByteArray &path, QObject *parent) const
 {
+    Q_D(const DDiskManager);
+
     for (const QString &block : blockDevices()) {
-        DBlockDevice *device = new DBlockDevice(block, parent);
+        DBlockDevice *device = new DBlockDevice(block, d->connection, parent);
 
         if (device->device() == path) {
             return device;
@@ -338,10 +2007,17 @@ DBlockPartition *DDiskManager::createBlockPartition(const QString &path, QObject
     return new DBlockPartition(path, parent);
 }
 
+DBlockPartition *DDiskManager::createBlockPartition(const QString &path, const QDBusConnection &connection, QObject *parent)
+{
+    return new DBlockPartition(path, connection, parent);
+}
+
 DBlockPartition *DDiskManager::createBlockPartitionByMountPoint(const QByteArray &path, QObject *parent) const
 {
+    Q_D(const DDiskManager);
+
     for (const QString &block : blockDevices()) {
-        DBlockPartition *device = new DBlockPartition(block, parent);
+        DBlockPartition *device = new DBlockPartition(block, d->connection, parent);
 
         if (device->mountPoints().contains(path)) {
             return device;
@@ -363,21 +2039,45 @@ DDiskDevice *DDiskManager::createDiskDevice(const QString &path, QObject *parent
     return new DDiskDevice(path, parent);
 }
 
+DDiskDevice *DDiskManager::createDiskDevice(const QString &path, const QDBusConnection &connection, QObject *parent)
+{
+    return new DDiskDevice(path, connection, parent);
+}
+
 DUDisksJob *DDiskManager::createJob(const QString &path, QObject *parent)
 {
     return new DUDisksJob(path, parent);
 }
 
+DUDisksJob *DDiskManager::createJob(const QString &path, const QDBusConnection &connection, QObject *parent)
+{
+    return new DUDisksJob(path, connection, parent);
+}
+
+DPartitionTable *DDiskManager::createPartitionTable(const QString &path, QObject *parent)
+{
+    return new DPartitionTable(path, QDBusConnection::systemBus(), parent);
+}
+
+DPartitionTable *DDiskManager::createPartitionTable(const QString &path, const QDBusConnection &connection, QObject *parent)
+{
+    return new DPartitionTable(path, connection, parent);
+}
+
+/*!
+ * \brief The filesystems supported by UDisks2.
+ *
+ * The result of this and of the Can* functions is cached for the whole process
+ * until udisksd restarts or enableModules() is called.
+ */
 QStringList DDiskManager::supportedFilesystems()
 {
-    OrgFreedesktopUDisks2ManagerInterface udisksmgr(UDISKS2_SERVICE, ManagerPath, QDBusConnection::systemBus());
-    return udisksmgr.supportedFilesystems();
+    return DCapabilityCache::instance()->supportedFilesystems();
 }
 
 QStringList DDiskManager::supportedEncryptionTypes()
 {
-    OrgFreedesktopUDisks2ManagerInterface udisksmgr(UDISKS2_SERVICE, ManagerPath, QDBusConnection::systemBus());
-    return udisksmgr.supportedEncryptionTypes();
+    return DCapabilityCache::instance()->supportedEncryptionTypes();
 }
 
 QStringList DDiskManager::resolveDevice(QVariantMap devspec, QVariantMap options)
@@ -401,58 +2101,22 @@ QStringList DDiskManager::resolveDeviceNode(QString devnode, QVariantMap options
 
 bool DDiskManager::canCheck(const QString &type, QString *requiredUtil)
 {
-    OrgFreedesktopUDisks2ManagerInterface udisksmgr(UDISKS2_SERVICE, ManagerPath, QDBusConnection::systemBus());
-    auto r = udisksmgr.CanCheck(type);
-    r.waitForFinished();
-    if (r.isError()) {
-        return false;
-    }
-    if (requiredUtil) {
-        *requiredUtil = r.value().second;
-    }
-    return r.value().first;
+    return DCapabilityCache::instance()->can(DCapabilityCache::Check, type, requiredUtil);
 }
 
 bool DDiskManager::canFormat(const QString &type, QString *requiredUtil)
 {
-    OrgFreedesktopUDisks2ManagerInterface udisksmgr(UDISKS2_SERVICE, ManagerPath, QDBusConnection::systemBus());
-    auto r = udisksmgr.CanFormat(type);
-    r.waitForFinished();
-    if (r.isError()) {
-        return false;
-    }
-    if (requiredUtil) {
-        *requiredUtil = r.value().second;
-    }
-    return r.value().first;
+    return DCapabilityCache::instance()->can(DCapabilityCache::Format, type, requiredUtil);
 }
 
 bool DDiskManager::canRepair(const QString &type, QString *requiredUtil)
 {
-    OrgFreedesktopUDisks2ManagerInterface udisksmgr(UDISKS2_SERVICE, ManagerPath, QDBusConnection::systemBus());
-    auto r = udisksmgr.CanRepair(type);
-    r.waitForFinished();
-    if (r.isError()) {
-        return false;
-    }
-    if (requiredUtil) {
-        *requiredUtil = r.value().second;
-    }
-    return r.value().first;
+    return DCapabilityCache::instance()->can(DCapabilityCache::Repair, type, requiredUtil);
 }
 
 bool DDiskManager::canResize(const QString &type, QString *requiredUtil)
 {
-    OrgFreedesktopUDisks2ManagerInterface udisksmgr(UDISKS2_SERVICE, ManagerPath, QDBusConnection::systemBus());
-    auto r = udisksmgr.CanRepair(type);
-    r.waitForFinished();
-    if (r.isError()) {
-        return false;
-    }
-    if (requiredUtil) {
-        *requiredUtil = r.value().second;
-    }
-    return r.value().first;
+    return DCapabilityCache::instance()->can(DCapabilityCache::Resize, type, requiredUtil);
 }
 
 QString DDiskManager::loopSetup(int fd, QVariantMap options)
@@ -465,11 +2129,32 @@ QString DDiskManager::loopSetup(int fd, QVariantMap options)
     return r.value().path();
 }
 
+/*!
+ * \brief Load the UDisks2 modules (lvm2, iscsi...), only true is accepted by udisksd.
+ *
+ * The cached capabilities are dropped since the modules may add filesystems.
+ */
+bool DDiskManager::enableModules(bool enable)
+{
+    OrgFreedesktopUDisks2ManagerInterface udisksmgr(UDISKS2_SERVICE, ManagerPath, QDBusConnection::systemBus());
+    auto r = udisksmgr.EnableModules(enable);
+    r.waitForFinished();
+    DCapabilityCache::instance()->invalidate();
+    return !r.isError();
+}
+
 QDBusError DDiskManager::lastError()
 {
     return QDBusConnection::systemBus().lastError();
 }
 
+void DDiskManager::setBatchConcurrency(int batchConcurrency)
+{
+    Q_D(DDiskManager);
+
+    d->callQueue.setMaxConcurrentCalls(batchConcurrency);
+}
+
 void DDiskManager::setWatchChanges(bool watchChanges)
 {
     Q_D(DDiskManager);
@@ -477,28 +2162,104 @@ void DDiskManager::setWatchChanges(bool watchChanges)
     if (d->watchChanges == watchChanges)
         return;
 
-    OrgFreedesktopDBusObjectManagerInterface *object_manager = UDisks2::objectManager();
-    auto sc = QDBusConnection::systemBus();
+    d->watchChanges = watchChanges;
+    ++d->resyncSerial;
+
+    auto sc = d->connection;
+    OrgFreedesktopDBusObjectManagerInterface *object_manager = UDisks2::objectManager(sc);
 
     if (watchChanges) {
         connect(object_manager, &OrgFreedesktopDBusObjectManagerInterface::InterfacesAdded,
                 this, &DDiskManager::onInterfacesAdded);
         connect(object_manager, &OrgFreedesktopDBusObjectManagerInterface::InterfacesRemoved,
                 this, &DDiskManager::onInterfacesRemoved);
+        // udisksd 重启后只通知真正变化了的设备，已创建的对象仍然有效
+        connect(UDisks2::serviceWatcher(sc), &QDBusServiceWatcher::serviceOwnerChanged,
+                this, &DDiskManager::onServiceOwnerChanged);
 
-        d->updateBlockDeviceMountPointsMap();
+        d->reset(DDiskManagerPrivate::toObjectMap(object_manager->GetManagedObjects().value()));
 
         sc.connect(UDISKS2_SERVICE, QString(), "org.freedesktop.DBus.Properties", "PropertiesChanged",
-                   this, SLOT(onPropertiesChanged(const QString &, const QVariantMap &, const QDBusMessage&)));
+                   this, SLOT(onPropertiesChanged(const QString &, const QVariantMap &, const QStringList &, const QDBusMessage&)));
     } else {
         disconnect(object_manager, &OrgFreedesktopDBusObjectManagerInterface::InterfacesAdded,
                    this, &DDiskManager::onInterfacesAdded);
         disconnect(object_manager, &OrgFreedesktopDBusObjectManagerInterface::InterfacesRemoved,
                    this, &DDiskManager::onInterfacesRemoved);
+        disconnect(UDisks2::serviceWatcher(sc), &QDBusServiceWatcher::serviceOwnerChanged,
+                   this, &DDiskManager::onServiceOwnerChanged);
 
-        d->blockDeviceMountPointsMap.clear();
+        d->clearObjects();
 
         sc.disconnect(UDISKS2_SERVICE, QString(), "org.freedesktop.DBus.Properties", "PropertiesChanged",
-                      this, SLOT(onPropertiesChanged(const QString &, const QVariantMap &, const QDBusMessage&)));
+                      this, SLOT(onPropertiesChanged(const QString &, const QVariantMap &, const QStringList &, const QDBusMessage&)));
+    }
+}
+
+// Starts a journal with the known objects, they are the state the following events apply to
+bool DDiskManager::addEventWriter(DDiskEventWriter *writer)
+{
+    Q_D(DDiskManager);
+
+    setWatchChanges(true);
+
+    DDiskEvent event;
+
+    event.type = DDiskEvent::Snapshot;
+    event.objects = d->snapshot();
+
+    if (!writer->writeHeader() || !writer->write(event))
+        return false;
+
+    d->eventWriters.append(writer);
+
+    return true;
+}
+
+void DDiskManager::removeEventWriter(DDiskEventWriter *writer)
+{
+    Q_D(DDiskManager);
+
+    d->eventWriters.removeOne(writer);
+}
+
+// Handles a recorded event like the notification it was recorded from
+void DDiskManager::replayEvent(const DDiskEvent &event)
+{
+    Q_D(DDiskManager);
+
+    d->record(event);
+
+    const bool was_suspended = d->recordSuspended;
+
+    d->recordSuspended = true;
+
+    switch (event.type) {
+    case DDiskEvent::Snapshot:
+        // the first one is the initial state, not a change
+        if (d->watchChanges) {
+            d->resync(event.objects);
+        } else {
+            d->watchChanges = true;
+            d->reset(event.objects);
+        }
+        break;
+    case DDiskEvent::InterfacesAdded:
+        onInterfacesAdded(QDBusObjectPath(event.path), event.objects.value(event.path));
+        break;
+    case DDiskEvent::InterfacesRemoved:
+        onInterfacesRemoved(QDBusObjectPath(event.path), event.names);
+        break;
+    case DDiskEvent::PropertiesChanged:
+        d->handlePropertiesChanged(event.path, event.interface, event.properties, event.names);
+        break;
+    case DDiskEvent::ServiceOwnerChanged:
+        // drop a resync in progress, the recorded one follows as a Snapshot
+        ++d->resyncSerial;
+        break;
+    default:
+        break;
     }
+
+    d->recordSuspended = was_suspended;
 }
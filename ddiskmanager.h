@@ -7,6 +7,7 @@
 
 #include <QObject>
 #include <QMap>
+#include <QDBusConnection>
 #include <QDBusError>
 
 QT_BEGIN_NAMESPACE
@@ -14,39 +15,98 @@ class QDBusObjectPath;
 class QStorageInfo;
 QT_END_NAMESPACE
 
+// One D-Bus call of DDiskManager::safelyRemove()
+struct DDiskRemovalStep
+{
+    enum Action {
+        Unmount,
+        Lock,
+        PowerOff,
+        Eject,
+        StopSwap,
+        DeactivateLogicalVolume
+    };
+
+    Action action = Unmount;
+    // the block device, the drive for PowerOff and Eject, the logical volume for DeactivateLogicalVolume
+    QString path;
+    qint64 elapsed = 0; // msecs
+    QDBusError error;
+};
+
+Q_DECLARE_METATYPE(DDiskRemovalStep)
+
 class DBlockDevice;
 class DBlockPartition;
 class DDiskDevice;
 class DUDisksJob;
+class DPartitionTable;
+class DBlockDeviceInfo;
+class DDriveInfo;
+class DBlockDeviceFilter;
+class DBlockDeviceQuery;
 class DDiskManagerPrivate;
+class DDiskEventWriter;
+struct DDiskEvent;
 class DDiskManager : public QObject
 {
     Q_OBJECT
     Q_DECLARE_PRIVATE(DDiskManager)
 
     Q_PROPERTY(bool watchChanges READ watchChanges WRITE setWatchChanges)
+    Q_PROPERTY(int batchConcurrency READ batchConcurrency WRITE setBatchConcurrency)
 
 public:
     explicit DDiskManager(QObject *parent = nullptr);
+    // all devices found and created by this object will use the given connection
+    explicit DDiskManager(const QDBusConnection &connection, QObject *parent = nullptr);
     ~DDiskManager();
 
+    QDBusConnection connection() const;
+
     Q_DECL_DEPRECATED_X("Use the static variant instead") QStringList blockDevices() const;
     QStringList diskDevices() const;
 
     static QStringList blockDevices(QVariantMap options);
 
     bool watchChanges() const;
+    int batchConcurrency() const;
+
+    // 异步批量挂载/卸载，返回批次 id，结果通过 mountAllFinished/unmountAllFinished 返回
+    int mountAll(const QStringList &paths, const QVariantMap &options);
+    int unmountAll(const QStringList &paths, const QVariantMap &options);
+    // 异步批量解锁加密设备，结果通过 unlockManyFinished 返回
+    int unlockMany(const QStringList &paths, const QString &passphrase, const QVariantMap &options);
+    // the key is read from keyfileFd now and sent as "keyfile_contents", the fd is not closed
+    int unlockMany(const QStringList &paths, int keyfileFd, const QVariantMap &options);
+    // 异步安全移除：卸载、锁定加密设备、断电或弹出，结果通过 safelyRemoveFinished 返回
+    int safelyRemove(const QString &drivePath, const QVariantMap &options = QVariantMap());
 
     static QString objectPrintable(const QObject *object);
     static DBlockDevice *createBlockDevice(const QString &path, QObject *parent = nullptr);
+    static DBlockDevice *createBlockDevice(const QString &path, const QDBusConnection &connection, QObject *parent = nullptr);
     // device 路径以 '\0' 结尾
     DBlockDevice *createBlockDeviceByDevicePath(const QByteArray &path, QObject *parent = nullptr) const;
     static DBlockPartition *createBlockPartition(const QString &path, QObject *parent = nullptr);
+    static DBlockPartition *createBlockPartition(const QString &path, const QDBusConnection &connection, QObject *parent = nullptr);
     // 挂载点以 '\0' 结尾
     DBlockPartition *createBlockPartitionByMountPoint(const QByteArray &path, QObject *parent = nullptr) const;
     DBlockPartition *createBlockPartition(const QStorageInfo &info, QObject *parent = nullptr) const;
     static DDiskDevice *createDiskDevice(const QString &path, QObject *parent = nullptr);
+    static DDiskDevice *createDiskDevice(const QString &path, const QDBusConnection &connection, QObject *parent = nullptr);
     static DUDisksJob *createJob(const QString &path, QObject *parent = nullptr);
+    static DUDisksJob *createJob(const QString &path, const QDBusConnection &connection, QObject *parent = nullptr);
+    static DPartitionTable *createPartitionTable(const QString &path, QObject *parent = nullptr);
+    static DPartitionTable *createPartitionTable(const QString &path, const QDBusConnection &connection, QObject *parent = nullptr);
+
+    DBlockDeviceInfo blockDeviceInfo(const QString &path) const;
+    QList<DBlockDeviceInfo> blockDeviceInfoList() const;
+    DDriveInfo driveInfo(const QString &path) const;
+    QList<DDriveInfo> driveInfoList() const;
+
+    QStringList query(const DBlockDeviceFilter &filter) const;
+    bool matches(const DBlockDeviceFilter &filter, const QString &blockDevicePath) const;
+    DBlockDeviceQuery *createQuery(const DBlockDeviceFilter &filter, QObject *parent = nullptr);
 
     static QStringList supportedFilesystems();
     static QStringList supportedEncryptionTypes();
@@ -57,11 +117,13 @@ public:
     static bool canRepair(const QString &type, QString *requiredUtil = nullptr);
     static bool canResize(const QString &type, QString *requiredUtil = nullptr);
     static QString loopSetup(int fd, QVariantMap options);
+    static bool enableModules(bool enable = true);
 
     static QDBusError lastError();
 
 public Q_SLOTS:
     void setWatchChanges(bool watchChanges);
+    void setBatchConcurrency(int batchConcurrency);
 
 Q_SIGNALS:
     void blockDeviceAdded(const QString &path);
@@ -75,14 +137,37 @@ Q_SIGNALS:
     void mountPointsChanged(const QString &blockDevicePath, const QByteArrayList &oldMountPoints, const QByteArrayList &newMountPoints);
     void jobAdded(const QString &jobPath);
     void opticalChanged(const QString &path);
+    // every interface an object gained or lost, after the signals above for the known ones
+    void interfacesAdded(const QString &path, const QStringList &interfaces);
+    void interfacesRemoved(const QString &path, const QStringList &interfaces);
+    // only the properties whose value really changed, like after a restart of udisksd
+    void propertiesChanged(const QString &path, const QString &interface, const QStringList &properties);
+    void mountAllFinished(int batchId, const QMap<QString, QString> &mountPoints, const QMap<QString, QDBusError> &errors);
+    void unmountAllFinished(int batchId, const QMap<QString, QDBusError> &errors);
+    // encrypted block device path -> its cleartext block device path, known by this manager
+    void unlockManyFinished(int batchId, const QMap<QString, QString> &cleartextDevices, const QMap<QString, QDBusError> &errors);
+    void safelyRemoveStepFinished(int id, const DDiskRemovalStep &step);
+    // error is the first failed step, the drive is not powered off nor ejected then
+    void safelyRemoveFinished(int id, const QString &drivePath, const QList<DDiskRemovalStep> &steps, const QDBusError &error);
 
 private:
     QScopedPointer<DDiskManagerPrivate> d_ptr;
 
+    // for DDiskEventRecorder and DDiskEventReplayer
+    bool addEventWriter(DDiskEventWriter *writer);
+    void removeEventWriter(DDiskEventWriter *writer);
+    void replayEvent(const DDiskEvent &event);
+
+    friend class DDiskManagerPrivate;
+    friend class DDiskEventRecorder;
+    friend class DDiskEventReplayer;
+
 private Q_SLOTS:
     void onInterfacesAdded(const QDBusObjectPath &, const QMap<QString, QVariantMap> &);
     void onInterfacesRemoved(const QDBusObjectPath &object_path, const QStringList &interfaces);
-    void onPropertiesChanged(const QString &interface, const QVariantMap &changed_properties, const QDBusMessage &message);
+    void onPropertiesChanged(const QString &interface, const QVariantMap &changed_properties,
+                             const QStringList &invalidated_properties, const QDBusMessage &message);
+    void onServiceOwnerChanged(const QString &service, const QString &oldOwner, const QString &newOwner);
 };
 
 #endif // DDISKMANAGER_H
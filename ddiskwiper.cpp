@@ -0,0 +1,671 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "ddiskwiper.h"
+#include "ddiskmanager.h"
+#include "dblockdevice.h"
+#include "private/dblockio_p.h"
+#include "private/dmemcompare_p.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTimer>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+
+namespace {
+using DBlockIO::Alignment;
+using DBlockIO::AlignedBuffer;
+using DBlockIO::readAll;
+using DBlockIO::writeAll;
+
+// the random pattern is generated by units of this size
+const size_t PatternUnit = 4096;
+const size_t SampleSize = 64 * 1024;
+
+inline quint64 splitmix64(quint64 &state)
+{
+    quint64 z = (state += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+    return z ^ (z >> 31);
+}
+
+// The data of a unit depends only on the seed of the pass and on the offset of the unit,
+// the verification generates it again instead of keeping what was written.
+// Not cryptographic: the old data is gone either way, nothing has to be unpredictable.
+void fillRandom(uchar *buffer, quint64 offset, size_t length, quint64 seed)
+{
+    quint64 words[PatternUnit / sizeof(quint64)];
+
+    while (length > 0) {
+        const quint64 unit = offset / PatternUnit;
+        const size_t skip = offset % PatternUnit;
+        const size_t count = qMin(length, PatternUnit - skip);
+        quint64 state = seed ^ (unit * 0xd1342543de82ef95ULL);
+
+        for (quint64 &word : words) {
+            word = splitmix64(state);
+        }
+
+        memcpy(buffer, reinterpret_cast<const uchar *>(words) + skip, count);
+        buffer += count;
+        offset += count;
+        length -= count;
+    }
+}
+}
+
+class DDiskWiperPrivate
+{
+public:
+    explicit DDiskWiperPrivate(DDiskWiper *qq)
+        : q_ptr(qq)
+    {
+
+    }
+
+    ~DDiskWiperPrivate();
+
+    // in the thread of the wipe
+    void run();
+    bool overwrite(int pass);
+    bool verify(DDiskWiper::Pattern pattern, quint64 seed, int samples);
+    void fail(const QString &message);
+    void failWithErrno(const QString &what);
+
+    void poll();
+    void reset();
+
+    DDiskWiper::Pattern pattern = DDiskWiper::Zeros;
+    int passes = 1;
+    int threads = 0;
+    int blockSize = 4 * 1024 * 1024;
+    int verifySamples = 64;
+    bool deviceCommandsEnabled = true;
+
+    int fd = -1;
+    bool isBlockDevice = false;
+    quint64 size = 0;
+    std::vector<quint64> seeds; // of every pass
+    std::thread thread;
+    std::atomic<bool> running {false};
+    std::atomic<bool> done {false};
+    std::atomic<bool> cancelled {false};
+    std::atomic<quint64> written {0};
+    std::atomic<int> passesDone {0};
+    std::atomic<int> method {DDiskWiper::NoMethod};
+    // set by the thread of the wipe before done, read after it was joined
+    bool success = false;
+    QString errorString;
+
+    QTimer timer;
+    QElapsedTimer clock;
+    quint64 lastWritten = 0;
+    qint64 lastTime = 0;
+    double throughput = 0;
+    int passesReported = 0;
+
+    DDiskWiper *q_ptr;
+
+    Q_DECLARE_PUBLIC(DDiskWiper)
+};
+
+DDiskWiperPrivate::~DDiskWiperPrivate()
+{
+    cancelled = true;
+
+    if (thread.joinable())
+        thread.join();
+
+    if (fd >= 0)
+        ::close(fd);
+}
+
+void DDiskWiperPrivate::run()
+{
+    bool ok = true;
+
+    // one pass of zeros may be done by the device itself: a discard is instant on
+    // a SSD but reading zeros after it is not guaranteed, so it is checked
+    if (deviceCommandsEnabled && isBlockDevice && pattern == DDiskWiper::Zeros && passes == 1) {
+        quint64 range[2] = {0, size};
+
+        if (::ioctl(fd, BLKDISCARD, range) == 0 && verify(DDiskWiper::Zeros, 0, qMax(verifySamples, 16))) {
+            method = DDiskWiper::Discard;
+        } else {
+            // the failed check isn't an error of the wipe
+            errorString.clear();
+
+            if (::ioctl(fd, BLKZEROOUT, range) == 0)
+                method = DDiskWiper::ZeroOut;
+        }
+
+        if (method != DDiskWiper::NoMethod) {
+            written = size;
+            passesDone = 1;
+        }
+    }
+
+    if (method == DDiskWiper::NoMethod) {
+        method = DDiskWiper::Overwrite;
+
+        for (int pass = 0; pass < passes && ok; ++pass) {
+            ok = overwrite(pass);
+
+            if (ok)
+                ++passesDone;
+        }
+    }
+
+    if (ok && !cancelled && method != DDiskWiper::Discard && verifySamples > 0)
+        ok = verify(pattern, seeds.back(), verifySamples);
+
+    if (cancelled)
+        fail(QStringLiteral("Cancelled"));
+
+    success = ok && !cancelled;
+    done = true;
+}
+
+// The blocks are shared out to the threads through one counter, each thread
+// writes a whole block by pwrite() at its offset, so no lock is needed
+bool DDiskWiperPrivate::overwrite(int pass)
+{
+    const quint64 block = static_cast<quint64>(blockSize);
+    const quint64 blocks = (size + block - 1) / block;
+    const quint64 seed = seeds[static_cast<size_t>(pass)];
+    const int count = threads > 0 ? threads : qBound(1, QThread::idealThreadCount(), 8);
+    std::atomic<quint64> next {0};
+    std::atomic<int> error {0};
+    // all the threads write the same zeros
+    AlignedBuffer zeros(pattern == DDiskWiper::Zeros ? block : 0);
+
+    if (pattern == DDiskWiper::Zeros) {
+        if (!zeros.get()) {
+            fail(QStringLiteral("Out of memory"));
+            return false;
+        }
+
+        memset(zeros.get(), 0, block);
+    }
+
+    auto work = [&] {
+        AlignedBuffer random(pattern == DDiskWiper::Random ? block : 0);
+
+        if (pattern == DDiskWiper::Random && !random.get()) {
+            error = ENOMEM;
+            return;
+        }
+
+        while (!cancelled && error == 0) {
+            const quint64 index = next++;
+
+            if (index >= blocks)
+                break;
+
+            const quint64 offset = index * block;
+            const size_t length = static_cast<size_t>(qMin(block, size - offset));
+            const uchar *data = zeros.get();
+
+            if (pattern == DDiskWiper::Random) {
+                fillRandom(random.get(), offset, length, seed);
+                data = random.get();
+            }
+
+            if (!writeAll(fd, data, length, offset)) {
+                int expected = 0;
+
+                error.compare_exchange_strong(expected, errno);
+                break;
+            }
+
+            written += length;
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for (int i = 1; i < count; ++i) {
+        workers.emplace_back(work);
+    }
+
+    work();
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    if (error != 0) {
+        errno = error;
+        failWithErrno(QStringLiteral("Write"));
+        return false;
+    }
+
+    if (cancelled)
+        return false;
+
+    if (::fdatasync(fd) < 0) {
+        failWithErrno(QStringLiteral("Flush"));
+        return false;
+    }
+
+    return true;
+}
+
+// Reads back the first and the last regions and samples - 2 regions at random
+bool DDiskWiperPrivate::verify(DDiskWiper::Pattern pattern, quint64 seed, int samples)
+{
+    AlignedBuffer actual(SampleSize);
+    AlignedBuffer expected(SampleSize);
+
+    if (!actual.get() || !expected.get()) {
+        fail(QStringLiteral("Out of memory"));
+        return false;
+    }
+
+    std::mt19937_64 random(seed ^ size);
+    const quint64 units = (size + Alignment - 1) / Alignment;
+
+    for (int i = 0; i < samples && !cancelled; ++i) {
+        quint64 offset = 0;
+
+        if (i == 1)
+            offset = size > SampleSize ? (size - SampleSize) / Alignment * Alignment : 0;
+        else if (i > 1)
+            offset = random() % units * Alignment;
+
+        const size_t length = static_cast<size_t>(qMin<quint64>(SampleSize, size - offset));
+
+        if (!readAll(fd, actual.get(), length, offset)) {
+            failWithErrno(QStringLiteral("Read"));
+            return false;
+        }
+
+        bool same;
+
+        if (pattern == DDiskWiper::Zeros) {
+            same = DMemCompare::firstNonZero(actual.get(), length) == length;
+        } else {
+            fillRandom(expected.get(), offset, length, seed);
+            same = DMemCompare::firstMismatch(actual.get(), expected.get(), length) == length;
+        }
+
+        if (!same) {
+            fail(QStringLiteral("Verification failed at offset %1").arg(offset));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void DDiskWiperPrivate::fail(const QString &message)
+{
+    if (errorString.isEmpty())
+        errorString = message;
+}
+
+void DDiskWiperPrivate::failWithErrno(const QString &what)
+{
+    fail(QStringLiteral("%1: %2").arg(what, QString::fromLocal8Bit(strerror(errno))));
+}
+
+// In the thread of the wiper, the progress is read from the counters of the wipe
+void DDiskWiperPrivate::poll()
+{
+    Q_Q(DDiskWiper);
+
+    // read first, what the wipe did before it was over is reported below
+    const bool over = done;
+    const qint64 now = clock.elapsed();
+    const quint64 bytes = written;
+
+    if (now > lastTime) {
+        const double instant = (bytes - lastWritten) * 1000.0 / (now - lastTime);
+
+        // smoothed over the last second or so
+        throughput = lastTime == 0 ? instant : throughput * 0.5 + instant * 0.5;
+        lastWritten = bytes;
+        lastTime = now;
+    }
+
+    const quint64 total = size * static_cast<quint64>(passes);
+
+    Q_EMIT q->progressChanged(total > 0 ? qMin(1.0, static_cast<double>(bytes) / total) : 1.0, throughput);
+
+    while (passesReported < passesDone) {
+        Q_EMIT q->passFinished(++passesReported);
+    }
+
+    if (!over)
+        return;
+
+    timer.stop();
+    thread.join();
+    ::close(fd);
+    fd = -1;
+    running = false;
+
+    Q_EMIT q->finished(success);
+}
+
+void DDiskWiperPrivate::reset()
+{
+    done = false;
+    cancelled = false;
+    written = 0;
+    passesDone = 0;
+    method = DDiskWiper::NoMethod;
+    success = false;
+    errorString.clear();
+    lastWritten = 0;
+    lastTime = 0;
+    throughput = 0;
+    passesReported = 0;
+}
+
+/*!
+ * \class DDiskWiper
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief Overwrites a block device or a file, for the drives without secure erase.
+ *
+ * One pass of zeros on a block device is first asked to the device: BLKDISCARD,
+ * kept only if the regions read back are zeros, then BLKZEROOUT. Otherwise the
+ * device is overwritten passes() times by threads() threads, each writing whole
+ * blocks of blockSize() bytes from aligned buffers; block devices are written
+ * with O_DIRECT so that the wipe doesn't flush the page cache of the system,
+ * unless the descriptor can't be opened again for it.
+ *
+ * After the last pass verifySamples() regions are read back and compared with
+ * the pattern. The random pattern is generated from the offset, so nothing
+ * written has to be kept for the verification.
+ *
+ * The wipe runs in its own threads, progressChanged() and passFinished() are
+ * emitted by a timer in the thread of the wiper, then finished().
+ */
+
+DDiskWiper::DDiskWiper(QObject *parent)
+    : QObject(parent)
+    , d_ptr(new DDiskWiperPrivate(this))
+{
+    Q_D(DDiskWiper);
+
+    d->timer.setInterval(500);
+    connect(&d->timer, &QTimer::timeout, this, [d] {
+        d->poll();
+    });
+}
+
+DDiskWiper::~DDiskWiper()
+{
+
+}
+
+DDiskWiper::Pattern DDiskWiper::pattern() const
+{
+    Q_D(const DDiskWiper);
+
+    return d->pattern;
+}
+
+int DDiskWiper::passes() const
+{
+    Q_D(const DDiskWiper);
+
+    return d->passes;
+}
+
+int DDiskWiper::threads() const
+{
+    Q_D(const DDiskWiper);
+
+    return d->threads;
+}
+
+int DDiskWiper::blockSize() const
+{
+    Q_D(const DDiskWiper);
+
+    return d->blockSize;
+}
+
+int DDiskWiper::verifySamples() const
+{
+    Q_D(const DDiskWiper);
+
+    return d->verifySamples;
+}
+
+bool DDiskWiper::deviceCommandsEnabled() const
+{
+    Q_D(const DDiskWiper);
+
+    return d->deviceCommandsEnabled;
+}
+
+bool DDiskWiper::isRunning() const
+{
+    Q_D(const DDiskWiper);
+
+    return d->running;
+}
+
+bool DDiskWiper::wipeBlockDevice(const QString &blockDevicePath, const QDBusConnection &connection)
+{
+    Q_D(DDiskWiper);
+
+    if (d->running) {
+        d->errorString = QStringLiteral("A wipe is running");
+        return false;
+    }
+
+    QScopedPointer<DBlockDevice> device(DDiskManager::createBlockDevice(blockDevicePath, connection));
+    // the verification and the check of a discard read the device
+    const bool read = d->verifySamples > 0 || (d->deviceCommandsEnabled && d->pattern == Zeros && d->passes == 1);
+    const QDBusUnixFileDescriptor &fd = device->openDevice(read ? "rw" : "w", {});
+
+    if (!fd.isValid()) {
+        d->errorString = device->lastError().message();
+        return false;
+    }
+
+    // the descriptor received is closed by QDBusUnixFileDescriptor, wipe() keeps a duplicate
+    return wipe(fd.fileDescriptor());
+}
+
+bool DDiskWiper::wipeFile(const QString &fileName)
+{
+    Q_D(DDiskWiper);
+
+    const int fd = ::open(fileName.toLocal8Bit().constData(), (d->verifySamples > 0 ? O_RDWR : O_WRONLY) | O_CLOEXEC);
+
+    if (fd < 0) {
+        d->errorString = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+
+    const bool ok = wipe(fd);
+
+    ::close(fd);
+
+    return ok;
+}
+
+bool DDiskWiper::wipe(int fd)
+{
+    Q_D(DDiskWiper);
+
+    if (d->running) {
+        d->errorString = QStringLiteral("A wipe is running");
+        return false;
+    }
+
+    d->reset();
+
+    struct stat st;
+
+    if (::fstat(fd, &st) < 0) {
+        d->failWithErrno(QStringLiteral("Stat"));
+        return false;
+    }
+
+    if (S_ISBLK(st.st_mode)) {
+        uint64_t size = 0;
+
+        if (::ioctl(fd, BLKGETSIZE64, &size) < 0) {
+            d->failWithErrno(QStringLiteral("Size"));
+            return false;
+        }
+
+        d->size = size;
+        d->isBlockDevice = true;
+    } else if (S_ISREG(st.st_mode)) {
+        d->size = static_cast<quint64>(st.st_size);
+        d->isBlockDevice = false;
+    } else {
+        d->errorString = QStringLiteral("Not a block device nor a regular file");
+        return false;
+    }
+
+    // the size of a block device is a multiple of its sectors, the blocks and the buffers are aligned
+    d->fd = d->isBlockDevice ? DBlockIO::openDirect(fd) : -1;
+
+    if (d->fd < 0)
+        d->fd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+
+    if (d->fd < 0) {
+        d->failWithErrno(QStringLiteral("Dup"));
+        return false;
+    }
+
+    std::random_device device;
+
+    d->seeds.clear();
+
+    for (int i = 0; i < qMax(1, d->passes); ++i) {
+        d->seeds.push_back((static_cast<quint64>(device()) << 32) | device());
+    }
+
+    d->running = true;
+    d->clock.start();
+    d->thread = std::thread(&DDiskWiperPrivate::run, d);
+    d->timer.start();
+
+    return true;
+}
+
+quint64 DDiskWiper::size() const
+{
+    Q_D(const DDiskWiper);
+
+    return d->size;
+}
+
+quint64 DDiskWiper::bytesWritten() const
+{
+    Q_D(const DDiskWiper);
+
+    return d->written;
+}
+
+double DDiskWiper::throughput() const
+{
+    Q_D(const DDiskWiper);
+
+    return d->throughput;
+}
+
+DDiskWiper::Method DDiskWiper::method() const
+{
+    Q_D(const DDiskWiper);
+
+    return static_cast<Method>(d->method.load());
+}
+
+/*!
+ * \brief The error of the last wipe, valid once it has finished.
+ */
+QString DDiskWiper::errorString() const
+{
+    Q_D(const DDiskWiper);
+
+    return d->running ? QString() : d->errorString;
+}
+
+void DDiskWiper::setPattern(Pattern pattern)
+{
+    Q_D(DDiskWiper);
+
+    if (!d->running)
+        d->pattern = pattern;
+}
+
+void DDiskWiper::setPasses(int passes)
+{
+    Q_D(DDiskWiper);
+
+    if (!d->running)
+        d->passes = qMax(1, passes);
+}
+
+void DDiskWiper::setThreads(int threads)
+{
+    Q_D(DDiskWiper);
+
+    if (!d->running)
+        d->threads = qMax(0, threads);
+}
+
+void DDiskWiper::setBlockSize(int blockSize)
+{
+    Q_D(DDiskWiper);
+
+    // a multiple of the alignment, at least 64 KiB
+    if (!d->running)
+        d->blockSize = qMax(64 * 1024, blockSize) / static_cast<int>(Alignment) * static_cast<int>(Alignment);
+}
+
+void DDiskWiper::setVerifySamples(int samples)
+{
+    Q_D(DDiskWiper);
+
+    if (!d->running)
+        d->verifySamples = qMax(0, samples);
+}
+
+void DDiskWiper::setDeviceCommandsEnabled(bool enabled)
+{
+    Q_D(DDiskWiper);
+
+    if (!d->running)
+        d->deviceCommandsEnabled = enabled;
+}
+
+/*!
+ * \brief Stops the wipe after the blocks being written, finished() is emitted with false.
+ *
+ * BLKDISCARD and BLKZEROOUT can't be interrupted, the wipe stops after them.
+ */
+void DDiskWiper::cancel()
+{
+    Q_D(DDiskWiper);
+
+    d->cancelled = true;
+}
@@ -0,0 +1,90 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DDISKWIPER_H
+#define DDISKWIPER_H
+
+#include <QObject>
+#include <QDBusConnection>
+
+class DDiskWiperPrivate;
+class DDiskWiper : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(DDiskWiper)
+
+    Q_PROPERTY(Pattern pattern READ pattern WRITE setPattern)
+    Q_PROPERTY(int passes READ passes WRITE setPasses)
+    Q_PROPERTY(int threads READ threads WRITE setThreads)
+    Q_PROPERTY(int blockSize READ blockSize WRITE setBlockSize)
+    Q_PROPERTY(int verifySamples READ verifySamples WRITE setVerifySamples)
+    Q_PROPERTY(bool deviceCommandsEnabled READ deviceCommandsEnabled WRITE setDeviceCommandsEnabled)
+    Q_PROPERTY(bool running READ isRunning)
+
+public:
+    enum Pattern {
+        Zeros,
+        Random // pseudo-random data, different for every pass
+    };
+
+    Q_ENUM(Pattern)
+
+    enum Method {
+        NoMethod,
+        Discard, // BLKDISCARD, kept only if the device reads zeros after it
+        ZeroOut, // BLKZEROOUT
+        Overwrite
+    };
+
+    Q_ENUM(Method)
+
+    explicit DDiskWiper(QObject *parent = nullptr);
+    // a running wipe is cancelled
+    ~DDiskWiper();
+
+    Pattern pattern() const;
+    int passes() const;
+    // 0 for one thread per CPU, up to 8
+    int threads() const;
+    // bytes written by one write(2)
+    int blockSize() const;
+    // regions read back after the last pass, 0 disables the verification
+    int verifySamples() const;
+    // BLKDISCARD and BLKZEROOUT are tried before writing for one pass of zeros on a block device
+    bool deviceCommandsEnabled() const;
+    bool isRunning() const;
+
+    // the writable block device is opened through Block.OpenDevice, no privilege is needed
+    bool wipeBlockDevice(const QString &blockDevicePath, const QDBusConnection &connection = QDBusConnection::systemBus());
+    // the current size of the file is overwritten
+    bool wipeFile(const QString &fileName);
+    // fd is duplicated, it must be open for writing, and for reading if verifySamples() isn't 0
+    bool wipe(int fd);
+
+    quint64 size() const;
+    quint64 bytesWritten() const;
+    double throughput() const; // bytes per second, over the last second or so
+    Method method() const;
+    QString errorString() const;
+
+public Q_SLOTS:
+    void setPattern(Pattern pattern);
+    void setPasses(int passes);
+    void setThreads(int threads);
+    void setBlockSize(int blockSize);
+    void setVerifySamples(int samples);
+    void setDeviceCommandsEnabled(bool enabled);
+
+    void cancel();
+
+Q_SIGNALS:
+    void progressChanged(double progress, double bytesPerSecond);
+    void passFinished(int pass);
+    void finished(bool success);
+
+private:
+    QScopedPointer<DDiskWiperPrivate> d_ptr;
+};
+
+#endif // DDISKWIPER_H
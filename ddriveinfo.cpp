@@ -0,0 +1,203 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "ddriveinfo.h"
+#include "udisks2_dbus_common.h"
+
+class DDriveInfoData : public QSharedData
+{
+public:
+    QVariant drive(const char *name) const
+    {
+        return interfaces.value(QStringLiteral(UDISKS2_SERVICE ".Drive")).value(QLatin1String(name));
+    }
+
+    QString path;
+    QMap<QString, QVariantMap> interfaces;
+};
+
+/*!
+ * \class DDriveInfo
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief A read-only, implicitly shared snapshot of the properties of a drive.
+ *
+ * \sa DBlockDeviceInfo, DDiskDevice, DDiskManager::driveInfoList()
+ */
+
+DDriveInfo::DDriveInfo()
+    : d(new DDriveInfoData)
+{
+
+}
+
+DDriveInfo::DDriveInfo(const QString &path, const QMap<QString, QVariantMap> &interfaces)
+    : d(new DDriveInfoData)
+{
+    d->path = path;
+    d->interfaces = interfaces;
+}
+
+DDriveInfo::DDriveInfo(const DDriveInfo &other)
+    : d(other.d)
+{
+
+}
+
+DDriveInfo &DDriveInfo::operator=(const DDriveInfo &other)
+{
+    d = other.d;
+
+    return *this;
+}
+
+DDriveInfo::~DDriveInfo()
+{
+
+}
+
+bool DDriveInfo::isValid() const
+{
+    return d->interfaces.contains(QStringLiteral(UDISKS2_SERVICE ".Drive"));
+}
+
+QString DDriveInfo::path() const
+{
+    return d->path;
+}
+
+bool DDriveInfo::canPowerOff() const
+{
+    return d->drive("CanPowerOff").toBool();
+}
+
+QString DDriveInfo::connectionBus() const
+{
+    return d->drive("ConnectionBus").toString();
+}
+
+bool DDriveInfo::ejectable() const
+{
+    return d->drive("Ejectable").toBool();
+}
+
+QString DDriveInfo::id() const
+{
+    return d->drive("Id").toString();
+}
+
+QString DDriveInfo::media() const
+{
+    return d->drive("Media").toString();
+}
+
+bool DDriveInfo::mediaAvailable() const
+{
+    return d->drive("MediaAvailable").toBool();
+}
+
+bool DDriveInfo::mediaChangeDetected() const
+{
+    return d->drive("MediaChangeDetected").toBool();
+}
+
+QStringList DDriveInfo::mediaCompatibility() const
+{
+    return d->drive("MediaCompatibility").toStringList();
+}
+
+bool DDriveInfo::mediaRemovable() const
+{
+    return d->drive("MediaRemovable").toBool();
+}
+
+QString DDriveInfo::model() const
+{
+    return d->drive("Model").toString();
+}
+
+bool DDriveInfo::optical() const
+{
+    return d->drive("Optical").toBool();
+}
+
+bool DDriveInfo::opticalBlank() const
+{
+    return d->drive("OpticalBlank").toBool();
+}
+
+bool DDriveInfo::removable() const
+{
+    return d->drive("Removable").toBool();
+}
+
+QString DDriveInfo::revision() const
+{
+    return d->drive("Revision").toString();
+}
+
+int DDriveInfo::rotationRate() const
+{
+    return d->drive("RotationRate").toInt();
+}
+
+QString DDriveInfo::seat() const
+{
+    return d->drive("Seat").toString();
+}
+
+QString DDriveInfo::serial() const
+{
+    return d->drive("Serial").toString();
+}
+
+QString DDriveInfo::siblingId() const
+{
+    return d->drive("SiblingId").toString();
+}
+
+qulonglong DDriveInfo::size() const
+{
+    return d->drive("Size").toULongLong();
+}
+
+QString DDriveInfo::sortKey() const
+{
+    return d->drive("SortKey").toString();
+}
+
+qulonglong DDriveInfo::timeDetected() const
+{
+    return d->drive("TimeDetected").toULongLong();
+}
+
+qulonglong DDriveInfo::timeMediaDetected() const
+{
+    return d->drive("TimeMediaDetected").toULongLong();
+}
+
+QString DDriveInfo::vendor() const
+{
+    return d->drive("Vendor").toString();
+}
+
+QString DDriveInfo::WWN() const
+{
+    return d->drive("WWN").toString();
+}
+
+bool DDriveInfo::hasAta() const
+{
+    return d->interfaces.contains(QStringLiteral(UDISKS2_SERVICE ".Drive.Ata"));
+}
+
+QStringList DDriveInfo::interfaces() const
+{
+    return d->interfaces.keys();
+}
+
+QVariant DDriveInfo::value(const QString &interface, const QString &name) const
+{
+    return d->interfaces.value(interface).value(name);
+}
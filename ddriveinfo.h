@@ -0,0 +1,68 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DDRIVEINFO_H
+#define DDRIVEINFO_H
+
+#include <QSharedDataPointer>
+#include <QVariantMap>
+
+class DDriveInfoData;
+class DDriveInfo
+{
+public:
+    DDriveInfo();
+    DDriveInfo(const DDriveInfo &other);
+    DDriveInfo &operator=(const DDriveInfo &other);
+    ~DDriveInfo();
+
+    void swap(DDriveInfo &other) noexcept { d.swap(other.d); }
+
+    bool isValid() const;
+    QString path() const;
+
+    bool canPowerOff() const;
+    QString connectionBus() const;
+    bool ejectable() const;
+    QString id() const;
+    QString media() const;
+    bool mediaAvailable() const;
+    bool mediaChangeDetected() const;
+    QStringList mediaCompatibility() const;
+    bool mediaRemovable() const;
+    QString model() const;
+    bool optical() const;
+    bool opticalBlank() const;
+    bool removable() const;
+    QString revision() const;
+    int rotationRate() const;
+    QString seat() const;
+    QString serial() const;
+    QString siblingId() const;
+    qulonglong size() const;
+    QString sortKey() const;
+    qulonglong timeDetected() const;
+    qulonglong timeMediaDetected() const;
+    QString vendor() const;
+    QString WWN() const;
+
+    // implements org.freedesktop.UDisks2.Drive.Ata
+    bool hasAta() const;
+
+    QStringList interfaces() const;
+    QVariant value(const QString &interface, const QString &name) const;
+
+private:
+    DDriveInfo(const QString &path, const QMap<QString, QVariantMap> &interfaces);
+
+    QSharedDataPointer<DDriveInfoData> d;
+
+    friend class DDiskManager;
+    friend class DDiskManagerPrivate;
+};
+
+Q_DECLARE_SHARED(DDriveInfo)
+Q_DECLARE_METATYPE(DDriveInfo)
+
+#endif // DDRIVEINFO_H
@@ -0,0 +1,288 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dfilesystemcheckscheduler.h"
+#include "ddiskmanager.h"
+#include "dudisksjob.h"
+#include "udisks2_dbus_common.h"
+#include "objectmanager_interface.h"
+
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QPointer>
+#include <QQueue>
+
+class DFileSystemCheckSchedulerPrivate
+{
+public:
+    struct Task
+    {
+        QString path;
+        DFileSystemCheckScheduler::Operation operation;
+        QVariantMap options;
+        qulonglong size;
+        QString drive;
+        QPointer<DUDisksJob> job;
+    };
+
+    DFileSystemCheckSchedulerPrivate(DFileSystemCheckScheduler *qq, const QDBusConnection &connection);
+
+    void resolveDrive(const Task &task, const QString &block, int generation);
+    void schedule();
+    void start(const Task &task);
+    void checkIdle();
+
+    QDBusConnection connection;
+    int maxConcurrentDrives = 0;
+    int resolving = 0;
+    // the tasks still being resolved when clear() is called are dropped
+    int clearGeneration = 0;
+    // enqueue() was called since the last allFinished()
+    bool busy = false;
+    // 每个磁盘一个队列，保证同一个磁盘上同时只有一个操作
+    QMap<QString, QQueue<Task>> pending;
+    QMap<QString, Task> running; // by drive
+    // 下一次调度从这个磁盘之后开始，使各个磁盘轮流执行
+    QString lastDrive;
+
+    DFileSystemCheckScheduler *q_ptr;
+
+    Q_DECLARE_PUBLIC(DFileSystemCheckScheduler)
+};
+
+DFileSystemCheckSchedulerPrivate::DFileSystemCheckSchedulerPrivate(DFileSystemCheckScheduler *qq, const QDBusConnection &connection)
+    : connection(connection)
+    , q_ptr(qq)
+{
+
+}
+
+// Partitions and unlocked LUKS devices are serialized with the other block devices
+// of their physical drive; devices without a drive (loop, md raid...) get their own queue.
+void DFileSystemCheckSchedulerPrivate::resolveDrive(const Task &task, const QString &block, int generation)
+{
+    Q_Q(DFileSystemCheckScheduler);
+
+    QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, block, "org.freedesktop.DBus.Properties", "GetAll");
+    message << QStringLiteral(UDISKS2_SERVICE ".Block");
+
+    ++resolving;
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(connection.asyncCall(message), q);
+
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, q, [this, task, block, generation] (QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+        --resolving;
+
+        if (generation != clearGeneration) {
+            checkIdle();
+            return;
+        }
+
+        QDBusPendingReply<QVariantMap> reply = *w;
+        const QVariantMap &properties = reply.value();
+        const QString &drive = UDisks2::demarshal(properties.value("Drive")).toString();
+        const QString &backing = UDisks2::demarshal(properties.value("CryptoBackingDevice")).toString();
+
+        if (drive.length() > 1 || backing.length() <= 1) {
+            Task t = task;
+
+            t.drive = drive.length() > 1 ? drive : block;
+            pending[t.drive].enqueue(t);
+            schedule();
+        } else {
+            resolveDrive(task, backing, generation);
+        }
+    });
+}
+
+void DFileSystemCheckSchedulerPrivate::schedule()
+{
+    if (pending.isEmpty()) {
+        checkIdle();
+        return;
+    }
+
+    // round robin over the drives, starting after the last one served
+    QStringList drives = pending.keys();
+    const int pivot = drives.indexOf(lastDrive) + 1;
+
+    drives = drives.mid(pivot) + drives.mid(0, pivot);
+
+    for (const QString &drive : drives) {
+        if (maxConcurrentDrives > 0 && running.count() >= maxConcurrentDrives)
+            break;
+
+        if (running.contains(drive))
+            continue;
+
+        QQueue<Task> &queue = pending[drive];
+        const Task task = queue.dequeue();
+
+        if (queue.isEmpty())
+            pending.remove(drive);
+
+        lastDrive = drive;
+        start(task);
+    }
+}
+
+void DFileSystemCheckSchedulerPrivate::start(const Task &task)
+{
+    Q_Q(DFileSystemCheckScheduler);
+
+    static const char *methods[] = {"Check", "Repair", "Resize"};
+
+    QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, task.path, UDISKS2_SERVICE ".Filesystem", methods[task.operation]);
+
+    if (task.operation == DFileSystemCheckScheduler::Resize)
+        message << task.size;
+
+    message << task.options;
+
+    running.insert(task.drive, task);
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(connection.asyncCall(message, INT_MAX), q);
+
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, q, [this, task] (QDBusPendingCallWatcher *w) {
+        Q_Q(DFileSystemCheckScheduler);
+
+        w->deleteLater();
+
+        const Task &t = running.take(task.drive);
+
+        if (t.job)
+            t.job->deleteLater();
+
+        bool result = !w->isError();
+
+        if (result && task.operation != DFileSystemCheckScheduler::Resize) {
+            QDBusPendingReply<bool> reply = *w;
+            result = reply.value();
+        }
+
+        Q_EMIT q->finished(task.path, task.operation, result, w->error());
+
+        schedule();
+    });
+
+    Q_EMIT q->started(task.path, task.operation);
+}
+
+void DFileSystemCheckSchedulerPrivate::checkIdle()
+{
+    Q_Q(DFileSystemCheckScheduler);
+
+    // only once the work enqueued is done, not for a scheduler that had nothing to do
+    if (busy && resolving == 0 && running.isEmpty() && pending.isEmpty()) {
+        busy = false;
+        Q_EMIT q->allFinished();
+    }
+}
+
+/*!
+ * \class DFileSystemCheckScheduler
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief Runs Filesystem.Check, Repair and Resize on many block devices.
+ *
+ * Operations on different physical drives run in parallel, while the block
+ * devices of the same drive are processed one after another so that a disk
+ * never seeks between two filesystems. The progress of the UDisks2 job of
+ * each operation is reported by progressChanged().
+ */
+
+DFileSystemCheckScheduler::DFileSystemCheckScheduler(QObject *parent)
+    : DFileSystemCheckScheduler(QDBusConnection::systemBus(), parent)
+{
+
+}
+
+DFileSystemCheckScheduler::DFileSystemCheckScheduler(const QDBusConnection &connection, QObject *parent)
+    : QObject(parent)
+    , d_ptr(new DFileSystemCheckSchedulerPrivate(this, connection))
+{
+    connect(UDisks2::objectManager(connection), &OrgFreedesktopDBusObjectManagerInterface::InterfacesAdded,
+            this, &DFileSystemCheckScheduler::onInterfacesAdded);
+}
+
+DFileSystemCheckScheduler::~DFileSystemCheckScheduler()
+{
+
+}
+
+int DFileSystemCheckScheduler::maxConcurrentDrives() const
+{
+    Q_D(const DFileSystemCheckScheduler);
+
+    return d->maxConcurrentDrives;
+}
+
+bool DFileSystemCheckScheduler::isIdle() const
+{
+    Q_D(const DFileSystemCheckScheduler);
+
+    return d->resolving == 0 && d->running.isEmpty() && d->pending.isEmpty();
+}
+
+void DFileSystemCheckScheduler::setMaxConcurrentDrives(int count)
+{
+    Q_D(DFileSystemCheckScheduler);
+
+    d->maxConcurrentDrives = qMax(0, count);
+    d->schedule();
+}
+
+void DFileSystemCheckScheduler::enqueue(const QString &blockPath, Operation operation, const QVariantMap &options, qulonglong size)
+{
+    Q_D(DFileSystemCheckScheduler);
+
+    DFileSystemCheckSchedulerPrivate::Task task {blockPath, operation, options, size, QString(), nullptr};
+
+    d->busy = true;
+    d->resolveDrive(task, blockPath, d->clearGeneration);
+}
+
+/*!
+ * \brief Drop the operations not started yet, the running ones are not interrupted.
+ *
+ * This includes the operations whose drive is still being looked up.
+ */
+void DFileSystemCheckScheduler::clear()
+{
+    Q_D(DFileSystemCheckScheduler);
+
+    ++d->clearGeneration;
+    d->pending.clear();
+    d->checkIdle();
+}
+
+void DFileSystemCheckScheduler::onInterfacesAdded(const QDBusObjectPath &object_path, const QMap<QString, QVariantMap> &interfaces_and_properties)
+{
+    Q_D(DFileSystemCheckScheduler);
+
+    if (d->running.isEmpty())
+        return;
+
+    const QVariantMap &job = interfaces_and_properties.value(QStringLiteral(UDISKS2_SERVICE ".Job"));
+
+    if (!job.value("Operation").toString().startsWith("filesystem-"))
+        return;
+
+    const QStringList &objects = UDisks2::demarshal(job.value("Objects")).toStringList();
+
+    for (auto i = d->running.begin(); i != d->running.end(); ++i) {
+        if (i->job || !objects.contains(i->path))
+            continue;
+
+        const QString path = i->path;
+
+        i->job = DDiskManager::createJob(object_path.path(), d->connection, this);
+        connect(i->job.data(), &DUDisksJob::progressChanged, this, [this, path] (double progress) {
+            Q_EMIT progressChanged(path, progress);
+        });
+
+        break;
+    }
+}
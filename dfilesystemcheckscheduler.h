@@ -0,0 +1,59 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DFILESYSTEMCHECKSCHEDULER_H
+#define DFILESYSTEMCHECKSCHEDULER_H
+
+#include <QObject>
+#include <QVariantMap>
+#include <QDBusConnection>
+#include <QDBusError>
+
+class DFileSystemCheckSchedulerPrivate;
+class DFileSystemCheckScheduler : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(DFileSystemCheckScheduler)
+
+    Q_PROPERTY(int maxConcurrentDrives READ maxConcurrentDrives WRITE setMaxConcurrentDrives)
+    Q_PROPERTY(bool idle READ isIdle)
+
+public:
+    enum Operation {
+        Check,
+        Repair,
+        Resize
+    };
+
+    Q_ENUM(Operation)
+
+    explicit DFileSystemCheckScheduler(QObject *parent = nullptr);
+    explicit DFileSystemCheckScheduler(const QDBusConnection &connection, QObject *parent = nullptr);
+    ~DFileSystemCheckScheduler();
+
+    // 0 表示不限制，同一个磁盘上的分区总是依次执行
+    int maxConcurrentDrives() const;
+    bool isIdle() const;
+
+public Q_SLOTS:
+    void setMaxConcurrentDrives(int count);
+
+    void enqueue(const QString &blockPath, Operation operation, const QVariantMap &options, qulonglong size = 0);
+    void clear();
+
+Q_SIGNALS:
+    void started(const QString &blockPath, Operation operation);
+    void progressChanged(const QString &blockPath, double progress);
+    // result is "consistent" for Check, "repaired" for Repair and always true for a successful Resize
+    void finished(const QString &blockPath, Operation operation, bool result, const QDBusError &error);
+    void allFinished();
+
+private:
+    QScopedPointer<DFileSystemCheckSchedulerPrivate> d_ptr;
+
+private Q_SLOTS:
+    void onInterfacesAdded(const QDBusObjectPath &object_path, const QMap<QString, QVariantMap> &interfaces_and_properties);
+};
+
+#endif // DFILESYSTEMCHECKSCHEDULER_H
@@ -0,0 +1,359 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dfilesystemusagemonitor.h"
+#include "ddiskmanager.h"
+#include "dblockdeviceinfo.h"
+#include "dblockdevicefilter.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+
+#include <limits>
+
+#include <sys/statvfs.h>
+
+class DFileSystemUsageMonitorPrivate
+{
+public:
+    struct Entry
+    {
+        QByteArray mountPoint;
+        DFileSystemUsage usage;
+        int interval = 0;
+        qint64 due = 0;
+    };
+
+    struct Sample
+    {
+        QString path;
+        QByteArray mountPoint;
+        DFileSystemUsage usage;
+    };
+
+    // how the worker reaches the monitor, cleared by its destructor: a worker stuck
+    // in statvfs() may outlive the monitor
+    struct Channel
+    {
+        QMutex lock;
+        DFileSystemUsageMonitor *monitor = nullptr;
+    };
+
+    explicit DFileSystemUsageMonitorPrivate(DFileSystemUsageMonitor *qq)
+        : q_ptr(qq)
+    {
+
+    }
+
+    void watch(const QString &path, const QByteArray &mountPoint);
+    void schedule();
+    void sample(bool all);
+    void apply(const QVector<Sample> &samples);
+
+    DDiskManager *manager = nullptr;
+    QHash<QString, Entry> entries;
+    QTimer timer;
+    // statvfs() may block on a dying device, it never runs in the thread of the monitor
+    QThread *thread = nullptr;
+    QObject *worker = nullptr;
+    QSharedPointer<Channel> channel;
+    bool sampling = false;
+    bool refreshPending = false;
+    int minimumInterval = 1000;
+    int maximumInterval = 30000;
+    QList<int> thresholds {90, 95};
+
+    DFileSystemUsageMonitor *q_ptr;
+
+    Q_DECLARE_PUBLIC(DFileSystemUsageMonitor)
+};
+
+void DFileSystemUsageMonitorPrivate::watch(const QString &path, const QByteArray &mountPoint)
+{
+    Entry &entry = entries[path];
+
+    if (entry.mountPoint != mountPoint) {
+        entry.mountPoint = mountPoint;
+        entry.usage = DFileSystemUsage();
+    }
+
+    entry.interval = minimumInterval;
+    entry.due = 0;
+}
+
+void DFileSystemUsageMonitorPrivate::schedule()
+{
+    if (sampling || entries.isEmpty()) {
+        timer.stop();
+        return;
+    }
+
+    qint64 due = std::numeric_limits<qint64>::max();
+
+    for (const Entry &entry : entries) {
+        due = qMin(due, entry.due);
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    timer.start(static_cast<int>(qBound<qint64>(0, due - now, maximumInterval)));
+}
+
+// One batch for all the filesystems due now, the others wait for their own interval
+void DFileSystemUsageMonitorPrivate::sample(bool all)
+{
+    if (sampling) {
+        refreshPending = refreshPending || all;
+        return;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QVector<Sample> batch;
+
+    for (auto i = entries.constBegin(); i != entries.constEnd(); ++i) {
+        if (all || i->due <= now)
+            batch.append({i.key(), i->mountPoint, DFileSystemUsage()});
+    }
+
+    if (batch.isEmpty()) {
+        schedule();
+        return;
+    }
+
+    sampling = true;
+    timer.stop();
+
+    const QSharedPointer<Channel> channel = this->channel;
+
+    QMetaObject::invokeMethod(worker, [this, channel, batch] () mutable {
+        for (Sample &sample : batch) {
+            struct statvfs info;
+
+            if (::statvfs(sample.mountPoint.constData(), &info) != 0)
+                continue;
+
+            sample.usage.total = static_cast<qulonglong>(info.f_blocks) * info.f_frsize;
+            sample.usage.free = static_cast<qulonglong>(info.f_bfree) * info.f_frsize;
+            sample.usage.available = static_cast<qulonglong>(info.f_bavail) * info.f_frsize;
+            sample.usage.timestamp = QDateTime::currentMSecsSinceEpoch();
+        }
+
+        QMutexLocker locker(&channel->lock);
+
+        // the monitor is gone, and with it this
+        if (!channel->monitor)
+            return;
+
+        // dropped by Qt if the monitor is destroyed before it is delivered
+        QMetaObject::invokeMethod(channel->monitor, [this, batch] {
+            apply(batch);
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+void DFileSystemUsageMonitorPrivate::apply(const QVector<Sample> &samples)
+{
+    Q_Q(DFileSystemUsageMonitor);
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    sampling = false;
+
+    for (const Sample &sample : samples) {
+        auto entry = entries.find(sample.path);
+
+        // unmounted or remounted elsewhere while sampling
+        if (entry == entries.end() || entry->mountPoint != sample.mountPoint)
+            continue;
+
+        const DFileSystemUsage old = entry->usage;
+        const bool changed = sample.usage.isValid()
+                && (!old.isValid() || old.free != sample.usage.free || old.total != sample.usage.total);
+
+        // 变化中的文件系统采样更频繁，稳定的逐渐降低频率
+        entry->interval = changed ? qMax(minimumInterval, entry->interval / 2) : qMin(maximumInterval, entry->interval * 2);
+        entry->due = now + entry->interval;
+
+        if (!changed)
+            continue;
+
+        entry->usage = sample.usage;
+
+        Q_EMIT q->usageChanged(sample.path, sample.usage);
+
+        const int percent = sample.usage.usedPercent();
+
+        for (int threshold : thresholds) {
+            const bool was_above = old.isValid() && old.usedPercent() >= threshold;
+            const bool above = percent >= threshold;
+
+            if (was_above != above && (old.isValid() || above))
+                Q_EMIT q->thresholdCrossed(sample.path, threshold, above);
+        }
+    }
+
+    if (refreshPending) {
+        refreshPending = false;
+        sample(true);
+        return;
+    }
+
+    schedule();
+}
+
+/*!
+ * \class DFileSystemUsageMonitor
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief Keeps the size and free space of every mounted filesystem known to UDisks2.
+ *
+ * All the filesystems due are sampled by one batch of statvfs() calls in a
+ * worker thread. A filesystem whose usage changes is sampled more often,
+ * down to minimumInterval(), and a stable one less often, up to
+ * maximumInterval(). usage() returns the last sample of a block device
+ * without any system call, so redrawing a capacity bar costs nothing.
+ */
+
+DFileSystemUsageMonitor::DFileSystemUsageMonitor(QObject *parent)
+    : DFileSystemUsageMonitor(new DDiskManager(), parent)
+{
+    d_ptr->manager->setParent(this);
+}
+
+DFileSystemUsageMonitor::DFileSystemUsageMonitor(DDiskManager *manager, QObject *parent)
+    : QObject(parent)
+    , d_ptr(new DFileSystemUsageMonitorPrivate(this))
+{
+    Q_D(DFileSystemUsageMonitor);
+
+    d->manager = manager;
+    d->channel.reset(new DFileSystemUsageMonitorPrivate::Channel);
+    d->channel->monitor = this;
+    d->thread = new QThread;
+    d->worker = new QObject;
+    d->worker->moveToThread(d->thread);
+    connect(d->thread, &QThread::finished, d->worker, &QObject::deleteLater);
+    connect(d->thread, &QThread::finished, d->thread, &QObject::deleteLater);
+    d->thread->start();
+
+    d->timer.setSingleShot(true);
+    connect(&d->timer, &QTimer::timeout, this, [d] {
+        d->sample(false);
+    });
+
+    manager->setWatchChanges(true);
+    connect(manager, &DDiskManager::mountPointsChanged, this, &DFileSystemUsageMonitor::onMountPointsChanged);
+
+    for (const QString &path : manager->query(DBlockDeviceFilter::mounted())) {
+        const QByteArrayList &mount_points = manager->blockDeviceInfo(path).mountPoints();
+
+        if (!mount_points.isEmpty())
+            d->watch(path, mount_points.first());
+    }
+
+    d->sample(true);
+}
+
+DFileSystemUsageMonitor::~DFileSystemUsageMonitor()
+{
+    Q_D(DFileSystemUsageMonitor);
+
+    {
+        QMutexLocker locker(&d->channel->lock);
+        d->channel->monitor = nullptr;
+    }
+
+    // the thread deletes itself once it is finished, a statvfs() that never returns
+    // must not block the thread of the monitor
+    d->thread->quit();
+    d->thread->wait(1000);
+}
+
+DFileSystemUsage DFileSystemUsageMonitor::usage(const QString &blockDevicePath) const
+{
+    Q_D(const DFileSystemUsageMonitor);
+
+    return d->entries.value(blockDevicePath).usage;
+}
+
+QStringList DFileSystemUsageMonitor::blockDevices() const
+{
+    Q_D(const DFileSystemUsageMonitor);
+
+    return d->entries.keys();
+}
+
+int DFileSystemUsageMonitor::minimumInterval() const
+{
+    Q_D(const DFileSystemUsageMonitor);
+
+    return d->minimumInterval;
+}
+
+int DFileSystemUsageMonitor::maximumInterval() const
+{
+    Q_D(const DFileSystemUsageMonitor);
+
+    return d->maximumInterval;
+}
+
+QList<int> DFileSystemUsageMonitor::thresholds() const
+{
+    Q_D(const DFileSystemUsageMonitor);
+
+    return d->thresholds;
+}
+
+void DFileSystemUsageMonitor::setMinimumInterval(int msec)
+{
+    Q_D(DFileSystemUsageMonitor);
+
+    d->minimumInterval = qMax(100, msec);
+    d->maximumInterval = qMax(d->maximumInterval, d->minimumInterval);
+}
+
+void DFileSystemUsageMonitor::setMaximumInterval(int msec)
+{
+    Q_D(DFileSystemUsageMonitor);
+
+    d->maximumInterval = qMax(d->minimumInterval, msec);
+
+    for (DFileSystemUsageMonitorPrivate::Entry &entry : d->entries) {
+        entry.interval = qMin(entry.interval, d->maximumInterval);
+    }
+}
+
+void DFileSystemUsageMonitor::setThresholds(const QList<int> &percents)
+{
+    Q_D(DFileSystemUsageMonitor);
+
+    d->thresholds = percents;
+}
+
+void DFileSystemUsageMonitor::refresh()
+{
+    Q_D(DFileSystemUsageMonitor);
+
+    d->sample(true);
+}
+
+void DFileSystemUsageMonitor::onMountPointsChanged(const QString &blockDevicePath, const QByteArrayList &oldMountPoints, const QByteArrayList &newMountPoints)
+{
+    Q_UNUSED(oldMountPoints)
+
+    Q_D(DFileSystemUsageMonitor);
+
+    if (newMountPoints.isEmpty()) {
+        d->entries.remove(blockDevicePath);
+    } else {
+        d->watch(blockDevicePath, newMountPoints.first());
+    }
+
+    d->sample(false);
+}
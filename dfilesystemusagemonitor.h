@@ -0,0 +1,68 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DFILESYSTEMUSAGEMONITOR_H
+#define DFILESYSTEMUSAGEMONITOR_H
+
+#include <QObject>
+#include <QMetaType>
+
+struct DFileSystemUsage
+{
+    qulonglong total = 0; // bytes
+    qulonglong free = 0;
+    qulonglong available = 0; // free for an unprivileged user
+    qint64 timestamp = 0; // msecs since epoch of the sample, 0 if never sampled
+
+    bool isValid() const { return timestamp > 0; }
+    int usedPercent() const { return total > 0 ? static_cast<int>((total - free) * 100 / total) : 0; }
+};
+
+Q_DECLARE_METATYPE(DFileSystemUsage)
+
+class DDiskManager;
+class DFileSystemUsageMonitorPrivate;
+class DFileSystemUsageMonitor : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(DFileSystemUsageMonitor)
+
+    Q_PROPERTY(int minimumInterval READ minimumInterval WRITE setMinimumInterval)
+    Q_PROPERTY(int maximumInterval READ maximumInterval WRITE setMaximumInterval)
+    Q_PROPERTY(QList<int> thresholds READ thresholds WRITE setThresholds)
+
+public:
+    explicit DFileSystemUsageMonitor(QObject *parent = nullptr);
+    // manager must outlive the monitor, its changes are watched from now on
+    explicit DFileSystemUsageMonitor(DDiskManager *manager, QObject *parent = nullptr);
+    ~DFileSystemUsageMonitor();
+
+    // the last sample, doesn't touch the filesystem
+    DFileSystemUsage usage(const QString &blockDevicePath) const;
+    QStringList blockDevices() const;
+
+    int minimumInterval() const;
+    int maximumInterval() const;
+    QList<int> thresholds() const;
+
+public Q_SLOTS:
+    void setMinimumInterval(int msec);
+    void setMaximumInterval(int msec);
+    // used percents, the default is 90 and 95
+    void setThresholds(const QList<int> &percents);
+    // sample all the filesystems now
+    void refresh();
+
+Q_SIGNALS:
+    void usageChanged(const QString &blockDevicePath, const DFileSystemUsage &usage);
+    void thresholdCrossed(const QString &blockDevicePath, int threshold, bool above);
+
+private:
+    QScopedPointer<DFileSystemUsageMonitorPrivate> d_ptr;
+
+private Q_SLOTS:
+    void onMountPointsChanged(const QString &blockDevicePath, const QByteArrayList &oldMountPoints, const QByteArrayList &newMountPoints);
+};
+
+#endif // DFILESYSTEMUSAGEMONITOR_H
@@ -0,0 +1,535 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dimageverifier.h"
+#include "ddiskmanager.h"
+#include "dblockdevice.h"
+#include "private/dblockio_p.h"
+#include "private/dmemcompare_p.h"
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+
+namespace {
+// the granularity of the mismatched ranges
+const quint64 RangeUnit = 4096;
+}
+
+class DImageVerifierPrivate
+{
+public:
+    explicit DImageVerifierPrivate(DImageVerifier *qq)
+        : q_ptr(qq)
+    {
+
+    }
+
+    ~DImageVerifierPrivate();
+
+    // in the threads of the verification
+    void run();
+    void work();
+    void compare(const uchar *device, const uchar *image, size_t length, quint64 offset,
+                 std::vector<DImageVerifier::Range> *ranges, quint64 *first);
+
+    void poll();
+    void reset();
+    void closeFiles();
+
+    int threads = 4;
+    int chunkSize = 4 * 1024 * 1024;
+
+    int deviceFd = -1;
+    int imageFd = -1;
+    quint64 size = 0;
+    std::thread thread;
+    std::atomic<bool> running {false};
+    std::atomic<bool> done {false};
+    std::atomic<bool> cancelled {false};
+    std::atomic<quint64> next {0};
+    std::atomic<quint64> verified {0};
+    std::atomic<int> error {0};
+    QString errorPrefix; // what failed with error
+
+    // filled by the workers under lock, read after the thread was joined
+    std::mutex lock;
+    std::vector<DImageVerifier::Range> ranges;
+    quint64 first = std::numeric_limits<quint64>::max();
+    QList<DImageVerifier::Range> mergedRanges;
+    quint64 mismatchedBytes = 0;
+    QString errorString;
+
+    QTimer timer;
+    QElapsedTimer clock;
+    quint64 lastVerified = 0;
+    qint64 lastTime = 0;
+    double throughput = 0;
+
+    DImageVerifier *q_ptr;
+
+    Q_DECLARE_PUBLIC(DImageVerifier)
+};
+
+DImageVerifierPrivate::~DImageVerifierPrivate()
+{
+    cancelled = true;
+
+    if (thread.joinable())
+        thread.join();
+
+    closeFiles();
+}
+
+void DImageVerifierPrivate::run()
+{
+    std::vector<std::thread> workers;
+
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(&DImageVerifierPrivate::work, this);
+    }
+
+    work();
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    if (error != 0) {
+        errorString = QStringLiteral("%1: %2").arg(errorPrefix, QString::fromLocal8Bit(strerror(error)));
+    } else if (cancelled) {
+        errorString = QStringLiteral("Cancelled");
+    }
+
+    // the chunks were compared in any order, the ranges of neighbour chunks are joined
+    std::sort(ranges.begin(), ranges.end());
+
+    for (const DImageVerifier::Range &range : ranges) {
+        mismatchedBytes += range.second;
+
+        if (!mergedRanges.isEmpty() && mergedRanges.last().first + mergedRanges.last().second == range.first) {
+            mergedRanges.last().second += range.second;
+        } else {
+            mergedRanges.append(range);
+        }
+    }
+
+    done = true;
+}
+
+// Each worker reads the same chunk of the device and of the image then compares them:
+// with a few chunks in flight the device is kept busy while the CPU compares
+void DImageVerifierPrivate::work()
+{
+    DBlockIO::AlignedBuffer device(static_cast<size_t>(chunkSize));
+    DBlockIO::AlignedBuffer image(static_cast<size_t>(chunkSize));
+    std::vector<DImageVerifier::Range> found;
+    quint64 firstFound = std::numeric_limits<quint64>::max();
+
+    if (!device.get() || !image.get()) {
+        int expected = 0;
+
+        if (error.compare_exchange_strong(expected, ENOMEM))
+            errorPrefix = QStringLiteral("Allocate");
+
+        return;
+    }
+
+    const quint64 chunk = static_cast<quint64>(chunkSize);
+    const quint64 chunks = (size + chunk - 1) / chunk;
+
+    while (!cancelled && error == 0) {
+        const quint64 index = next++;
+
+        if (index >= chunks)
+            break;
+
+        const quint64 offset = index * chunk;
+        const size_t length = static_cast<size_t>(qMin(chunk, size - offset));
+        // O_DIRECT reads whole sectors, the last chunk of the image may end inside one
+        const size_t deviceLength = static_cast<size_t>(qMin<quint64>((length + DBlockIO::Alignment - 1) / DBlockIO::Alignment * DBlockIO::Alignment, chunk));
+        // the device may end before the rounding, then the read is short but holds the
+        // chunk; an unaligned length is never read again, O_DIRECT would refuse it
+        const ssize_t n = DBlockIO::readUpTo(deviceFd, device.get(), deviceLength, offset);
+        bool ok = n >= 0 && static_cast<size_t>(n) >= length;
+        const char *what = "Read device";
+
+        if (n >= 0 && !ok)
+            errno = EIO;
+
+        if (ok) {
+            ok = DBlockIO::readAll(imageFd, image.get(), length, offset);
+            what = "Read image";
+        }
+
+        if (!ok) {
+            int expected = 0;
+
+            if (error.compare_exchange_strong(expected, errno))
+                errorPrefix = QString::fromLatin1(what);
+
+            break;
+        }
+
+        compare(device.get(), image.get(), length, offset, &found, &firstFound);
+        verified += length;
+    }
+
+    std::lock_guard<std::mutex> locker(lock);
+
+    ranges.insert(ranges.end(), found.begin(), found.end());
+    first = qMin(first, firstFound);
+}
+
+// The whole chunk is compared at once, it is equal almost always; else by units
+// of RangeUnit bytes from the one of the first byte different
+void DImageVerifierPrivate::compare(const uchar *device, const uchar *image, size_t length, quint64 offset,
+                                    std::vector<DImageVerifier::Range> *ranges, quint64 *first)
+{
+    const size_t mismatch = DMemCompare::firstMismatch(device, image, length);
+
+    if (mismatch == length)
+        return;
+
+    *first = qMin(*first, offset + mismatch);
+
+    quint64 start = 0;
+    bool inRange = false;
+
+    // the chunks start on a unit
+    for (size_t i = mismatch / RangeUnit * RangeUnit; i < length; i += RangeUnit) {
+        const size_t unit = qMin<size_t>(RangeUnit, length - i);
+        const bool equal = i > mismatch && DMemCompare::firstMismatch(device + i, image + i, unit) == unit;
+
+        if (!equal && !inRange) {
+            start = offset + i;
+            inRange = true;
+        } else if (equal && inRange) {
+            ranges->push_back(DImageVerifier::Range(start, offset + i - start));
+            inRange = false;
+        }
+    }
+
+    if (inRange)
+        ranges->push_back(DImageVerifier::Range(start, offset + length - start));
+}
+
+void DImageVerifierPrivate::poll()
+{
+    Q_Q(DImageVerifier);
+
+    const bool over = done;
+    const qint64 now = clock.elapsed();
+    const quint64 bytes = verified;
+
+    if (now > lastTime) {
+        const double instant = (bytes - lastVerified) * 1000.0 / (now - lastTime);
+
+        throughput = lastTime == 0 ? instant : throughput * 0.5 + instant * 0.5;
+        lastVerified = bytes;
+        lastTime = now;
+    }
+
+    Q_EMIT q->progressChanged(size > 0 ? static_cast<double>(bytes) / size : 1.0, throughput);
+
+    if (!over)
+        return;
+
+    timer.stop();
+    thread.join();
+    closeFiles();
+    running = false;
+
+    Q_EMIT q->finished(errorString.isEmpty() && mergedRanges.isEmpty());
+}
+
+void DImageVerifierPrivate::reset()
+{
+    done = false;
+    cancelled = false;
+    next = 0;
+    verified = 0;
+    error = 0;
+    errorPrefix.clear();
+    ranges.clear();
+    first = std::numeric_limits<quint64>::max();
+    mergedRanges.clear();
+    mismatchedBytes = 0;
+    errorString.clear();
+    lastVerified = 0;
+    lastTime = 0;
+    throughput = 0;
+}
+
+void DImageVerifierPrivate::closeFiles()
+{
+    if (deviceFd >= 0)
+        ::close(deviceFd);
+
+    if (imageFd >= 0)
+        ::close(imageFd);
+
+    deviceFd = -1;
+    imageFd = -1;
+}
+
+/*!
+ * \class DImageVerifier
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief Compares a device with the image written to it.
+ *
+ * threads() workers read the same chunk of the device and of the image at a
+ * time and compare them with vectorized kernels (AVX2 or SSE2 chosen at run
+ * time, NEON on aarch64). A block device is read with O_DIRECT, on a
+ * descriptor of its own, so what is compared comes from the media and not
+ * from the page cache filled when the image was written.
+ *
+ * The result is the first byte different and the ranges that differ, aligned
+ * on 4 KiB units. Progress and throughput are reported by a timer in the thread of the
+ * verifier.
+ */
+
+DImageVerifier::DImageVerifier(QObject *parent)
+    : QObject(parent)
+    , d_ptr(new DImageVerifierPrivate(this))
+{
+    Q_D(DImageVerifier);
+
+    d->timer.setInterval(500);
+    connect(&d->timer, &QTimer::timeout, this, [d] {
+        d->poll();
+    });
+}
+
+DImageVerifier::~DImageVerifier()
+{
+
+}
+
+int DImageVerifier::threads() const
+{
+    Q_D(const DImageVerifier);
+
+    return d->threads;
+}
+
+int DImageVerifier::chunkSize() const
+{
+    Q_D(const DImageVerifier);
+
+    return d->chunkSize;
+}
+
+bool DImageVerifier::isRunning() const
+{
+    Q_D(const DImageVerifier);
+
+    return d->running;
+}
+
+bool DImageVerifier::verifyBlockDevice(const QString &blockDevicePath, const QString &imageFileName, const QDBusConnection &connection)
+{
+    Q_D(DImageVerifier);
+
+    QScopedPointer<DBlockDevice> device(DDiskManager::createBlockDevice(blockDevicePath, connection));
+    const QDBusUnixFileDescriptor &fd = device->openDevice("r", {});
+
+    if (!fd.isValid()) {
+        d->errorString = device->lastError().message();
+        return false;
+    }
+
+    const int image = ::open(imageFileName.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+
+    if (image < 0) {
+        d->errorString = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+
+    const bool ok = verify(fd.fileDescriptor(), image);
+
+    ::close(image);
+
+    return ok;
+}
+
+bool DImageVerifier::verifyFile(const QString &fileName, const QString &imageFileName)
+{
+    Q_D(DImageVerifier);
+
+    const int device = ::open(fileName.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+
+    if (device < 0) {
+        d->errorString = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+
+    const int image = ::open(imageFileName.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+
+    if (image < 0) {
+        d->errorString = QString::fromLocal8Bit(strerror(errno));
+        ::close(device);
+        return false;
+    }
+
+    const bool ok = verify(device, image);
+
+    ::close(device);
+    ::close(image);
+
+    return ok;
+}
+
+bool DImageVerifier::verify(int deviceFd, int imageFd)
+{
+    Q_D(DImageVerifier);
+
+    if (d->running) {
+        d->errorString = QStringLiteral("A verification is running");
+        return false;
+    }
+
+    d->reset();
+
+    struct stat device;
+    struct stat image;
+
+    if (::fstat(deviceFd, &device) < 0 || ::fstat(imageFd, &image) < 0) {
+        d->errorString = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+
+    quint64 deviceSize = static_cast<quint64>(device.st_size);
+
+    if (S_ISBLK(device.st_mode)) {
+        uint64_t size = 0;
+
+        if (::ioctl(deviceFd, BLKGETSIZE64, &size) < 0) {
+            d->errorString = QString::fromLocal8Bit(strerror(errno));
+            return false;
+        }
+
+        deviceSize = size;
+    }
+
+    d->size = static_cast<quint64>(image.st_size);
+
+    if (deviceSize < d->size) {
+        d->errorString = QStringLiteral("The device is smaller than the image");
+        return false;
+    }
+
+    d->deviceFd = S_ISBLK(device.st_mode) ? DBlockIO::openDirect(deviceFd) : -1;
+
+    if (d->deviceFd < 0)
+        d->deviceFd = ::fcntl(deviceFd, F_DUPFD_CLOEXEC, 0);
+
+    d->imageFd = ::fcntl(imageFd, F_DUPFD_CLOEXEC, 0);
+
+    if (d->deviceFd < 0 || d->imageFd < 0) {
+        d->errorString = QString::fromLocal8Bit(strerror(errno));
+        d->closeFiles();
+        return false;
+    }
+
+    ::posix_fadvise(d->imageFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    d->running = true;
+    d->clock.start();
+    d->thread = std::thread(&DImageVerifierPrivate::run, d);
+    d->timer.start();
+
+    return true;
+}
+
+quint64 DImageVerifier::size() const
+{
+    Q_D(const DImageVerifier);
+
+    return d->size;
+}
+
+quint64 DImageVerifier::bytesVerified() const
+{
+    Q_D(const DImageVerifier);
+
+    return d->verified;
+}
+
+double DImageVerifier::throughput() const
+{
+    Q_D(const DImageVerifier);
+
+    return d->throughput;
+}
+
+qint64 DImageVerifier::firstMismatch() const
+{
+    Q_D(const DImageVerifier);
+
+    if (d->running || d->mergedRanges.isEmpty())
+        return -1;
+
+    return static_cast<qint64>(d->first);
+}
+
+QList<DImageVerifier::Range> DImageVerifier::mismatchedRanges() const
+{
+    Q_D(const DImageVerifier);
+
+    return d->running ? QList<Range>() : d->mergedRanges;
+}
+
+quint64 DImageVerifier::mismatchedBytes() const
+{
+    Q_D(const DImageVerifier);
+
+    return d->running ? 0 : d->mismatchedBytes;
+}
+
+QString DImageVerifier::errorString() const
+{
+    Q_D(const DImageVerifier);
+
+    return d->running ? QString() : d->errorString;
+}
+
+void DImageVerifier::setThreads(int threads)
+{
+    Q_D(DImageVerifier);
+
+    if (!d->running)
+        d->threads = qBound(1, threads, 64);
+}
+
+void DImageVerifier::setChunkSize(int chunkSize)
+{
+    Q_D(DImageVerifier);
+
+    // a multiple of the alignment, at least 64 KiB
+    if (!d->running)
+        d->chunkSize = qMax(64 * 1024, chunkSize) / static_cast<int>(DBlockIO::Alignment) * static_cast<int>(DBlockIO::Alignment);
+}
+
+void DImageVerifier::cancel()
+{
+    Q_D(DImageVerifier);
+
+    d->cancelled = true;
+}
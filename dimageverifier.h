@@ -0,0 +1,68 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DIMAGEVERIFIER_H
+#define DIMAGEVERIFIER_H
+
+#include <QObject>
+#include <QDBusConnection>
+#include <QList>
+#include <QPair>
+
+class DImageVerifierPrivate;
+class DImageVerifier : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(DImageVerifier)
+
+    Q_PROPERTY(int threads READ threads WRITE setThreads)
+    Q_PROPERTY(int chunkSize READ chunkSize WRITE setChunkSize)
+    Q_PROPERTY(bool running READ isRunning)
+
+public:
+    typedef QPair<quint64, quint64> Range; // offset, length
+
+    explicit DImageVerifier(QObject *parent = nullptr);
+    // a running verification is cancelled
+    ~DImageVerifier();
+
+    // reads in flight at once, a device reaches its throughput with a few of them
+    int threads() const;
+    // bytes read from the device and the image by one pread(2) each
+    int chunkSize() const;
+    bool isRunning() const;
+
+    // the block device is opened by Block.OpenDevice("r") and read without the page cache
+    bool verifyBlockDevice(const QString &blockDevicePath, const QString &imageFileName,
+                           const QDBusConnection &connection = QDBusConnection::systemBus());
+    bool verifyFile(const QString &fileName, const QString &imageFileName);
+    // both are duplicated; the first size of image bytes of device are compared
+    bool verify(int deviceFd, int imageFd);
+
+    quint64 size() const;
+    quint64 bytesVerified() const;
+    double throughput() const; // bytes per second
+    // valid once finished
+    qint64 firstMismatch() const; // -1 if none
+    // merged, aligned on 4 KiB units
+    QList<Range> mismatchedRanges() const;
+    quint64 mismatchedBytes() const;
+    QString errorString() const;
+
+public Q_SLOTS:
+    void setThreads(int threads);
+    void setChunkSize(int chunkSize);
+
+    void cancel();
+
+Q_SIGNALS:
+    void progressChanged(double progress, double bytesPerSecond);
+    // identical is false on error too, see errorString()
+    void finished(bool identical);
+
+private:
+    QScopedPointer<DImageVerifierPrivate> d_ptr;
+};
+
+#endif // DIMAGEVERIFIER_H
@@ -0,0 +1,302 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dpartitiontable.h"
+#include "udisks2_interface.h"
+
+#include <QDBusPendingCallWatcher>
+#include <QSharedPointer>
+#include <QTimer>
+
+// UDisks2 aligns the partitions to 1 MiB
+static const qulonglong PartitionAlignment = 1024 * 1024;
+
+class DPartitionTablePrivate
+{
+public:
+    struct Layout
+    {
+        int id = 0;
+        QList<DPartitionSpec> specs;
+        QVariantMap options;
+        int next = 0;
+        qulonglong nextOffset = PartitionAlignment;
+        QStringList partitions;
+        bool creating = false;
+        int formatting = 0;
+        bool finished = false;
+        QDBusError error;
+    };
+
+    explicit DPartitionTablePrivate(DPartitionTable *qq)
+        : q_ptr(qq)
+    {
+
+    }
+
+    void createNext(const QSharedPointer<Layout> &layout);
+    void locateNext(const QSharedPointer<Layout> &layout, const QString &path);
+    void format(const QSharedPointer<Layout> &layout, int index, const QString &path);
+    void finishIfDone(const QSharedPointer<Layout> &layout);
+
+    OrgFreedesktopUDisks2PartitionTableInterface *dbus = nullptr;
+    QDBusError err;
+    // the one being applied, the offsets of its partitions depend on each other
+    QSharedPointer<Layout> layout;
+    int lastLayoutId = 0;
+    DPartitionTable *q_ptr;
+
+    Q_DECLARE_PUBLIC(DPartitionTable)
+};
+
+void DPartitionTablePrivate::createNext(const QSharedPointer<Layout> &layout)
+{
+    Q_Q(DPartitionTable);
+
+    if (layout->error.isValid() || layout->next >= layout->specs.count()) {
+        layout->creating = false;
+        finishIfDone(layout);
+        return;
+    }
+
+    const int index = layout->next++;
+    const DPartitionSpec &spec = layout->specs.at(index);
+    const qulonglong offset = spec.offset > 0 ? spec.offset : layout->nextOffset;
+
+    layout->creating = true;
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(dbus->CreatePartition(offset, spec.size, spec.type, spec.name, layout->options), q);
+
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, q, [this, layout, index] (QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+
+        QDBusPendingReply<QDBusObjectPath> reply = *w;
+
+        if (reply.isError()) {
+            layout->error = reply.error();
+            layout->creating = false;
+            finishIfDone(layout);
+            return;
+        }
+
+        const QString &path = reply.value().path();
+
+        layout->partitions << path;
+        Q_EMIT q_func()->partitionCreated(index, path);
+
+        // the format of this partition runs while the next one is being created
+        if (!layout->specs.at(index).filesystem.isEmpty()) {
+            format(layout, index, path);
+        }
+
+        locateNext(layout, path);
+    });
+}
+
+void DPartitionTablePrivate::locateNext(const QSharedPointer<Layout> &layout, const QString &path)
+{
+    Q_Q(DPartitionTable);
+
+    if (layout->next >= layout->specs.count() || layout->specs.at(layout->next).offset > 0) {
+        createNext(layout);
+        return;
+    }
+
+    // the next partition starts at the end of the one just created
+    QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, path, "org.freedesktop.DBus.Properties", "GetAll");
+    message << QStringLiteral(UDISKS2_SERVICE ".Partition");
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(dbus->connection().asyncCall(message), q);
+
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, q, [this, layout] (QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+
+        QDBusPendingReply<QVariantMap> reply = *w;
+
+        if (reply.isError()) {
+            layout->error = reply.error();
+        } else {
+            const QVariantMap &properties = reply.value();
+            const qulonglong end = properties.value("Offset").toULongLong() + properties.value("Size").toULongLong();
+
+            layout->nextOffset = (end + PartitionAlignment - 1) / PartitionAlignment * PartitionAlignment;
+        }
+
+        createNext(layout);
+    });
+}
+
+void DPartitionTablePrivate::format(const QSharedPointer<Layout> &layout, int index, const QString &path)
+{
+    Q_Q(DPartitionTable);
+
+    const DPartitionSpec &spec = layout->specs.at(index);
+    QVariantMap options = spec.formatOptions;
+
+    if (!spec.label.isEmpty()) {
+        options.insert("label", spec.label);
+    }
+
+    QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, path, UDISKS2_SERVICE ".Block", "Format");
+    message << spec.filesystem << options;
+
+    ++layout->formatting;
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(dbus->connection().asyncCall(message, INT_MAX), q);
+
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, q, [this, layout, index, path] (QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+
+        --layout->formatting;
+
+        if (w->isError()) {
+            if (!layout->error.isValid())
+                layout->error = w->error();
+        } else {
+            Q_EMIT q_func()->partitionFormatted(index, path);
+        }
+
+        finishIfDone(layout);
+    });
+}
+
+void DPartitionTablePrivate::finishIfDone(const QSharedPointer<Layout> &layout)
+{
+    Q_Q(DPartitionTable);
+
+    if (layout->creating || layout->formatting > 0 || layout->finished)
+        return;
+
+    layout->finished = true;
+
+    if (this->layout == layout)
+        this->layout.reset();
+
+    Q_EMIT q->layoutApplied(layout->id, layout->partitions, layout->error);
+}
+
+/*!
+ * \class DPartitionTable
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief DPartitionTable wraps the org.freedesktop.UDisks2.PartitionTable interface of a block device.
+ *
+ * \sa DDiskManager::createPartitionTable, DBlockDevice::ptType
+ */
+
+DPartitionTable::DPartitionTable(const QString &path, const QDBusConnection &connection, QObject *parent)
+    : QObject(parent)
+    , d_ptr(new DPartitionTablePrivate(this))
+{
+    d_ptr->dbus = new OrgFreedesktopUDisks2PartitionTableInterface(UDISKS2_SERVICE, path, connection, this);
+}
+
+DPartitionTable::~DPartitionTable()
+{
+
+}
+
+QString DPartitionTable::path() const
+{
+    Q_D(const DPartitionTable);
+
+    return d->dbus->path();
+}
+
+/*!
+ * \brief The type of the partition table, like "dos" or "gpt".
+ */
+QString DPartitionTable::type() const
+{
+    Q_D(const DPartitionTable);
+
+    return d->dbus->type();
+}
+
+QStringList DPartitionTable::partitions() const
+{
+    Q_D(const DPartitionTable);
+
+    QStringList list;
+
+    for (const QDBusObjectPath &path : d->dbus->partitions()) {
+        list << path.path();
+    }
+
+    return list;
+}
+
+QDBusError DPartitionTable::lastError() const
+{
+    Q_D(const DPartitionTable);
+
+    return d->err;
+}
+
+/*!
+ * \brief Create the partitions of \a layout, formatting and labeling them.
+ *
+ * This doesn't block: the partitions are created one after another (they share
+ * the same table) but each one is formatted as soon as its object path is
+ * returned, while the next partition is being created. partitionCreated() and
+ * partitionFormatted() report the progress, layoutApplied() is emitted with
+ * the returned id once everything is done or at the first error, always from
+ * the event loop. A layout applied while another one runs on the same table
+ * fails at once, the offsets of their partitions would overlap.
+ *
+ * \param options Options passed to CreatePartition, see
+ * \l {http://storaged.org/doc/udisks2-api/latest/gdbus-org.freedesktop.UDisks2.PartitionTable.html} {UDisks2.PartitionTable}
+ */
+int DPartitionTable::applyLayout(const QList<DPartitionSpec> &layout, const QVariantMap &options)
+{
+    Q_D(DPartitionTable);
+
+    QSharedPointer<DPartitionTablePrivate::Layout> state(new DPartitionTablePrivate::Layout);
+
+    state->id = ++d->lastLayoutId;
+    state->specs = layout;
+    state->options = options;
+
+    if (d->layout) {
+        state->error = QDBusError(QDBusError::Failed, QStringLiteral("A layout is being applied to %1").arg(path()));
+
+        QTimer::singleShot(0, this, [d, state] {
+            d->finishIfDone(state);
+        });
+
+        return state->id;
+    }
+
+    d->layout = state;
+
+    // like the batches of DDiskManager, even an empty layout finishes from the event loop
+    QTimer::singleShot(0, this, [d, state] {
+        d->createNext(state);
+    });
+
+    return state->id;
+}
+
+QString DPartitionTable::createPartition(qulonglong offset, qulonglong size, const QString &type, const QString &name, const QVariantMap &options)
+{
+    Q_D(DPartitionTable);
+
+    auto r = d->dbus->CreatePartition(offset, size, type, name, options);
+    r.waitForFinished();
+    d->err = r.error();
+    return r.value().path();
+}
+
+QString DPartitionTable::createPartitionAndFormat(qulonglong offset, qulonglong size, const QString &type, const QString &name,
+                                                  const QVariantMap &options, const QString &formatType, const QVariantMap &formatOptions)
+{
+    Q_D(DPartitionTable);
+
+    d->dbus->setTimeout(INT_MAX);
+    auto r = d->dbus->CreatePartitionAndFormat(offset, size, type, name, options, formatType, formatOptions);
+    r.waitForFinished();
+    d->err = r.error();
+    d->dbus->setTimeout(-1);
+    return r.value().path();
+}
@@ -0,0 +1,67 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DPARTITIONTABLE_H
+#define DPARTITIONTABLE_H
+
+#include <QObject>
+#include <QVariantMap>
+#include <QDBusConnection>
+#include <QDBusError>
+
+// One entry of a declarative partition layout, see DPartitionTable::applyLayout()
+struct DPartitionSpec
+{
+    qulonglong offset = 0; // 0 to place it right after the previous partition
+    qulonglong size = 0; // 0 for the maximal size
+    QString type; // partition type, blank for the default of the table
+    QString name; // partition name, blank if the table doesn't support names
+    QString filesystem; // blank to leave the partition unformatted
+    QString label; // filesystem label
+    QVariantMap formatOptions;
+};
+
+Q_DECLARE_METATYPE(DPartitionSpec)
+
+class DPartitionTablePrivate;
+class DPartitionTable : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(DPartitionTable)
+
+    Q_PROPERTY(QString path READ path CONSTANT FINAL)
+    Q_PROPERTY(QString type READ type)
+    Q_PROPERTY(QStringList partitions READ partitions)
+
+public:
+    ~DPartitionTable();
+
+    QString path() const;
+    QString type() const;
+    QStringList partitions() const;
+
+    QDBusError lastError() const;
+
+    // returns the id layoutApplied() reports, one layout at a time runs on a table
+    int applyLayout(const QList<DPartitionSpec> &layout, const QVariantMap &options);
+
+public Q_SLOTS: // METHODS
+    QString createPartition(qulonglong offset, qulonglong size, const QString &type, const QString &name, const QVariantMap &options);
+    QString createPartitionAndFormat(qulonglong offset, qulonglong size, const QString &type, const QString &name,
+                                     const QVariantMap &options, const QString &formatType, const QVariantMap &formatOptions);
+
+Q_SIGNALS:
+    void partitionCreated(int index, const QString &path);
+    void partitionFormatted(int index, const QString &path);
+    void layoutApplied(int layoutId, const QStringList &partitions, const QDBusError &error);
+
+private:
+    explicit DPartitionTable(const QString &path, const QDBusConnection &connection, QObject *parent = nullptr);
+
+    QScopedPointer<DPartitionTablePrivate> d_ptr;
+
+    friend class DDiskManager;
+};
+
+#endif // DPARTITIONTABLE_H
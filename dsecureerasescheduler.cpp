@@ -0,0 +1,480 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dsecureerasescheduler.h"
+#include "ddiskmanager.h"
+#include "dudisksjob.h"
+#include "udisks2_dbus_common.h"
+#include "objectmanager_interface.h"
+
+#include <QDateTime>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QHash>
+#include <QPointer>
+#include <QTimer>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#define DRIVE_ATA_INTERFACE UDISKS2_SERVICE ".Drive.Ata"
+
+class DSecureEraseSchedulerPrivate
+{
+public:
+    enum State {
+        Probing, // reading SecurityEraseUnitMinutes
+        Pending,
+        Running,
+        Done
+    };
+
+    struct Erase
+    {
+        State state = Probing;
+        bool enhanced = false;
+        QVariantMap options;
+        int minutes = 0; // estimated by the drive
+        qint64 startTime = 0; // msecs since epoch
+        double progress = 0;
+        QPointer<DUDisksJob> job;
+    };
+
+    DSecureEraseSchedulerPrivate(DSecureEraseScheduler *qq, const QDBusConnection &connection);
+
+    void probe(const QString &drive);
+    void schedule();
+    void start(const QString &drive);
+    void finish(const QString &drive, const QDBusError &error);
+    double progressOf(const Erase &erase) const;
+    QHash<QString, qint64> completionTimes() const;
+    void updateTotal();
+    void checkIdle();
+
+    QDBusConnection connection;
+    int maxConcurrentErases = 0;
+    QMap<QString, Erase> erases; // by drive
+    QStringList queue; // the pending drives, in the order of enqueue()
+    QTimer ticker;
+
+    DSecureEraseScheduler *q_ptr;
+
+    Q_DECLARE_PUBLIC(DSecureEraseScheduler)
+};
+
+DSecureEraseSchedulerPrivate::DSecureEraseSchedulerPrivate(DSecureEraseScheduler *qq, const QDBusConnection &connection)
+    : connection(connection)
+    , q_ptr(qq)
+{
+    // udisksd updates the progress of the job once a minute or so, the estimated one moves in between
+    ticker.setInterval(10 * 1000);
+}
+
+// The drive tells how long the erase takes, and refuses it if its security is frozen
+void DSecureEraseSchedulerPrivate::probe(const QString &drive)
+{
+    Q_Q(DSecureEraseScheduler);
+
+    QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, drive, "org.freedesktop.DBus.Properties", "GetAll");
+
+    message << QStringLiteral(DRIVE_ATA_INTERFACE);
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(connection.asyncCall(message), q);
+
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, q, [this, drive] (QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+
+        auto erase = erases.find(drive);
+
+        if (erase == erases.end() || erase->state != Probing)
+            return;
+
+        QDBusPendingReply<QVariantMap> reply = *w;
+
+        if (reply.isError()) {
+            finish(drive, reply.error());
+            return;
+        }
+
+        const QVariantMap &properties = reply.value();
+
+        erase->minutes = properties.value(erase->enhanced ? "SecurityEnhancedEraseUnitMinutes" : "SecurityEraseUnitMinutes").toInt();
+
+        if (erase->minutes <= 0) {
+            finish(drive, QDBusError(QDBusError::NotSupported, erase->enhanced ? QStringLiteral("Enhanced secure erase is not supported by %1").arg(drive)
+                                                                               : QStringLiteral("Secure erase is not supported by %1").arg(drive)));
+            return;
+        }
+
+        if (properties.value("SecurityFrozen").toBool()) {
+            finish(drive, QDBusError(QDBusError::AccessDenied, QStringLiteral("The security of %1 is frozen, suspend and resume the computer to unfreeze it").arg(drive)));
+            return;
+        }
+
+        erase->state = Pending;
+        queue.append(drive);
+        schedule();
+    });
+}
+
+void DSecureEraseSchedulerPrivate::schedule()
+{
+    int running = 0;
+
+    for (const Erase &erase : erases) {
+        if (erase.state == Running)
+            ++running;
+    }
+
+    while (!queue.isEmpty() && (maxConcurrentErases == 0 || running < maxConcurrentErases)) {
+        start(queue.takeFirst());
+        ++running;
+    }
+
+    updateTotal();
+    checkIdle();
+}
+
+void DSecureEraseSchedulerPrivate::start(const QString &drive)
+{
+    Q_Q(DSecureEraseScheduler);
+
+    Erase &erase = erases[drive];
+    QVariantMap options = erase.options;
+
+    options.insert(QStringLiteral("enhanced"), erase.enhanced);
+    erase.state = Running;
+    erase.startTime = QDateTime::currentMSecsSinceEpoch();
+
+    QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, drive, DRIVE_ATA_INTERFACE, "SecurityEraseUnit");
+
+    message << options;
+
+    // returns when the drive is erased, hours later
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(connection.asyncCall(message, INT_MAX), q);
+
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, q, [this, drive] (QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+        finish(drive, w->error());
+    });
+
+    if (!ticker.isActive())
+        ticker.start();
+
+    Q_EMIT q->started(drive, erase.enhanced);
+}
+
+void DSecureEraseSchedulerPrivate::finish(const QString &drive, const QDBusError &error)
+{
+    Q_Q(DSecureEraseScheduler);
+
+    auto erase = erases.find(drive);
+
+    if (erase == erases.end() || erase->state == Done)
+        return;
+
+    erase->state = Done;
+
+    if (erase->job)
+        erase->job->deleteLater();
+
+    if (!error.isValid()) {
+        erase->progress = 1;
+        Q_EMIT q->progressChanged(drive, 1);
+    }
+
+    Q_EMIT q->finished(drive, error);
+
+    schedule();
+}
+
+double DSecureEraseSchedulerPrivate::progressOf(const Erase &erase) const
+{
+    switch (erase.state) {
+    case Running:
+        if (erase.job && erase.job->progressValid())
+            return erase.job->progress();
+
+        // the estimate of the drive may be short, never claim it is over
+        return qMin(0.99, (QDateTime::currentMSecsSinceEpoch() - erase.startTime) / (erase.minutes * 60.0 * 1000));
+    case Done:
+        return erase.progress;
+    default:
+        return 0;
+    }
+}
+
+// The end time of each running and pending erase: the pending ones take the
+// place of the first erase to end when the count of erases is limited
+QHash<QString, qint64> DSecureEraseSchedulerPrivate::completionTimes() const
+{
+    QHash<QString, qint64> times;
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    std::vector<qint64> ends;
+
+    for (auto i = erases.constBegin(); i != erases.constEnd(); ++i) {
+        if (i->state != Running)
+            continue;
+
+        qint64 end = i->startTime + i->minutes * 60LL * 1000;
+
+        // in usecs since epoch
+        if (i->job && i->job->expectedEndTime() > 0)
+            end = static_cast<qint64>(i->job->expectedEndTime() / 1000);
+
+        end = qMax(end, now);
+        times.insert(i.key(), end);
+        ends.push_back(end);
+    }
+
+    if (maxConcurrentErases > 0) {
+        while (ends.size() < static_cast<size_t>(maxConcurrentErases))
+            ends.push_back(now);
+    }
+
+    // a min-heap of the times the slots become free
+    std::make_heap(ends.begin(), ends.end(), std::greater<qint64>());
+
+    for (const QString &drive : queue) {
+        const Erase &erase = erases[drive];
+        qint64 begin = now;
+
+        if (maxConcurrentErases > 0) {
+            std::pop_heap(ends.begin(), ends.end(), std::greater<qint64>());
+            begin = ends.back();
+            ends.pop_back();
+        }
+
+        const qint64 end = begin + erase.minutes * 60LL * 1000;
+
+        times.insert(drive, end);
+
+        if (maxConcurrentErases > 0) {
+            ends.push_back(end);
+            std::push_heap(ends.begin(), ends.end(), std::greater<qint64>());
+        }
+    }
+
+    return times;
+}
+
+void DSecureEraseSchedulerPrivate::updateTotal()
+{
+    Q_Q(DSecureEraseScheduler);
+
+    Q_EMIT q->totalProgressChanged(q->progress(), q->estimatedCompletion());
+}
+
+void DSecureEraseSchedulerPrivate::checkIdle()
+{
+    Q_Q(DSecureEraseScheduler);
+
+    for (const Erase &erase : erases) {
+        if (erase.state != Done)
+            return;
+    }
+
+    ticker.stop();
+
+    Q_EMIT q->allFinished();
+}
+
+/*!
+ * \class DSecureEraseScheduler
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief Erases many ATA drives at once with SECURITY ERASE UNIT.
+ *
+ * The erase is done by the firmware of each drive, so dozens of them can run
+ * in parallel without loading the computer. Before an erase is started, the
+ * Drive.Ata properties tell how long it takes (SecurityEraseUnitMinutes or
+ * SecurityEnhancedEraseUnitMinutes) and whether the drive is frozen.
+ *
+ * The progress of each erase comes from its UDisks2 job, or from its elapsed
+ * time if the job has none. progress() weights the erases of the batch by
+ * their duration, and estimatedCompletion() accounts for the erases waiting
+ * for a slot when maxConcurrentErases() is set.
+ */
+
+DSecureEraseScheduler::DSecureEraseScheduler(QObject *parent)
+    : DSecureEraseScheduler(QDBusConnection::systemBus(), parent)
+{
+
+}
+
+DSecureEraseScheduler::DSecureEraseScheduler(const QDBusConnection &connection, QObject *parent)
+    : QObject(parent)
+    , d_ptr(new DSecureEraseSchedulerPrivate(this, connection))
+{
+    Q_D(DSecureEraseScheduler);
+
+    connect(UDisks2::objectManager(connection), &OrgFreedesktopDBusObjectManagerInterface::InterfacesAdded,
+            this, &DSecureEraseScheduler::onInterfacesAdded);
+    connect(&d->ticker, &QTimer::timeout, this, [this, d] {
+        for (auto i = d->erases.constBegin(); i != d->erases.constEnd(); ++i) {
+            if (i->state == DSecureEraseSchedulerPrivate::Running && !(i->job && i->job->progressValid()))
+                Q_EMIT progressChanged(i.key(), d->progressOf(i.value()));
+        }
+
+        d->updateTotal();
+    });
+}
+
+DSecureEraseScheduler::~DSecureEraseScheduler()
+{
+
+}
+
+int DSecureEraseScheduler::maxConcurrentErases() const
+{
+    Q_D(const DSecureEraseScheduler);
+
+    return d->maxConcurrentErases;
+}
+
+bool DSecureEraseScheduler::isIdle() const
+{
+    Q_D(const DSecureEraseScheduler);
+
+    for (const DSecureEraseSchedulerPrivate::Erase &erase : d->erases) {
+        if (erase.state != DSecureEraseSchedulerPrivate::Done)
+            return false;
+    }
+
+    return true;
+}
+
+QStringList DSecureEraseScheduler::drives() const
+{
+    Q_D(const DSecureEraseScheduler);
+
+    return d->erases.keys();
+}
+
+double DSecureEraseScheduler::progress() const
+{
+    Q_D(const DSecureEraseScheduler);
+
+    double done = 0;
+    double total = 0;
+
+    for (const DSecureEraseSchedulerPrivate::Erase &erase : d->erases) {
+        if (erase.minutes <= 0)
+            continue;
+
+        // a failed erase has nothing left to do
+        done += (erase.state == DSecureEraseSchedulerPrivate::Done ? 1.0 : d->progressOf(erase)) * erase.minutes;
+        total += erase.minutes;
+    }
+
+    return total > 0 ? done / total : 0;
+}
+
+double DSecureEraseScheduler::progress(const QString &drivePath) const
+{
+    Q_D(const DSecureEraseScheduler);
+
+    auto erase = d->erases.constFind(drivePath);
+
+    return erase == d->erases.constEnd() ? 0 : d->progressOf(erase.value());
+}
+
+qint64 DSecureEraseScheduler::estimatedCompletion() const
+{
+    Q_D(const DSecureEraseScheduler);
+
+    qint64 end = 0;
+
+    for (qint64 time : d->completionTimes()) {
+        end = qMax(end, time);
+    }
+
+    return end;
+}
+
+qint64 DSecureEraseScheduler::estimatedCompletion(const QString &drivePath) const
+{
+    Q_D(const DSecureEraseScheduler);
+
+    return d->completionTimes().value(drivePath);
+}
+
+void DSecureEraseScheduler::setMaxConcurrentErases(int count)
+{
+    Q_D(DSecureEraseScheduler);
+
+    d->maxConcurrentErases = qMax(0, count);
+
+    if (!d->queue.isEmpty())
+        d->schedule();
+}
+
+void DSecureEraseScheduler::enqueue(const QString &drivePath, bool enhanced, const QVariantMap &options)
+{
+    Q_D(DSecureEraseScheduler);
+
+    // a new batch
+    if (isIdle())
+        d->erases.clear();
+
+    auto erase = d->erases.constFind(drivePath);
+
+    if (erase != d->erases.constEnd() && erase->state != DSecureEraseSchedulerPrivate::Done)
+        return;
+
+    DSecureEraseSchedulerPrivate::Erase &e = d->erases[drivePath];
+
+    e = DSecureEraseSchedulerPrivate::Erase();
+    e.enhanced = enhanced;
+    e.options = options;
+
+    d->probe(drivePath);
+}
+
+void DSecureEraseScheduler::cancel(const QString &drivePath)
+{
+    Q_D(DSecureEraseScheduler);
+
+    auto erase = d->erases.find(drivePath);
+
+    if (erase == d->erases.end() || (erase->state != DSecureEraseSchedulerPrivate::Probing && erase->state != DSecureEraseSchedulerPrivate::Pending))
+        return;
+
+    d->queue.removeAll(drivePath);
+    d->finish(drivePath, QDBusError(QDBusError::Failed, QStringLiteral("Cancelled")));
+}
+
+void DSecureEraseScheduler::onInterfacesAdded(const QDBusObjectPath &object_path, const QMap<QString, QVariantMap> &interfaces_and_properties)
+{
+    Q_D(DSecureEraseScheduler);
+
+    const QVariantMap &job = interfaces_and_properties.value(QStringLiteral(UDISKS2_SERVICE ".Job"));
+    const QString &operation = job.value("Operation").toString();
+
+    if (operation != QLatin1String("ata-secure-erase") && operation != QLatin1String("ata-enhanced-secure-erase"))
+        return;
+
+    const QStringList &objects = UDisks2::demarshal(job.value("Objects")).toStringList();
+
+    for (auto i = d->erases.begin(); i != d->erases.end(); ++i) {
+        if (i->state != DSecureEraseSchedulerPrivate::Running || i->job || !objects.contains(i.key()))
+            continue;
+
+        const QString path = i.key();
+
+        i->job = DDiskManager::createJob(object_path.path(), d->connection, this);
+        connect(i->job.data(), &DUDisksJob::progressChanged, this, [this, path] (double progress) {
+            Q_D(DSecureEraseScheduler);
+
+            Q_EMIT progressChanged(path, progress);
+            d->updateTotal();
+        });
+        connect(i->job.data(), &DUDisksJob::expectedEndTimeChanged, this, [d] {
+            d->updateTotal();
+        });
+
+        break;
+    }
+}
@@ -0,0 +1,65 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DSECUREERASESCHEDULER_H
+#define DSECUREERASESCHEDULER_H
+
+#include <QObject>
+#include <QVariantMap>
+#include <QDBusConnection>
+#include <QDBusError>
+
+class DSecureEraseSchedulerPrivate;
+class DSecureEraseScheduler : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(DSecureEraseScheduler)
+
+    Q_PROPERTY(int maxConcurrentErases READ maxConcurrentErases WRITE setMaxConcurrentErases)
+    Q_PROPERTY(double progress READ progress)
+    Q_PROPERTY(qint64 estimatedCompletion READ estimatedCompletion)
+    Q_PROPERTY(bool idle READ isIdle)
+
+public:
+    explicit DSecureEraseScheduler(QObject *parent = nullptr);
+    explicit DSecureEraseScheduler(const QDBusConnection &connection, QObject *parent = nullptr);
+    ~DSecureEraseScheduler();
+
+    // 0 表示不限制
+    int maxConcurrentErases() const;
+    bool isIdle() const;
+
+    // the drives of the current batch, the ones finished included until the next batch
+    QStringList drives() const;
+
+    // 0..1, weighted by the estimated duration of each erase
+    double progress() const;
+    double progress(const QString &drivePath) const;
+    // msecs since epoch, 0 if unknown; the pending erases are counted after the running ones
+    qint64 estimatedCompletion() const;
+    qint64 estimatedCompletion(const QString &drivePath) const;
+
+public Q_SLOTS:
+    void setMaxConcurrentErases(int count);
+
+    // all the data of the drive is erased by the drive itself, see Drive.Ata.SecurityEraseUnit
+    void enqueue(const QString &drivePath, bool enhanced = false, const QVariantMap &options = {});
+    // only the erases not started yet can be cancelled, the drive doesn't interrupt SECURITY ERASE UNIT
+    void cancel(const QString &drivePath);
+
+Q_SIGNALS:
+    void started(const QString &drivePath, bool enhanced);
+    void progressChanged(const QString &drivePath, double progress);
+    void totalProgressChanged(double progress, qint64 estimatedCompletion);
+    void finished(const QString &drivePath, const QDBusError &error);
+    void allFinished();
+
+private:
+    QScopedPointer<DSecureEraseSchedulerPrivate> d_ptr;
+
+private Q_SLOTS:
+    void onInterfacesAdded(const QDBusObjectPath &object_path, const QMap<QString, QVariantMap> &interfaces_and_properties);
+};
+
+#endif // DSECUREERASESCHEDULER_H
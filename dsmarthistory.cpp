@@ -0,0 +1,662 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dsmarthistory.h"
+#include "ddriveinfo.h"
+
+#include <QDateTime>
+#include <QDBusMessage>
+#include <QDBusMetaType>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDir>
+#include <QHash>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Layout of a history file, in the byte order of the host (it never leaves the machine):
+//   FileHeader, then DiskRecord in the order of their timestamps
+// A sample is written by one write(2); a record cut by a crash is dropped on the next append.
+namespace {
+const quint32 Magic = 0x44534d48; // "DSMH"
+const quint16 Version = 1;
+
+struct FileHeader
+{
+    quint32 magic;
+    quint16 version;
+    quint16 recordSize;
+    quint32 reserved[2];
+};
+
+struct DiskRecord
+{
+    qint64 timestamp;
+    qint64 pretty;
+    qint32 value;
+    qint32 worst;
+    qint32 threshold;
+    quint16 flags;
+    quint8 id;
+    quint8 prettyUnit;
+};
+
+static_assert(sizeof(FileHeader) == 16, "FileHeader is part of the file format");
+static_assert(sizeof(DiskRecord) == 32, "DiskRecord is part of the file format");
+
+// the attributes the trends are computed from
+enum AttributeId {
+    ReallocatedSectorCount = 5,
+    AirflowTemperature = 190,
+    Temperature = 194,
+    CurrentPendingSector = 197,
+    OfflineUncorrectable = 198
+};
+
+enum PrettyUnit {
+    DimensionlessUnit = 1,
+    SectorsUnit = 3,
+    MillikelvinUnit = 4
+};
+}
+
+class DSmartHistoryPrivate
+{
+public:
+    struct Series
+    {
+        int fd = -1;
+        bool writable = false;
+        const uchar *map = nullptr;
+        size_t mapped = 0;
+        quint64 count = 0; // complete records
+        qint64 last = 0; // timestamp of the last record
+    };
+
+    explicit DSmartHistoryPrivate(DSmartHistory *qq)
+        : q_ptr(qq)
+    {
+
+    }
+
+    ~DSmartHistoryPrivate();
+
+    QString fileName(const QString &drive) const;
+    Series *open(const QString &drive, bool writable) const;
+    bool remap(Series *series) const;
+    void close(Series *series) const;
+    // the first mapped record not older than timestamp
+    const DiskRecord *lowerBound(const Series *series, qint64 timestamp) const;
+
+    QString directory;
+    DSmartTrendThresholds thresholds;
+    mutable QString errorString;
+    // opened on first use and kept, a drive is sampled and queried again and again
+    mutable QHash<QString, Series> series;
+
+    DSmartHistory *q_ptr;
+
+    Q_DECLARE_PUBLIC(DSmartHistory)
+};
+
+DSmartHistoryPrivate::~DSmartHistoryPrivate()
+{
+    for (Series &s : series) {
+        close(&s);
+    }
+}
+
+QString DSmartHistoryPrivate::fileName(const QString &drive) const
+{
+    return directory + QLatin1Char('/') + drive + QStringLiteral(".smart");
+}
+
+DSmartHistoryPrivate::Series *DSmartHistoryPrivate::open(const QString &drive, bool writable) const
+{
+    if (drive.isEmpty() || drive.contains(QLatin1Char('/'))) {
+        errorString = QStringLiteral("Invalid drive key \"%1\"").arg(drive);
+        return nullptr;
+    }
+
+    auto it = series.find(drive);
+
+    if (it != series.end()) {
+        if (!writable || it->writable)
+            return &it.value();
+
+        // reopened for writing below
+        close(&it.value());
+        series.erase(it);
+    }
+
+    const QByteArray &path = fileName(drive).toLocal8Bit();
+    int fd;
+
+    if (writable) {
+        if (!QDir().mkpath(directory)) {
+            errorString = QStringLiteral("Cannot create %1").arg(directory);
+            return nullptr;
+        }
+
+        fd = ::open(path.constData(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    } else {
+        fd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+    }
+
+    if (fd < 0) {
+        errorString = QString::fromLocal8Bit(strerror(errno));
+        return nullptr;
+    }
+
+    struct stat st;
+
+    if (::fstat(fd, &st) < 0) {
+        errorString = QString::fromLocal8Bit(strerror(errno));
+        ::close(fd);
+        return nullptr;
+    }
+
+    FileHeader header;
+
+    if (st.st_size == 0 && writable) {
+        memset(&header, 0, sizeof(header));
+        header.magic = Magic;
+        header.version = Version;
+        header.recordSize = sizeof(DiskRecord);
+
+        if (::write(fd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header))) {
+            errorString = QString::fromLocal8Bit(strerror(errno));
+            ::ftruncate(fd, 0);
+            ::close(fd);
+            return nullptr;
+        }
+    } else if (::pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))
+               || header.magic != Magic || header.version > Version || header.recordSize != sizeof(DiskRecord)) {
+        errorString = QStringLiteral("%1 is not a SMART history file").arg(fileName(drive));
+        ::close(fd);
+        return nullptr;
+    }
+
+    Series s;
+
+    s.fd = fd;
+    s.writable = writable;
+
+    Series *result = &series.insert(drive, s).value();
+
+    if (!remap(result)) {
+        close(result);
+        series.remove(drive);
+        return nullptr;
+    }
+
+    return result;
+}
+
+// Follows the size of the file, the records are appended after the mapping was made
+bool DSmartHistoryPrivate::remap(Series *series) const
+{
+    struct stat st;
+
+    if (::fstat(series->fd, &st) < 0) {
+        errorString = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+
+    const quint64 count = (static_cast<quint64>(st.st_size) - qMin<quint64>(st.st_size, sizeof(FileHeader))) / sizeof(DiskRecord);
+    const size_t size = sizeof(FileHeader) + count * sizeof(DiskRecord);
+
+    if (series->map && size == series->mapped)
+        return true;
+
+    if (series->map) {
+        ::munmap(const_cast<uchar *>(series->map), series->mapped);
+        series->map = nullptr;
+        series->mapped = 0;
+    }
+
+    series->count = count;
+    series->last = 0;
+
+    if (count == 0)
+        return true;
+
+    void *map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, series->fd, 0);
+
+    if (map == MAP_FAILED) {
+        errorString = QString::fromLocal8Bit(strerror(errno));
+        series->count = 0;
+        return false;
+    }
+
+    series->map = static_cast<const uchar *>(map);
+    series->mapped = size;
+    series->last = reinterpret_cast<const DiskRecord *>(series->map + sizeof(FileHeader))[count - 1].timestamp;
+
+    return true;
+}
+
+void DSmartHistoryPrivate::close(Series *series) const
+{
+    if (series->map)
+        ::munmap(const_cast<uchar *>(series->map), series->mapped);
+
+    if (series->fd >= 0)
+        ::close(series->fd);
+
+    *series = Series();
+}
+
+const DiskRecord *DSmartHistoryPrivate::lowerBound(const Series *series, qint64 timestamp) const
+{
+    const DiskRecord *begin = reinterpret_cast<const DiskRecord *>(series->map + sizeof(FileHeader));
+
+    return std::lower_bound(begin, begin + series->count, timestamp, [] (const DiskRecord &record, qint64 timestamp) {
+        return record.timestamp < timestamp;
+    });
+}
+
+/*!
+ * \class DSmartHistory
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief Time series of the SMART attributes of the drives.
+ *
+ * Each drive has an append-only file in directory(), named after driveKey() so
+ * the history follows the drive from a port to another. The files are memory
+ * mapped: records() and assess() find the start of a range by a binary search
+ * on the timestamps and read the records in place.
+ *
+ * assess() computes the growth of the reallocated, pending and uncorrectable
+ * sectors and the temperature excursions over the window of thresholds(), a
+ * drive crossing one of them is degrading.
+ */
+
+DSmartHistory::DSmartHistory(const QString &directory, QObject *parent)
+    : QObject(parent)
+    , d_ptr(new DSmartHistoryPrivate(this))
+{
+    Q_D(DSmartHistory);
+
+    qDBusRegisterMetaType<UDisks2::SmartAttribute>();
+    qDBusRegisterMetaType<QList<UDisks2::SmartAttribute>>();
+
+    d->directory = directory.isEmpty()
+            ? QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QStringLiteral("/udisks2-qt5/smart-history")
+            : directory;
+}
+
+DSmartHistory::~DSmartHistory()
+{
+
+}
+
+QString DSmartHistory::driveKey(const QString &wwn, const QString &serial)
+{
+    QString key = wwn.isEmpty() ? serial.trimmed() : wwn.trimmed();
+
+    for (QChar &c : key) {
+        if (!c.isLetterOrNumber() && c != QLatin1Char('-') && c != QLatin1Char('_') && c != QLatin1Char('.'))
+            c = QLatin1Char('_');
+    }
+
+    // no hidden file, no "." nor ".."
+    if (key.startsWith(QLatin1Char('.')))
+        key[0] = QLatin1Char('_');
+
+    return key;
+}
+
+QString DSmartHistory::driveKey(const DDriveInfo &drive)
+{
+    return driveKey(drive.WWN(), drive.serial());
+}
+
+QString DSmartHistory::directory() const
+{
+    Q_D(const DSmartHistory);
+
+    return d->directory;
+}
+
+QStringList DSmartHistory::drives() const
+{
+    Q_D(const DSmartHistory);
+
+    QStringList list;
+
+    for (const QString &name : QDir(d->directory).entryList({QStringLiteral("*.smart")}, QDir::Files)) {
+        list << name.left(name.length() - 6);
+    }
+
+    return list;
+}
+
+bool DSmartHistory::append(const QString &drive, const QList<UDisks2::SmartAttribute> &attributes, qint64 timestamp)
+{
+    Q_D(DSmartHistory);
+
+    if (attributes.isEmpty())
+        return true;
+
+    DSmartHistoryPrivate::Series *series = d->open(drive, true);
+
+    if (!series || !d->remap(series))
+        return false;
+
+    // drop a record cut by a crash, the next ones would be misaligned
+    const off_t size = static_cast<off_t>(sizeof(FileHeader) + series->count * sizeof(DiskRecord));
+
+    if (::lseek(series->fd, 0, SEEK_END) != size && ::ftruncate(series->fd, size) < 0) {
+        d->errorString = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+
+    // the binary search needs sorted timestamps, don't go back with the clock
+    if (timestamp <= 0)
+        timestamp = QDateTime::currentMSecsSinceEpoch();
+
+    timestamp = qMax(timestamp, series->last);
+
+    std::vector<DiskRecord> records(static_cast<size_t>(attributes.size()));
+
+    for (int i = 0; i < attributes.size(); ++i) {
+        const UDisks2::SmartAttribute &attribute = attributes.at(i);
+        DiskRecord &record = records[static_cast<size_t>(i)];
+
+        record.timestamp = timestamp;
+        record.pretty = attribute.pretty;
+        record.value = attribute.value;
+        record.worst = attribute.worst;
+        record.threshold = attribute.threshold;
+        record.flags = attribute.flags;
+        record.id = attribute.id;
+        record.prettyUnit = static_cast<quint8>(qBound(0, attribute.pretty_unit, 255));
+    }
+
+    const ssize_t length = static_cast<ssize_t>(records.size() * sizeof(DiskRecord));
+
+    if (::write(series->fd, records.data(), static_cast<size_t>(length)) != length) {
+        d->errorString = QString::fromLocal8Bit(strerror(errno));
+        ::ftruncate(series->fd, size);
+        return false;
+    }
+
+    ::fdatasync(series->fd);
+
+    return d->remap(series);
+}
+
+QVector<DSmartRecord> DSmartHistory::records(const QString &drive, qint64 from, qint64 to, int attributeId) const
+{
+    Q_D(const DSmartHistory);
+
+    QVector<DSmartRecord> list;
+    DSmartHistoryPrivate::Series *series = d->open(drive, false);
+
+    if (!series || !d->remap(series) || series->count == 0)
+        return list;
+
+    const DiskRecord *end = reinterpret_cast<const DiskRecord *>(series->map + sizeof(FileHeader)) + series->count;
+
+    for (const DiskRecord *record = d->lowerBound(series, from); record != end && record->timestamp <= to; ++record) {
+        if (attributeId >= 0 && record->id != attributeId)
+            continue;
+
+        DSmartRecord r;
+
+        r.timestamp = record->timestamp;
+        r.id = record->id;
+        r.flags = record->flags;
+        r.value = record->value;
+        r.worst = record->worst;
+        r.threshold = record->threshold;
+        r.pretty = record->pretty;
+        r.prettyUnit = record->prettyUnit;
+        list << r;
+    }
+
+    return list;
+}
+
+qint64 DSmartHistory::lastTimestamp(const QString &drive) const
+{
+    Q_D(const DSmartHistory);
+
+    DSmartHistoryPrivate::Series *series = d->open(drive, false);
+
+    if (!series || !d->remap(series))
+        return 0;
+
+    return series->last;
+}
+
+DSmartTrendThresholds DSmartHistory::thresholds() const
+{
+    Q_D(const DSmartHistory);
+
+    return d->thresholds;
+}
+
+void DSmartHistory::setThresholds(const DSmartTrendThresholds &thresholds)
+{
+    Q_D(DSmartHistory);
+
+    d->thresholds = thresholds;
+}
+
+DSmartAssessment DSmartHistory::assess(const QString &drive) const
+{
+    Q_D(const DSmartHistory);
+
+    DSmartAssessment assessment;
+
+    assessment.drive = drive;
+
+    DSmartHistoryPrivate::Series *series = d->open(drive, false);
+
+    if (!series || !d->remap(series) || series->count == 0)
+        return assessment;
+
+    const DSmartTrendThresholds &thresholds = d->thresholds;
+
+    assessment.to = series->last;
+    assessment.from = series->last - thresholds.window;
+
+    // the first and the last raw counts of the sector attributes in the window
+    struct Count
+    {
+        qint64 first = -1;
+        qint64 firstTime = 0;
+        qint64 last = -1;
+        qint64 lastTime = 0;
+    };
+
+    // by attribute, 194 is preferred to 190 if the drive has both
+    struct Excursions
+    {
+        bool seen = false;
+        bool hot = false;
+        int count = 0;
+    };
+
+    Count reallocated, pending, uncorrectable;
+    Excursions temperature, airflowTemperature;
+    bool belowThreshold = false;
+    qint64 sampleTime = -1;
+    const DiskRecord *end = reinterpret_cast<const DiskRecord *>(series->map + sizeof(FileHeader)) + series->count;
+
+    for (const DiskRecord *record = d->lowerBound(series, assessment.from); record != end; ++record) {
+        if (record->timestamp != sampleTime) {
+            sampleTime = record->timestamp;
+            ++assessment.samples;
+            // only the last sample tells whether an attribute is at its threshold now
+            belowThreshold = false;
+        }
+
+        Count *count = nullptr;
+
+        switch (record->id) {
+        case ReallocatedSectorCount:
+            count = &reallocated;
+            break;
+        case CurrentPendingSector:
+            count = &pending;
+            break;
+        case OfflineUncorrectable:
+            count = &uncorrectable;
+            break;
+        case Temperature:
+        case AirflowTemperature:
+            if (record->prettyUnit == MillikelvinUnit) {
+                const double celsius = record->pretty / 1000.0 - 273.15;
+                Excursions &excursions = record->id == Temperature ? temperature : airflowTemperature;
+
+                assessment.maxTemperature = qMax(assessment.maxTemperature, celsius);
+                excursions.seen = true;
+
+                // an excursion is counted once, when the temperature goes above the threshold
+                if (celsius > thresholds.maxTemperature) {
+                    if (!excursions.hot)
+                        ++excursions.count;
+
+                    excursions.hot = true;
+                } else {
+                    excursions.hot = false;
+                }
+            }
+            break;
+        default:
+            break;
+        }
+
+        if (count && (record->prettyUnit == SectorsUnit || record->prettyUnit == DimensionlessUnit)) {
+            if (count->first < 0) {
+                count->first = record->pretty;
+                count->firstTime = record->timestamp;
+            }
+
+            count->last = record->pretty;
+            count->lastTime = record->timestamp;
+        }
+
+        // bit 0 of the flags: pre-fail attribute
+        if ((record->flags & 0x1) && record->threshold > 0 && record->value >= 0 && record->value <= record->threshold)
+            belowThreshold = true;
+    }
+
+    // a growth seen in less than one day is counted as one day's growth
+    auto perDay = [] (const Count &count) {
+        if (count.first < 0 || count.last <= count.first)
+            return 0.0;
+
+        const double days = qMax(1.0, (count.lastTime - count.firstTime) / (24.0 * 60 * 60 * 1000));
+
+        return (count.last - count.first) / days;
+    };
+
+    assessment.temperatureExcursions = temperature.seen ? temperature.count : airflowTemperature.count;
+    assessment.reallocatedSectorsPerDay = perDay(reallocated);
+    assessment.pendingSectorsPerDay = perDay(pending);
+    assessment.uncorrectableSectorsPerDay = perDay(uncorrectable);
+
+    auto check = [&assessment] (double value, double threshold, DSmartAssessment::Reason reason) {
+        if (threshold <= 0)
+            return;
+
+        const double ratio = value / threshold;
+
+        assessment.score = qMax(assessment.score, ratio);
+
+        if (ratio >= 1)
+            assessment.reasons |= reason;
+    };
+
+    check(assessment.reallocatedSectorsPerDay, thresholds.reallocatedSectorsPerDay, DSmartAssessment::ReallocatedSectors);
+    check(assessment.pendingSectorsPerDay, thresholds.pendingSectorsPerDay, DSmartAssessment::PendingSectors);
+    check(assessment.uncorrectableSectorsPerDay, thresholds.uncorrectableSectorsPerDay, DSmartAssessment::UncorrectableSectors);
+    check(assessment.temperatureExcursions, thresholds.temperatureExcursions, DSmartAssessment::Temperature);
+
+    if (belowThreshold) {
+        assessment.score = qMax(assessment.score, 1.0);
+        assessment.reasons |= DSmartAssessment::BelowThreshold;
+    }
+
+    return assessment;
+}
+
+QList<DSmartAssessment> DSmartHistory::degradingDrives() const
+{
+    QList<DSmartAssessment> list;
+
+    for (const QString &drive : drives()) {
+        const DSmartAssessment &assessment = assess(drive);
+
+        if (assessment.isDegrading())
+            list << assessment;
+    }
+
+    // the worst first
+    std::sort(list.begin(), list.end(), [] (const DSmartAssessment &a1, const DSmartAssessment &a2) {
+        return a1.score > a2.score;
+    });
+
+    return list;
+}
+
+void DSmartHistory::collect(const DDriveInfo &drive, const QDBusConnection &connection)
+{
+    const QString &key = driveKey(drive);
+
+    if (key.isEmpty() || !drive.hasAta()) {
+        Q_EMIT collected(key, QDBusError(QDBusError::NotSupported, QStringLiteral("%1 has no SMART data").arg(drive.path())));
+        return;
+    }
+
+    QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, drive.path(), UDISKS2_SERVICE ".Drive.Ata", "SmartGetAttributes");
+    // SmartGetAttributes takes no options and answers from the data of the last
+    // SmartUpdate of udisks, the disk itself isn't asked
+    message << QVariantMap();
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(connection.asyncCall(message), this);
+
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, key] (QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+
+        QDBusPendingReply<QList<UDisks2::SmartAttribute>> reply = *w;
+
+        if (reply.isError()) {
+            Q_EMIT collected(key, reply.error());
+            return;
+        }
+
+        if (!append(key, reply.value())) {
+            Q_EMIT collected(key, QDBusError(QDBusError::Failed, errorString()));
+            return;
+        }
+
+        Q_EMIT collected(key, QDBusError());
+
+        const DSmartAssessment &assessment = assess(key);
+
+        if (assessment.isDegrading())
+            Q_EMIT degrading(assessment);
+    });
+}
+
+QString DSmartHistory::errorString() const
+{
+    Q_D(const DSmartHistory);
+
+    return d->errorString;
+}
@@ -0,0 +1,119 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DSMARTHISTORY_H
+#define DSMARTHISTORY_H
+
+#include "udisks2_dbus_common.h"
+
+#include <QDBusConnection>
+#include <QDBusError>
+#include <QObject>
+#include <QVector>
+
+// One SMART attribute of a drive at a time, see UDisks2::SmartAttribute
+struct DSmartRecord
+{
+    qint64 timestamp = 0; // msecs since epoch
+    quint8 id = 0;
+    quint16 flags = 0;
+    qint32 value = -1;
+    qint32 worst = -1;
+    qint32 threshold = -1;
+    qint64 pretty = 0;
+    qint32 prettyUnit = 0;
+};
+
+Q_DECLARE_METATYPE(DSmartRecord)
+
+// When a drive is considered as degrading, the rates are per day over window
+struct DSmartTrendThresholds
+{
+    qint64 window = 30LL * 24 * 60 * 60 * 1000; // msecs, ending at the last sample
+    double reallocatedSectorsPerDay = 1; // attribute 5
+    double pendingSectorsPerDay = 1; // attribute 197
+    double uncorrectableSectorsPerDay = 1; // attribute 198
+    double maxTemperature = 60; // celsius, attributes 194 and 190
+    int temperatureExcursions = 3; // times maxTemperature was exceeded in the window
+};
+
+Q_DECLARE_METATYPE(DSmartTrendThresholds)
+
+struct DSmartAssessment
+{
+    enum Reason {
+        NoReason = 0x0,
+        ReallocatedSectors = 0x1,
+        PendingSectors = 0x2,
+        UncorrectableSectors = 0x4,
+        Temperature = 0x8,
+        BelowThreshold = 0x10 // a pre-fail attribute reached the threshold of the vendor
+    };
+    Q_DECLARE_FLAGS(Reasons, Reason)
+
+    QString drive; // see DSmartHistory::driveKey()
+    qint64 from = 0;
+    qint64 to = 0;
+    int samples = 0;
+    double reallocatedSectorsPerDay = 0;
+    double pendingSectorsPerDay = 0;
+    double uncorrectableSectorsPerDay = 0;
+    double maxTemperature = 0; // celsius, 0 if unknown
+    int temperatureExcursions = 0;
+    // the highest ratio of a rate to its threshold, 1 or more when flagged
+    double score = 0;
+    Reasons reasons;
+
+    bool isDegrading() const { return reasons != NoReason; }
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(DSmartAssessment::Reasons)
+Q_DECLARE_METATYPE(DSmartAssessment)
+
+class DDriveInfo;
+class DSmartHistoryPrivate;
+class DSmartHistory : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(DSmartHistory)
+
+    Q_PROPERTY(QString directory READ directory CONSTANT)
+
+public:
+    // directory defaults to udisks2-qt5/smart-history in the generic data location
+    explicit DSmartHistory(const QString &directory = QString(), QObject *parent = nullptr);
+    ~DSmartHistory();
+
+    // the WWN if any, the serial otherwise, usable as a file name; empty if neither is known
+    static QString driveKey(const QString &wwn, const QString &serial);
+    static QString driveKey(const DDriveInfo &drive);
+
+    QString directory() const;
+    QStringList drives() const;
+
+    bool append(const QString &drive, const QList<UDisks2::SmartAttribute> &attributes, qint64 timestamp = 0);
+    // the records with from <= timestamp <= to, of every attribute if attributeId is -1, oldest first
+    QVector<DSmartRecord> records(const QString &drive, qint64 from, qint64 to, int attributeId = -1) const;
+    qint64 lastTimestamp(const QString &drive) const;
+
+    DSmartTrendThresholds thresholds() const;
+    void setThresholds(const DSmartTrendThresholds &thresholds);
+
+    DSmartAssessment assess(const QString &drive) const;
+    QList<DSmartAssessment> degradingDrives() const;
+
+    // SmartGetAttributes without waking up the drive, then append() and assess()
+    void collect(const DDriveInfo &drive, const QDBusConnection &connection = QDBusConnection::systemBus());
+
+    QString errorString() const;
+
+Q_SIGNALS:
+    void collected(const QString &drive, const QDBusError &error);
+    void degrading(const DSmartAssessment &assessment);
+
+private:
+    QScopedPointer<DSmartHistoryPrivate> d_ptr;
+};
+
+#endif // DSMARTHISTORY_H
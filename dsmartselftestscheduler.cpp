@@ -0,0 +1,605 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dsmartselftestscheduler.h"
+#include "udisks2_dbus_common.h"
+#include "private/dpropertiesdispatcher_p.h"
+
+#include <QDBusMetaType>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <QRegularExpression>
+#include <QTimer>
+
+#include <sys/sysmacros.h>
+
+#define DRIVE_ATA_INTERFACE UDISKS2_SERVICE ".Drive.Ata"
+
+typedef QMap<QDBusObjectPath, QMap<QString, QVariantMap>> ManagedObjects;
+
+class DSmartSelftestSchedulerPrivate
+{
+public:
+    struct Test
+    {
+        QString drive;
+        DSmartSelftestScheduler::TestType type;
+        QVariantMap options;
+        QString controller;
+        bool started = false; // SmartSelftestStart returned
+        bool inProgress = false; // SmartSelftestStatus was "inprogress"
+        bool abortRequested = false;
+        bool aborting = false;
+    };
+
+    DSmartSelftestSchedulerPrivate(DSmartSelftestScheduler *qq, const QDBusConnection &connection);
+
+    void resolveControllers();
+    QString controllerOf(quint64 deviceNumber) const;
+    void schedule();
+    void start(Test test);
+    void sendAbort(const QString &drive);
+    void fetchStatus(const QString &drive);
+    void updateStatus(const QString &drive, const QVariantMap &properties, bool current);
+    void finish(const QString &drive, const QString &status, const QDBusError &error);
+    void updateRunning();
+    void checkIdle();
+
+    QDBusConnection connection;
+    int maxConcurrentTests = 0;
+    int maxTestsPerController = 1;
+    int staggerInterval = 30 * 1000;
+    int updateInterval = 60 * 1000;
+    QList<Test> pending; // in the order of enqueue()
+    QMap<QString, Test> running; // by drive
+    QHash<QString, QString> controllers; // drive -> controller
+    QStringList unresolved;
+    bool resolving = false;
+    // enqueue() was called since the last allFinished()
+    bool busy = false;
+    QElapsedTimer clock;
+    QHash<QString, qint64> lastStart; // controller -> clock
+    QTimer staggerTimer;
+    QTimer updateTimer;
+
+    DSmartSelftestScheduler *q_ptr;
+
+    Q_DECLARE_PUBLIC(DSmartSelftestScheduler)
+};
+
+DSmartSelftestSchedulerPrivate::DSmartSelftestSchedulerPrivate(DSmartSelftestScheduler *qq, const QDBusConnection &connection)
+    : connection(connection)
+    , q_ptr(qq)
+{
+    clock.start();
+    staggerTimer.setSingleShot(true);
+}
+
+// The controller of a drive is found from the sysfs path of its whole disk block device,
+// the drives don't tell where they are plugged in.
+void DSmartSelftestSchedulerPrivate::resolveControllers()
+{
+    Q_Q(DSmartSelftestScheduler);
+
+    if (resolving || unresolved.isEmpty())
+        return;
+
+    resolving = true;
+
+    QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, "/org/freedesktop/UDisks2", "org.freedesktop.DBus.ObjectManager", "GetManagedObjects");
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(connection.asyncCall(message), q);
+    const QStringList drives = unresolved;
+
+    unresolved.clear();
+
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, q, [this, drives] (QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+        resolving = false;
+
+        QDBusPendingReply<ManagedObjects> reply = *w;
+        const ManagedObjects &objects = reply.value();
+
+        for (auto i = objects.constBegin(); i != objects.constEnd(); ++i) {
+            if (i.value().contains(UDISKS2_SERVICE ".Partition"))
+                continue;
+
+            const QVariantMap &block = i.value().value(UDISKS2_SERVICE ".Block");
+            const QString &drive = UDisks2::demarshal(block.value("Drive")).toString();
+
+            if (!drives.contains(drive) || controllers.contains(drive))
+                continue;
+
+            const QString &controller = controllerOf(block.value("DeviceNumber").toULongLong());
+
+            if (!controller.isEmpty())
+                controllers.insert(drive, controller);
+        }
+
+        // not found, the drive is its own controller so that its tests still run
+        for (const QString &drive : drives) {
+            if (!controllers.contains(drive))
+                controllers.insert(drive, drive);
+        }
+
+        resolveControllers();
+        schedule();
+    });
+}
+
+// e.g. /sys/devices/pci0000:00/0000:00:17.0/ata3/host2/target2:0:0/2:0:0:0/block/sdc
+// or /sys/devices/pci0000:00/0000:00:14.0/usb2/2-1/2-1:1.0/host6/.../block/sdd,
+// the last PCI device of the path is the HBA, the SATA, NVMe or USB host controller
+QString DSmartSelftestSchedulerPrivate::controllerOf(quint64 deviceNumber) const
+{
+    static const QRegularExpression pciAddress(QStringLiteral("^[0-9a-f]{4,}:[0-9a-f]{2}:[0-9a-f]{2}\\.[0-7]$"));
+
+    if (deviceNumber == 0)
+        return QString();
+
+    const QString &device = QFileInfo(QStringLiteral("/sys/dev/block/%1:%2").arg(major(deviceNumber)).arg(minor(deviceNumber))).canonicalFilePath();
+    const QStringList &parts = device.split(QLatin1Char('/'));
+
+    for (int i = parts.count() - 1; i >= 0; --i) {
+        if (pciAddress.match(parts.at(i)).hasMatch())
+            return parts.mid(0, i + 1).join(QLatin1Char('/'));
+    }
+
+    return QString();
+}
+
+void DSmartSelftestSchedulerPrivate::schedule()
+{
+    if (pending.isEmpty()) {
+        checkIdle();
+        return;
+    }
+
+    QHash<QString, int> perController;
+
+    for (const Test &test : running) {
+        ++perController[test.controller];
+    }
+
+    const qint64 now = clock.elapsed();
+    qint64 wait = -1;
+
+    for (auto i = pending.begin(); i != pending.end();) {
+        if (maxConcurrentTests > 0 && running.count() >= maxConcurrentTests)
+            break;
+
+        auto controller = controllers.constFind(i->drive);
+
+        // not resolved yet, or another test of the same drive is running
+        if (controller == controllers.constEnd() || running.contains(i->drive)) {
+            ++i;
+            continue;
+        }
+
+        if (maxTestsPerController > 0 && perController.value(*controller) >= maxTestsPerController) {
+            ++i;
+            continue;
+        }
+
+        // the tests of a controller start one after another, not in a burst
+        auto last = lastStart.constFind(*controller);
+
+        if (last != lastStart.constEnd() && now - *last < staggerInterval) {
+            const qint64 remaining = staggerInterval - (now - *last);
+
+            wait = wait < 0 ? remaining : qMin(wait, remaining);
+            ++i;
+            continue;
+        }
+
+        Test test = *i;
+
+        i = pending.erase(i);
+        test.controller = *controller;
+        ++perController[test.controller];
+        lastStart[test.controller] = now;
+        start(test);
+    }
+
+    if (wait >= 0)
+        staggerTimer.start(static_cast<int>(wait));
+}
+
+void DSmartSelftestSchedulerPrivate::start(Test test)
+{
+    Q_Q(DSmartSelftestScheduler);
+
+    static const char *types[] = {"short", "extended", "conveyance"};
+
+    QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, test.drive, DRIVE_ATA_INTERFACE, "SmartSelftestStart");
+
+    message << QString::fromLatin1(types[test.type]) << test.options;
+
+    const QString drive = test.drive;
+
+    running.insert(drive, test);
+
+    // the status and the progress are followed through PropertiesChanged of Drive.Ata
+    DPropertiesDispatcher::instance(connection)->subscribe(drive, q, [this, drive] (const QString &interface, const QVariantMap &changed_properties,
+                                                                                    const QStringList &invalidated_properties) {
+        Q_UNUSED(invalidated_properties)
+
+        if (interface == QStringLiteral(DRIVE_ATA_INTERFACE))
+            updateStatus(drive, changed_properties, false);
+    });
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(connection.asyncCall(message), q);
+
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, q, [this, drive] (QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+
+        auto test = running.find(drive);
+
+        if (test == running.end())
+            return;
+
+        if (w->isError()) {
+            finish(drive, QString(), w->error());
+            return;
+        }
+
+        test->started = true;
+
+        if (test->abortRequested) {
+            sendAbort(drive);
+            return;
+        }
+
+        fetchStatus(drive);
+
+        if (!updateTimer.isActive())
+            updateTimer.start(updateInterval);
+    });
+
+    Q_EMIT q->started(test.drive, test.type);
+}
+
+void DSmartSelftestSchedulerPrivate::sendAbort(const QString &drive)
+{
+    Q_Q(DSmartSelftestScheduler);
+
+    auto test = running.find(drive);
+
+    if (test == running.end() || test->aborting)
+        return;
+
+    test->aborting = true;
+
+    QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, drive, DRIVE_ATA_INTERFACE, "SmartSelftestAbort");
+
+    message << QVariantMap();
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(connection.asyncCall(message), q);
+
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, q, [this, drive] (QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+
+        auto test = running.find(drive);
+
+        if (test == running.end())
+            return;
+
+        // the test goes on in the drive, keep following it until it ends by itself
+        if (w->isError()) {
+            test->aborting = false;
+            test->abortRequested = false;
+            return;
+        }
+
+        finish(drive, QStringLiteral("aborted"), QDBusError());
+    });
+}
+
+void DSmartSelftestSchedulerPrivate::fetchStatus(const QString &drive)
+{
+    Q_Q(DSmartSelftestScheduler);
+
+    QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, drive, "org.freedesktop.DBus.Properties", "GetAll");
+
+    message << QStringLiteral(DRIVE_ATA_INTERFACE);
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(connection.asyncCall(message), q);
+
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, q, [this, drive] (QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+
+        QDBusPendingReply<QVariantMap> reply = *w;
+
+        if (!reply.isError())
+            updateStatus(drive, reply.value(), true);
+    });
+}
+
+// current is true when properties are all the properties read after the test was started:
+// then a status other than "inprogress" means that the test is already over.
+// Otherwise that status may be the one of the previous test, until "inprogress" was seen.
+void DSmartSelftestSchedulerPrivate::updateStatus(const QString &drive, const QVariantMap &properties, bool current)
+{
+    Q_Q(DSmartSelftestScheduler);
+
+    auto test = running.find(drive);
+
+    if (test == running.end() || test->aborting)
+        return;
+
+    auto remaining = properties.constFind("SmartSelftestPercentRemaining");
+
+    if (remaining != properties.constEnd() && remaining->toInt() >= 0)
+        Q_EMIT q->progressChanged(drive, 1.0 - qBound(0, remaining->toInt(), 100) / 100.0);
+
+    auto status = properties.constFind("SmartSelftestStatus");
+
+    if (status == properties.constEnd())
+        return;
+
+    const QString &value = status->toString();
+
+    if (value == QLatin1String("inprogress")) {
+        test->inProgress = true;
+    } else if (test->started && (test->inProgress || current)) {
+        finish(drive, value, QDBusError());
+    }
+}
+
+void DSmartSelftestSchedulerPrivate::finish(const QString &drive, const QString &status, const QDBusError &error)
+{
+    Q_Q(DSmartSelftestScheduler);
+
+    const Test &test = running.take(drive);
+
+    DPropertiesDispatcher::instance(connection)->unsubscribe(drive, q);
+
+    if (running.isEmpty())
+        updateTimer.stop();
+
+    Q_EMIT q->finished(drive, test.type, status, error);
+
+    schedule();
+}
+
+// udisksd reads the SMART data of a drive every 10 minutes, ask for it more often
+// while a test runs; the new values come back by PropertiesChanged
+void DSmartSelftestSchedulerPrivate::updateRunning()
+{
+    for (const Test &test : running) {
+        if (!test.started || test.aborting)
+            continue;
+
+        QDBusMessage message = QDBusMessage::createMethodCall(UDISKS2_SERVICE, test.drive, DRIVE_ATA_INTERFACE, "SmartUpdate");
+
+        message << QVariantMap();
+        connection.asyncCall(message);
+    }
+}
+
+void DSmartSelftestSchedulerPrivate::checkIdle()
+{
+    Q_Q(DSmartSelftestScheduler);
+
+    // only once the tests enqueued are done, not for a scheduler that had nothing to do
+    if (busy && !resolving && running.isEmpty() && pending.isEmpty()) {
+        busy = false;
+        Q_EMIT q->allFinished();
+    }
+}
+
+/*!
+ * \class DSmartSelftestScheduler
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief Runs the SMART self-tests of many drives, a few at a time.
+ *
+ * A self-test reads the whole surface of the disk, running all of them at once
+ * saturates the controller the disks share. The tests are started in the order
+ * of enqueue(), with at most maxConcurrentTests() in total and at most
+ * maxTestsPerController() on the same host controller. The tests of a controller
+ * are also started staggerInterval() apart.
+ *
+ * The controller of a drive is the PCI device found in the sysfs path of its
+ * block device, a drive not found there is its own controller.
+ */
+
+DSmartSelftestScheduler::DSmartSelftestScheduler(QObject *parent)
+    : DSmartSelftestScheduler(QDBusConnection::systemBus(), parent)
+{
+
+}
+
+DSmartSelftestScheduler::DSmartSelftestScheduler(const QDBusConnection &connection, QObject *parent)
+    : QObject(parent)
+    , d_ptr(new DSmartSelftestSchedulerPrivate(this, connection))
+{
+    Q_D(DSmartSelftestScheduler);
+
+    qDBusRegisterMetaType<ManagedObjects>();
+
+    connect(&d->staggerTimer, &QTimer::timeout, this, [d] {
+        d->schedule();
+    });
+    connect(&d->updateTimer, &QTimer::timeout, this, [d] {
+        d->updateRunning();
+    });
+}
+
+DSmartSelftestScheduler::~DSmartSelftestScheduler()
+{
+
+}
+
+int DSmartSelftestScheduler::maxConcurrentTests() const
+{
+    Q_D(const DSmartSelftestScheduler);
+
+    return d->maxConcurrentTests;
+}
+
+int DSmartSelftestScheduler::maxTestsPerController() const
+{
+    Q_D(const DSmartSelftestScheduler);
+
+    return d->maxTestsPerController;
+}
+
+int DSmartSelftestScheduler::staggerInterval() const
+{
+    Q_D(const DSmartSelftestScheduler);
+
+    return d->staggerInterval;
+}
+
+int DSmartSelftestScheduler::updateInterval() const
+{
+    Q_D(const DSmartSelftestScheduler);
+
+    return d->updateInterval;
+}
+
+bool DSmartSelftestScheduler::isIdle() const
+{
+    Q_D(const DSmartSelftestScheduler);
+
+    return !d->resolving && d->running.isEmpty() && d->pending.isEmpty();
+}
+
+QStringList DSmartSelftestScheduler::runningTests() const
+{
+    Q_D(const DSmartSelftestScheduler);
+
+    return d->running.keys();
+}
+
+QString DSmartSelftestScheduler::controller(const QString &drivePath) const
+{
+    Q_D(const DSmartSelftestScheduler);
+
+    return d->controllers.value(drivePath);
+}
+
+void DSmartSelftestScheduler::setMaxConcurrentTests(int count)
+{
+    Q_D(DSmartSelftestScheduler);
+
+    d->maxConcurrentTests = qMax(0, count);
+    d->schedule();
+}
+
+void DSmartSelftestScheduler::setMaxTestsPerController(int count)
+{
+    Q_D(DSmartSelftestScheduler);
+
+    d->maxTestsPerController = qMax(0, count);
+    d->schedule();
+}
+
+void DSmartSelftestScheduler::setStaggerInterval(int msec)
+{
+    Q_D(DSmartSelftestScheduler);
+
+    d->staggerInterval = qMax(0, msec);
+    d->schedule();
+}
+
+void DSmartSelftestScheduler::setUpdateInterval(int msec)
+{
+    Q_D(DSmartSelftestScheduler);
+
+    d->updateInterval = qMax(1000, msec);
+
+    if (d->updateTimer.isActive())
+        d->updateTimer.start(d->updateInterval);
+}
+
+void DSmartSelftestScheduler::enqueue(const QString &drivePath, TestType type, const QVariantMap &options)
+{
+    Q_D(DSmartSelftestScheduler);
+
+    DSmartSelftestSchedulerPrivate::Test test;
+
+    test.drive = drivePath;
+    test.type = type;
+    test.options = options;
+    d->pending.append(test);
+    d->busy = true;
+
+    if (!d->controllers.contains(drivePath) && !d->unresolved.contains(drivePath)) {
+        d->unresolved.append(drivePath);
+        d->resolveControllers();
+    }
+
+    d->schedule();
+}
+
+/*!
+ * \brief Aborts the test of drivePath if it runs, or drops its pending tests.
+ *
+ * finished() is emitted with the "aborted" status for each of them.
+ */
+void DSmartSelftestScheduler::abort(const QString &drivePath)
+{
+    Q_D(DSmartSelftestScheduler);
+
+    bool dropped = false;
+
+    for (auto i = d->pending.begin(); i != d->pending.end();) {
+        if (i->drive != drivePath) {
+            ++i;
+            continue;
+        }
+
+        const TestType type = i->type;
+
+        i = d->pending.erase(i);
+        dropped = true;
+        Q_EMIT finished(drivePath, type, QStringLiteral("aborted"), QDBusError());
+    }
+
+    auto test = d->running.find(drivePath);
+
+    if (test == d->running.end()) {
+        if (dropped)
+            d->checkIdle();
+
+        return;
+    }
+
+    // SmartSelftestStart has not returned yet, abort once it has
+    if (!test->started) {
+        test->abortRequested = true;
+        return;
+    }
+
+    d->sendAbort(drivePath);
+}
+
+void DSmartSelftestScheduler::abortAll()
+{
+    Q_D(DSmartSelftestScheduler);
+
+    QStringList drives = d->running.keys();
+
+    for (const DSmartSelftestSchedulerPrivate::Test &test : d->pending) {
+        if (!drives.contains(test.drive))
+            drives << test.drive;
+    }
+
+    for (const QString &drive : drives) {
+        abort(drive);
+    }
+}
+
+void DSmartSelftestScheduler::clear()
+{
+    Q_D(DSmartSelftestScheduler);
+
+    d->pending.clear();
+    // nothing may be running, then the queue is done
+    d->checkIdle();
+}
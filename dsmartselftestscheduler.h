@@ -0,0 +1,76 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DSMARTSELFTESTSCHEDULER_H
+#define DSMARTSELFTESTSCHEDULER_H
+
+#include <QObject>
+#include <QVariantMap>
+#include <QDBusConnection>
+#include <QDBusError>
+
+class DSmartSelftestSchedulerPrivate;
+class DSmartSelftestScheduler : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(DSmartSelftestScheduler)
+
+    Q_PROPERTY(int maxConcurrentTests READ maxConcurrentTests WRITE setMaxConcurrentTests)
+    Q_PROPERTY(int maxTestsPerController READ maxTestsPerController WRITE setMaxTestsPerController)
+    Q_PROPERTY(int staggerInterval READ staggerInterval WRITE setStaggerInterval)
+    Q_PROPERTY(int updateInterval READ updateInterval WRITE setUpdateInterval)
+    Q_PROPERTY(bool idle READ isIdle)
+
+public:
+    enum TestType {
+        Short,
+        Extended,
+        Conveyance
+    };
+
+    Q_ENUM(TestType)
+
+    explicit DSmartSelftestScheduler(QObject *parent = nullptr);
+    explicit DSmartSelftestScheduler(const QDBusConnection &connection, QObject *parent = nullptr);
+    // the running tests go on in the drives, they are not aborted
+    ~DSmartSelftestScheduler();
+
+    // 0 表示不限制
+    int maxConcurrentTests() const;
+    int maxTestsPerController() const;
+    // msecs between two tests started on the same controller
+    int staggerInterval() const;
+    // msecs between two SmartUpdate of a drive under test, udisksd refreshes them every 10 minutes only
+    int updateInterval() const;
+    bool isIdle() const;
+
+    QStringList runningTests() const;
+    // the sysfs path of the host controller (PCI device) of drivePath, empty if not resolved yet
+    QString controller(const QString &drivePath) const;
+
+public Q_SLOTS:
+    void setMaxConcurrentTests(int count);
+    void setMaxTestsPerController(int count);
+    void setStaggerInterval(int msec);
+    void setUpdateInterval(int msec);
+
+    void enqueue(const QString &drivePath, TestType type, const QVariantMap &options = {});
+    void abort(const QString &drivePath);
+    void abortAll();
+    // drop the tests not started yet
+    void clear();
+
+Q_SIGNALS:
+    void started(const QString &drivePath, TestType type);
+    // progress is 0..1, from SmartSelftestPercentRemaining
+    void progressChanged(const QString &drivePath, double progress);
+    // status is the final SmartSelftestStatus: "success", "aborted", "fatal", "error_read"...
+    void finished(const QString &drivePath, TestType type, const QString &status, const QDBusError &error);
+    void allFinished();
+
+private:
+    QScopedPointer<DSmartSelftestSchedulerPrivate> d_ptr;
+};
+
+#endif // DSMARTSELFTESTSCHEDULER_H
@@ -0,0 +1,348 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dsysfsblockreader.h"
+#include "ddiskmanager.h"
+#include "dblockdeviceinfo.h"
+#include "udisks2_dbus_common.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QPointer>
+
+#include <sys/sysmacros.h>
+
+class DSysfsBlockReaderPrivate
+{
+public:
+    struct Device
+    {
+        QString path; // empty if the device doesn't exist
+        bool partition = false;
+        QHash<QString, QByteArray> attributes;
+    };
+
+    // nullptr if the device doesn't exist, which isn't cached: it may appear later
+    Device *device(qulonglong deviceNumber) const;
+    // disk: an attribute of the whole disk, read from the parent directory for a partition
+    QByteArray attribute(qulonglong deviceNumber, const QString &name, bool disk) const;
+    void invalidate(qulonglong deviceNumber);
+
+    void onBlockDeviceAdded(const QString &path);
+    void onBlockDeviceRemoved(const QString &path);
+    void onPropertiesChanged(const QString &path, const QString &interface);
+
+    QString root;
+    mutable QMutex lock;
+    mutable QHash<qulonglong, Device> devices;
+
+    QPointer<DDiskManager> manager;
+    QList<QMetaObject::Connection> connections;
+    // the device number of the block devices of manager, it is unknown once they are removed
+    QHash<QString, qulonglong> deviceNumbers;
+};
+
+// must be called with lock held
+DSysfsBlockReaderPrivate::Device *DSysfsBlockReaderPrivate::device(qulonglong deviceNumber) const
+{
+    auto it = devices.find(deviceNumber);
+
+    if (it != devices.end())
+        return &*it;
+
+    const QString &link = QStringLiteral("%1/dev/block/%2:%3").arg(root).arg(major(deviceNumber)).arg(minor(deviceNumber));
+    const QFileInfo info(link);
+
+    if (!info.exists())
+        return nullptr;
+
+    Device &device = devices[deviceNumber];
+
+    device.path = info.canonicalFilePath();
+    device.partition = QFileInfo::exists(device.path + "/partition");
+
+    return &device;
+}
+
+QByteArray DSysfsBlockReaderPrivate::attribute(qulonglong deviceNumber, const QString &name, bool disk) const
+{
+    // these change while the device is present, by a resize or BLKROSET
+    static const QStringList uncached {"size", "ro"};
+
+    QMutexLocker locker(&lock);
+    Device *d = device(deviceNumber);
+
+    if (!d)
+        return QByteArray();
+
+    auto it = d->attributes.constFind(name);
+
+    if (it != d->attributes.constEnd())
+        return *it;
+
+    // the partitions have no queue directory, it is in the directory of the disk
+    const QString &dir = disk && d->partition ? d->path + "/.." : d->path;
+    QFile file(dir + "/" + name);
+    QByteArray value;
+
+    if (file.open(QIODevice::ReadOnly)) {
+        value = file.readAll().trimmed();
+    }
+
+    if (!uncached.contains(name))
+        d->attributes.insert(name, value);
+
+    return value;
+}
+
+void DSysfsBlockReaderPrivate::invalidate(qulonglong deviceNumber)
+{
+    QMutexLocker locker(&lock);
+
+    if (deviceNumber == 0) {
+        devices.clear();
+    } else {
+        devices.remove(deviceNumber);
+    }
+}
+
+void DSysfsBlockReaderPrivate::onBlockDeviceAdded(const QString &path)
+{
+    const qulonglong deviceNumber = manager->blockDeviceInfo(path).deviceNumber();
+
+    deviceNumbers.insert(path, deviceNumber);
+    // a device of the same number may have been there before
+    invalidate(deviceNumber);
+}
+
+void DSysfsBlockReaderPrivate::onBlockDeviceRemoved(const QString &path)
+{
+    const qulonglong deviceNumber = deviceNumbers.take(path);
+
+    if (deviceNumber > 0)
+        invalidate(deviceNumber);
+}
+
+void DSysfsBlockReaderPrivate::onPropertiesChanged(const QString &path, const QString &interface)
+{
+    if (interface != UDISKS2_SERVICE ".Block")
+        return;
+
+    const qulonglong deviceNumber = manager->blockDeviceInfo(path).deviceNumber();
+    const qulonglong oldDeviceNumber = deviceNumbers.value(path);
+
+    deviceNumbers.insert(path, deviceNumber);
+    invalidate(deviceNumber);
+
+    if (oldDeviceNumber != deviceNumber && oldDeviceNumber > 0)
+        invalidate(oldDeviceNumber);
+}
+
+/*!
+ * \class DSysfsBlockReader
+ * \inmodule dde-file-manager-lib
+ *
+ * \brief Reads the attributes of a block device from /sys/dev/block/MAJ:MIN.
+ *
+ * Some attributes, like the queue topology, are not exposed by UDisks2 and the
+ * others need a D-Bus roundtrip each. The values read are cached until
+ * invalidate(), which suits attributes that don't change while the device is
+ * present; "size" and "ro" are read each time. With setDiskManager() the
+ * cache of a device is dropped when it is removed or its Block properties
+ * change.
+ *
+ * \sa DBlockDevice::deviceNumber()
+ */
+
+DSysfsBlockReader::DSysfsBlockReader(const QString &sysfsRoot)
+    : d_ptr(new DSysfsBlockReaderPrivate)
+{
+    d_ptr->root = sysfsRoot;
+}
+
+DSysfsBlockReader::~DSysfsBlockReader()
+{
+    setDiskManager(nullptr);
+}
+
+DSysfsBlockReader *DSysfsBlockReader::instance()
+{
+    static DSysfsBlockReader reader;
+
+    return &reader;
+}
+
+QString DSysfsBlockReader::sysfsRoot() const
+{
+    Q_D(const DSysfsBlockReader);
+
+    QMutexLocker locker(&d->lock);
+
+    return d->root;
+}
+
+void DSysfsBlockReader::setSysfsRoot(const QString &sysfsRoot)
+{
+    Q_D(DSysfsBlockReader);
+
+    QMutexLocker locker(&d->lock);
+
+    d->root = sysfsRoot;
+    d->devices.clear();
+}
+
+QString DSysfsBlockReader::devicePath(qulonglong deviceNumber) const
+{
+    Q_D(const DSysfsBlockReader);
+
+    QMutexLocker locker(&d->lock);
+    const DSysfsBlockReaderPrivate::Device *device = d->device(deviceNumber);
+
+    return device ? device->path : QString();
+}
+
+bool DSysfsBlockReader::isPartition(qulonglong deviceNumber) const
+{
+    Q_D(const DSysfsBlockReader);
+
+    QMutexLocker locker(&d->lock);
+    const DSysfsBlockReaderPrivate::Device *device = d->device(deviceNumber);
+
+    return device && device->partition;
+}
+
+qulonglong DSysfsBlockReader::size(qulonglong deviceNumber) const
+{
+    Q_D(const DSysfsBlockReader);
+
+    // always in 512 bytes sectors, whatever the block size of the device
+    return d->attribute(deviceNumber, "size", false).toULongLong() * 512;
+}
+
+bool DSysfsBlockReader::readOnly(qulonglong deviceNumber) const
+{
+    Q_D(const DSysfsBlockReader);
+
+    return d->attribute(deviceNumber, "ro", false) == "1";
+}
+
+bool DSysfsBlockReader::removable(qulonglong deviceNumber) const
+{
+    Q_D(const DSysfsBlockReader);
+
+    return d->attribute(deviceNumber, "removable", true) == "1";
+}
+
+bool DSysfsBlockReader::rotational(qulonglong deviceNumber) const
+{
+    Q_D(const DSysfsBlockReader);
+
+    return d->attribute(deviceNumber, "queue/rotational", true) == "1";
+}
+
+uint DSysfsBlockReader::logicalBlockSize(qulonglong deviceNumber) const
+{
+    Q_D(const DSysfsBlockReader);
+
+    return d->attribute(deviceNumber, "queue/logical_block_size", true).toUInt();
+}
+
+uint DSysfsBlockReader::physicalBlockSize(qulonglong deviceNumber) const
+{
+    Q_D(const DSysfsBlockReader);
+
+    return d->attribute(deviceNumber, "queue/physical_block_size", true).toUInt();
+}
+
+uint DSysfsBlockReader::minimumIOSize(qulonglong deviceNumber) const
+{
+    Q_D(const DSysfsBlockReader);
+
+    return d->attribute(deviceNumber, "queue/minimum_io_size", true).toUInt();
+}
+
+uint DSysfsBlockReader::optimalIOSize(qulonglong deviceNumber) const
+{
+    Q_D(const DSysfsBlockReader);
+
+    return d->attribute(deviceNumber, "queue/optimal_io_size", true).toUInt();
+}
+
+uint DSysfsBlockReader::discardGranularity(qulonglong deviceNumber) const
+{
+    Q_D(const DSysfsBlockReader);
+
+    return d->attribute(deviceNumber, "queue/discard_granularity", true).toUInt();
+}
+
+qulonglong DSysfsBlockReader::discardMaxBytes(qulonglong deviceNumber) const
+{
+    Q_D(const DSysfsBlockReader);
+
+    return d->attribute(deviceNumber, "queue/discard_max_bytes", true).toULongLong();
+}
+
+QString DSysfsBlockReader::scheduler(qulonglong deviceNumber) const
+{
+    Q_D(const DSysfsBlockReader);
+
+    // like "mq-deadline [bfq] none"
+    const QByteArray &schedulers = d->attribute(deviceNumber, "queue/scheduler", true);
+    const int begin = schedulers.indexOf('[');
+    const int end = schedulers.indexOf(']', begin);
+
+    if (begin < 0 || end < 0)
+        return QString::fromLatin1(schedulers);
+
+    return QString::fromLatin1(schedulers.mid(begin + 1, end - begin - 1));
+}
+
+QByteArray DSysfsBlockReader::attribute(qulonglong deviceNumber, const QString &name) const
+{
+    Q_D(const DSysfsBlockReader);
+
+    return d->attribute(deviceNumber, name, name.startsWith("queue/"));
+}
+
+void DSysfsBlockReader::invalidate(qulonglong deviceNumber)
+{
+    Q_D(DSysfsBlockReader);
+
+    d->invalidate(deviceNumber);
+}
+
+void DSysfsBlockReader::setDiskManager(DDiskManager *manager)
+{
+    Q_D(DSysfsBlockReader);
+
+    if (d->manager == manager)
+        return;
+
+    for (const QMetaObject::Connection &connection : d->connections) {
+        QObject::disconnect(connection);
+    }
+
+    d->connections.clear();
+    d->deviceNumbers.clear();
+    d->manager = manager;
+
+    if (!manager)
+        return;
+
+    for (const DBlockDeviceInfo &info : manager->blockDeviceInfoList()) {
+        d->deviceNumbers.insert(info.path(), info.deviceNumber());
+    }
+
+    d->connections << QObject::connect(manager, &DDiskManager::blockDeviceAdded, manager, [d] (const QString &path) {
+        d->onBlockDeviceAdded(path);
+    });
+    d->connections << QObject::connect(manager, &DDiskManager::blockDeviceRemoved, manager, [d] (const QString &path) {
+        d->onBlockDeviceRemoved(path);
+    });
+    d->connections << QObject::connect(manager, &DDiskManager::propertiesChanged, manager, [d] (const QString &path, const QString &interface) {
+        d->onPropertiesChanged(path, interface);
+    });
+}
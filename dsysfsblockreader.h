@@ -0,0 +1,60 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DSYSFSBLOCKREADER_H
+#define DSYSFSBLOCKREADER_H
+
+#include <QScopedPointer>
+#include <QString>
+
+class DDiskManager;
+class DSysfsBlockReaderPrivate;
+class DSysfsBlockReader
+{
+    Q_DECLARE_PRIVATE(DSysfsBlockReader)
+
+public:
+    // sysfsRoot is "/sys" except for tests using a copy of the tree
+    explicit DSysfsBlockReader(const QString &sysfsRoot = QStringLiteral("/sys"));
+    ~DSysfsBlockReader();
+
+    static DSysfsBlockReader *instance();
+
+    QString sysfsRoot() const;
+    void setSysfsRoot(const QString &sysfsRoot);
+
+    // the directory of the device in sysfs, deviceNumber is DBlockDevice::deviceNumber()
+    QString devicePath(qulonglong deviceNumber) const;
+    bool isPartition(qulonglong deviceNumber) const;
+
+    qulonglong size(qulonglong deviceNumber) const; // bytes
+    bool readOnly(qulonglong deviceNumber) const;
+    bool removable(qulonglong deviceNumber) const;
+    // the queue attributes of a partition are those of its disk
+    bool rotational(qulonglong deviceNumber) const;
+    uint logicalBlockSize(qulonglong deviceNumber) const;
+    uint physicalBlockSize(qulonglong deviceNumber) const;
+    uint minimumIOSize(qulonglong deviceNumber) const;
+    uint optimalIOSize(qulonglong deviceNumber) const;
+    uint discardGranularity(qulonglong deviceNumber) const;
+    qulonglong discardMaxBytes(qulonglong deviceNumber) const;
+    QString scheduler(qulonglong deviceNumber) const; // the active one
+
+    // content of any attribute relative to the device directory, like "queue/nr_requests",
+    // cached except for "size" and "ro"
+    QByteArray attribute(qulonglong deviceNumber, const QString &name) const;
+
+    // drop the cached values of a device (after a resize or a media change), of all if 0
+    void invalidate(qulonglong deviceNumber = 0);
+    // invalidate() a device when manager sees it removed or its Block properties changed,
+    // manager must watch changes; nullptr to stop
+    void setDiskManager(DDiskManager *manager);
+
+private:
+    QScopedPointer<DSysfsBlockReaderPrivate> d_ptr;
+
+    Q_DISABLE_COPY(DSysfsBlockReader)
+};
+
+#endif // DSYSFSBLOCKREADER_H
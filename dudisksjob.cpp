@@ -100,12 +100,18 @@ void DUDisksJob::cancel(const QVariantMap &options)
 }
 
 DUDisksJob::DUDisksJob(QString path, QObject *parent)
+    : DUDisksJob(path, QDBusConnection::systemBus(), parent)
+{
+
+}
+
+DUDisksJob::DUDisksJob(QString path, const QDBusConnection &connection, QObject *parent)
     : QObject(parent)
     , d_ptr(new DUDisksJobPrivate(this))
 {
     Q_D(DUDisksJob);
-    d->dbusif = new OrgFreedesktopUDisks2JobInterface(UDISKS2_SERVICE, path, QDBusConnection::systemBus());
-    QDBusConnection::systemBus().connect(UDISKS2_SERVICE, d->dbusif->path(), "org.freedesktop.DBus.Properties",
+    d->dbusif = new OrgFreedesktopUDisks2JobInterface(UDISKS2_SERVICE, path, connection, this);
+    d->dbusif->connection().connect(UDISKS2_SERVICE, d->dbusif->path(), "org.freedesktop.DBus.Properties",
                    "PropertiesChanged", this, SLOT(onPropertiesChanged(const QString &, const QVariantMap &)));
     connect(d->dbusif, &OrgFreedesktopUDisks2JobInterface::Completed, this, &DUDisksJob::completed);
 }
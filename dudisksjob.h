@@ -6,6 +6,7 @@
 #define DUDISKSJOB_H
 
 #include <QObject>
+#include <QDBusConnection>
 
 class DUDisksJobPrivate;
 class DUDisksJob : public QObject
@@ -52,6 +53,7 @@ private:
     QScopedPointer<DUDisksJobPrivate> d_ptr;
 
     explicit DUDisksJob(QString path, QObject *parent = nullptr);
+    explicit DUDisksJob(QString path, const QDBusConnection &connection, QObject *parent = nullptr);
 
 private Q_SLOTS:
     void onPropertiesChanged(const QString &interface, const QVariantMap &changed_properties);
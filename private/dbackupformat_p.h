@@ -0,0 +1,117 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DBACKUPFORMAT_P_H
+#define DBACKUPFORMAT_P_H
+
+#include <QtEndian>
+#include <QtGlobal>
+
+#include <cstring>
+
+// The container written by DBackupWriter and read by DBackupImage, little endian:
+//
+//   header       HeaderSize bytes, rewritten with indexOffset once the image is complete
+//   chunks       the stored data of the chunks, in the order they were finished
+//   index        chunkCount entries of IndexEntrySize bytes, in the order of the chunks
+//   parent       the length (4 bytes, 0 for a full image) and the UTF-8 file name of
+//                the parent image
+//
+// Every chunk is an independent zstd frame, so any of them is read alone. Every
+// entry has the XXH64 of the data of its chunk: the index is the manifest an
+// incremental image is written against, and that image refers to its parent for
+// the chunks which didn't change.
+namespace DBackupFormat {
+const char Magic[4] = {'D', 'B', 'K', 'I'};
+const quint32 Version = 1;
+const size_t HeaderSize = 64;
+const size_t IndexEntrySize = 24;
+// the chunk size is a multiple of 4 KiB in this range, DBackupImage refuses the others
+const quint32 MinChunkSize = 64 * 1024;
+const quint32 MaxChunkSize = 64 * 1024 * 1024;
+const quint32 ChunkSizeAlignment = 4096;
+
+inline bool isValidChunkSize(quint32 chunkSize)
+{
+    return chunkSize >= MinChunkSize && chunkSize <= MaxChunkSize && chunkSize % ChunkSizeAlignment == 0;
+}
+
+enum ChunkType {
+    ZeroChunk = 0, // nothing stored
+    CompressedChunk = 1, // a zstd frame
+    StoredChunk = 2, // the data as is, it didn't compress
+    ParentChunk = 3 // unchanged since the parent image, nothing stored
+};
+
+struct Header
+{
+    quint32 version = Version;
+    quint32 chunkSize = 0;
+    quint64 size = 0; // of the source
+    quint64 chunkCount = 0;
+    quint64 indexOffset = 0; // 0 while the image is being written
+    qint64 created = 0; // msecs since epoch
+    quint64 id = 0; // random, never 0
+    quint64 parentId = 0; // 0 for a full image
+};
+
+struct IndexEntry
+{
+    quint64 offset = 0;
+    quint32 storedSize = 0;
+    quint8 type = ZeroChunk;
+    quint64 hash = 0; // XXH64
+};
+
+inline void encodeHeader(const Header &header, uchar *data)
+{
+    memset(data, 0, HeaderSize);
+    memcpy(data, Magic, sizeof(Magic));
+    qToLittleEndian<quint32>(header.version, data + 4);
+    qToLittleEndian<quint32>(header.chunkSize, data + 8);
+    qToLittleEndian<quint64>(header.size, data + 16);
+    qToLittleEndian<quint64>(header.chunkCount, data + 24);
+    qToLittleEndian<quint64>(header.indexOffset, data + 32);
+    qToLittleEndian<qint64>(header.created, data + 40);
+    qToLittleEndian<quint64>(header.id, data + 48);
+    qToLittleEndian<quint64>(header.parentId, data + 56);
+}
+
+// false if data isn't a header of this version
+inline bool decodeHeader(const uchar *data, Header *header)
+{
+    if (memcmp(data, Magic, sizeof(Magic)) != 0)
+        return false;
+
+    header->version = qFromLittleEndian<quint32>(data + 4);
+    header->chunkSize = qFromLittleEndian<quint32>(data + 8);
+    header->size = qFromLittleEndian<quint64>(data + 16);
+    header->chunkCount = qFromLittleEndian<quint64>(data + 24);
+    header->indexOffset = qFromLittleEndian<quint64>(data + 32);
+    header->created = qFromLittleEndian<qint64>(data + 40);
+    header->id = qFromLittleEndian<quint64>(data + 48);
+    header->parentId = qFromLittleEndian<quint64>(data + 56);
+
+    return header->version == Version;
+}
+
+inline void encodeIndexEntry(const IndexEntry &entry, uchar *data)
+{
+    memset(data, 0, IndexEntrySize);
+    qToLittleEndian<quint64>(entry.offset, data);
+    qToLittleEndian<quint32>(entry.storedSize, data + 8);
+    data[12] = entry.type;
+    qToLittleEndian<quint64>(entry.hash, data + 16);
+}
+
+inline void decodeIndexEntry(const uchar *data, IndexEntry *entry)
+{
+    entry->offset = qFromLittleEndian<quint64>(data);
+    entry->storedSize = qFromLittleEndian<quint32>(data + 8);
+    entry->type = data[12];
+    entry->hash = qFromLittleEndian<quint64>(data + 16);
+}
+}
+
+#endif // DBACKUPFORMAT_P_H
@@ -7,6 +7,8 @@
 
 #include "dblockdevice.h"
 
+#include <QHash>
+
 QT_BEGIN_NAMESPACE
 class QDBusObjectPath;
 QT_END_NAMESPACE
@@ -18,10 +20,37 @@ class DBlockDevicePrivate
 public:
     explicit DBlockDevicePrivate(DBlockDevice *qq);
 
+    // shared with DBlockDeviceInfo
+    static DBlockDevice::FSType toFSType(const QString &idType);
+    static DBlockDevice::PTType toPTType(const QString &type);
+
     OrgFreedesktopUDisks2BlockInterface *dbus;
     bool watchChanges = false;
     DBlockDevice *q_ptr;
     QDBusError err;
+    // property values kept up to date by PropertiesChanged while watchChanges is enabled
+    mutable QHash<DBlockDevice::PropertyId, QVariant> cache;
+
+    template<typename T, typename Fetch>
+    T cachedValue(DBlockDevice::PropertyId id, Fetch fetch) const
+    {
+        if (!watchChanges)
+            return fetch();
+
+        auto it = cache.constFind(id);
+
+        if (it != cache.constEnd())
+            return it->template value<T>();
+
+        const T value = fetch();
+        cache.insert(id, QVariant::fromValue(value));
+
+        return value;
+    }
+
+    void applyProperties(const QString &interface, const QVariantMap &changed_properties,
+                         const QStringList &invalidated_properties, QSet<DBlockDevice::PropertyId> *changed);
+    void dropInterface(const QString &interface);
 
     void _q_onInterfacesAdded(const QDBusObjectPath &object_path, const QMap<QString, QVariantMap> &interfaces_and_properties);
     void _q_onInterfacesRemoved(const QDBusObjectPath &object_path, const QStringList &interfaces);
@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DBLOCKDEVICEFILTER_P_H
+#define DBLOCKDEVICEFILTER_P_H
+
+#include "dblockdevicefilter.h"
+
+#include <QSharedData>
+#include <QList>
+
+class DBlockDeviceFilterData : public QSharedData
+{
+public:
+    enum Type {
+        All,
+        Property,
+        HasInterface,
+        Mounted,
+        Custom,
+        And,
+        Or,
+        Not
+    };
+
+    Type type = All;
+    QString interface; // full name, like "org.freedesktop.UDisks2.Block"
+    QString name;
+    QVariant value;
+    std::function<bool(const DBlockDeviceInfo &, const DDriveInfo &)> predicate;
+    QList<DBlockDeviceFilter> children;
+};
+
+#endif // DBLOCKDEVICEFILTER_P_H
@@ -0,0 +1,142 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DBLOCKIO_P_H
+#define DBLOCKIO_P_H
+
+#include <QtGlobal>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Helpers of the classes reading or writing whole devices by large blocks
+namespace DBlockIO {
+// the alignment of the buffers and of the offsets, enough for O_DIRECT
+const size_t Alignment = 4096;
+
+class AlignedBuffer
+{
+public:
+    explicit AlignedBuffer(size_t size)
+    {
+        if (size == 0 || posix_memalign(&data, Alignment, size) != 0)
+            data = nullptr;
+    }
+
+    ~AlignedBuffer()
+    {
+        free(data);
+    }
+
+    uchar *get() const
+    {
+        return static_cast<uchar *>(data);
+    }
+
+private:
+    Q_DISABLE_COPY(AlignedBuffer)
+
+    void *data = nullptr;
+};
+
+// A new descriptor with O_DIRECT on the file of fd, through /proc/self/fd: setting
+// O_DIRECT on a dup would change the open file description the caller shares.
+// -1 with errno set if the file can't be opened again, like a device of udisksd
+// the user has no access to; fd is then better read or written buffered.
+inline int openDirect(int fd)
+{
+    const int flags = ::fcntl(fd, F_GETFL);
+
+    if (flags < 0)
+        return -1;
+
+    char path[32];
+
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+
+    return ::open(path, (flags & O_ACCMODE) | O_DIRECT | O_CLOEXEC);
+}
+
+// the number of bytes read, less than length only at the end of the file; -1 with errno set
+inline ssize_t readUpTo(int fd, uchar *data, size_t length, quint64 offset)
+{
+    size_t done = 0;
+
+    while (done < length) {
+        const ssize_t n = ::pread(fd, data + done, length - done, static_cast<off_t>(offset + done));
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+
+            return -1;
+        }
+
+        if (n == 0)
+            break;
+
+        done += static_cast<size_t>(n);
+    }
+
+    return static_cast<ssize_t>(done);
+}
+
+// false with errno set, EIO at the end of the file
+inline bool readAll(int fd, uchar *data, size_t length, quint64 offset)
+{
+    while (length > 0) {
+        const ssize_t n = ::pread(fd, data, length, static_cast<off_t>(offset));
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        if (n == 0) {
+            errno = EIO;
+            return false;
+        }
+
+        data += n;
+        offset += static_cast<quint64>(n);
+        length -= static_cast<size_t>(n);
+    }
+
+    return true;
+}
+
+// false with errno set, ENOSPC at the end of a device
+inline bool writeAll(int fd, const uchar *data, size_t length, quint64 offset)
+{
+    while (length > 0) {
+        const ssize_t n = ::pwrite(fd, data, length, static_cast<off_t>(offset));
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        if (n == 0) {
+            errno = ENOSPC;
+            return false;
+        }
+
+        data += n;
+        offset += static_cast<quint64>(n);
+        length -= static_cast<size_t>(n);
+    }
+
+    return true;
+}
+}
+
+#endif // DBLOCKIO_P_H
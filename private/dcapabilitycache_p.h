@@ -0,0 +1,71 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DCAPABILITYCACHE_P_H
+#define DCAPABILITYCACHE_P_H
+
+#include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+class QDBusMessage;
+class QDBusServiceWatcher;
+QT_END_NAMESPACE
+
+// Process wide cache of the org.freedesktop.UDisks2.Manager queries (system bus).
+// Dropped when udisksd is restarted, its properties change or modules are enabled.
+class DCapabilityCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Kind {
+        Format,
+        Check,
+        Repair,
+        Resize,
+        KindCount
+    };
+
+    static DCapabilityCache *instance();
+
+    QStringList supportedFilesystems();
+    QStringList supportedEncryptionTypes();
+    bool can(Kind kind, const QString &type, QString *requiredUtil);
+
+    void prefetch();
+    void invalidate();
+
+private Q_SLOTS:
+    void onManagerPropertiesChanged();
+    void onServiceOwnerChanged(const QString &service, const QString &oldOwner, const QString &newOwner);
+
+private:
+    struct Capability
+    {
+        bool available;
+        bool error;
+        QString requiredUtil;
+    };
+
+    DCapabilityCache();
+
+    void doPrefetch();
+    void managerProperties(QStringList *filesystems, QStringList *encryptionTypes);
+    void storeProperties(quint64 generation, const QDBusMessage &reply, QStringList *filesystems, QStringList *encryptionTypes);
+    void store(quint64 generation, Kind kind, const QString &type, const QDBusMessage &reply, Capability *capability);
+
+    QMutex lock;
+    quint64 generation = 0;
+    bool prefetched = false;
+    bool hasProperties = false;
+    QStringList filesystems;
+    QStringList encryptionTypes;
+    QHash<QString, Capability> capabilities[KindCount];
+    QDBusServiceWatcher *serviceWatcher;
+};
+
+#endif // DCAPABILITYCACHE_P_H
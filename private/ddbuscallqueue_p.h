@@ -0,0 +1,82 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DDBUSCALLQUEUE_P_H
+#define DDBUSCALLQUEUE_P_H
+
+#include <QDBusPendingCall>
+#include <QDBusPendingCallWatcher>
+#include <QObject>
+#include <QPair>
+#include <QQueue>
+
+#include <functional>
+
+// Pipelines asynchronous D-Bus calls, keeping at most "limit" of them in flight.
+// The callbacks are invoked in the thread of the context object, and are dropped
+// together with the pending calls when the context is destroyed.
+class DDBusCallQueue
+{
+public:
+    typedef std::function<QDBusPendingCall()> Call;
+    typedef std::function<void(const QDBusPendingCall &)> Callback;
+
+    explicit DDBusCallQueue(QObject *context, int limit = 8)
+        : context(context)
+        , limit(limit)
+    {
+
+    }
+
+    int maxConcurrentCalls() const
+    {
+        return limit;
+    }
+
+    void setMaxConcurrentCalls(int count)
+    {
+        limit = qMax(1, count);
+        startNext();
+    }
+
+    int runningCalls() const
+    {
+        return running;
+    }
+
+    void enqueue(const Call &call, const Callback &callback)
+    {
+        pending.enqueue(qMakePair(call, callback));
+        startNext();
+    }
+
+private:
+    void startNext()
+    {
+        while (running < limit && !pending.isEmpty()) {
+            const QPair<Call, Callback> item = pending.dequeue();
+            QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(item.first(), context);
+            const Callback callback = item.second;
+
+            ++running;
+
+            QObject::connect(watcher, &QDBusPendingCallWatcher::finished, context, [this, callback](QDBusPendingCallWatcher *w) {
+                --running;
+                w->deleteLater();
+
+                if (callback)
+                    callback(*w);
+
+                startNext();
+            });
+        }
+    }
+
+    QObject *context;
+    int limit;
+    int running = 0;
+    QQueue<QPair<Call, Callback>> pending;
+};
+
+#endif // DDBUSCALLQUEUE_P_H
@@ -0,0 +1,465 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DDISKEVENTJOURNAL_P_H
+#define DDISKEVENTJOURNAL_P_H
+
+#include "udisks2_dbus_common.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QIODevice>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+
+// One notification received by DDiskManager, as stored in the journal.
+// The property values are the demarshalled ones, see UDisks2::demarshal().
+struct DDiskEvent
+{
+    enum Type : quint8 {
+        Invalid,
+        Snapshot, // all the objects, when the recording starts or after udisksd restarted
+        InterfacesAdded,
+        InterfacesRemoved,
+        PropertiesChanged,
+        ServiceOwnerChanged
+    };
+
+    typedef QMap<QString, QMap<QString, QVariantMap>> ObjectMap;
+
+    Type type = Invalid;
+    qint64 time = 0; // usecs since the start of the recording
+    QString path; // the new owner for ServiceOwnerChanged
+    QString interface;
+    QVariantMap properties;
+    QStringList names; // the interfaces removed, or the properties invalidated
+    ObjectMap objects; // Snapshot: path -> interfaces, InterfacesAdded: only the entry of path
+};
+
+// Layout of the journal, all in QDataStream (big endian, Qt 5.6 format):
+//   header: magic, version, start time in msecs since epoch
+//   events: type, usecs since the previous event (qint64), then the payload of the type
+// Every string (path, interface, property name or string value) is written once
+// and referred to by its index afterwards, the paths repeat in almost every event.
+namespace DDiskEventJournal {
+const quint32 Magic = 0x444a524e; // "DJRN"
+const quint16 Version = 1;
+
+enum ValueTag : quint8 {
+    InvalidValue,
+    PlainValue, // a builtin type QDataStream can stream in a QVariant
+    StringValue,
+    ByteArrayListValue,
+    StringListValue,
+    MapValue,
+    ConfigurationValue, // a(sa{sv}), Block.Configuration
+    ActiveDevicesValue // a(oiasta{sv}), MDRaid.ActiveDevices
+};
+}
+
+class DDiskEventWriter
+{
+public:
+    explicit DDiskEventWriter(QIODevice *device)
+        : stream(device)
+    {
+        stream.setVersion(QDataStream::Qt_5_6);
+    }
+
+    bool writeHeader()
+    {
+        stream << DDiskEventJournal::Magic << DDiskEventJournal::Version << QDateTime::currentMSecsSinceEpoch();
+        clock.start();
+        last = 0;
+        count = 0;
+
+        return stream.status() == QDataStream::Ok;
+    }
+
+    bool write(const DDiskEvent &event)
+    {
+        const qint64 now = clock.nsecsElapsed() / 1000;
+        const qint64 delta = now - last;
+
+        last = now;
+        ++count;
+        stream << static_cast<quint8>(event.type) << delta;
+
+        switch (event.type) {
+        case DDiskEvent::Snapshot:
+            stream << static_cast<quint32>(event.objects.size());
+
+            for (auto i = event.objects.constBegin(); i != event.objects.constEnd(); ++i) {
+                writeString(i.key());
+                writeInterfaces(i.value());
+            }
+            break;
+        case DDiskEvent::InterfacesAdded:
+            writeString(event.path);
+            writeInterfaces(event.objects.value(event.path));
+            break;
+        case DDiskEvent::InterfacesRemoved:
+            writeString(event.path);
+            writeStringList(event.names);
+            break;
+        case DDiskEvent::PropertiesChanged:
+            writeString(event.path);
+            writeString(event.interface);
+            writeMap(event.properties);
+            writeStringList(event.names);
+            break;
+        case DDiskEvent::ServiceOwnerChanged:
+            writeString(event.path);
+            break;
+        default:
+            break;
+        }
+
+        return stream.status() == QDataStream::Ok;
+    }
+
+    int eventCount() const
+    {
+        return count;
+    }
+
+private:
+    void writeString(const QString &string)
+    {
+        auto it = strings.constFind(string);
+
+        if (it != strings.constEnd()) {
+            stream << *it;
+            return;
+        }
+
+        const quint32 index = static_cast<quint32>(strings.size());
+
+        strings.insert(string, index);
+        stream << index << string;
+    }
+
+    void writeStringList(const QStringList &list)
+    {
+        stream << static_cast<quint32>(list.size());
+
+        for (const QString &string : list) {
+            writeString(string);
+        }
+    }
+
+    void writeMap(const QVariantMap &map)
+    {
+        stream << static_cast<quint32>(map.size());
+
+        for (auto i = map.constBegin(); i != map.constEnd(); ++i) {
+            writeString(i.key());
+            writeValue(i.value());
+        }
+    }
+
+    void writeInterfaces(const QMap<QString, QVariantMap> &interfaces)
+    {
+        stream << static_cast<quint32>(interfaces.size());
+
+        for (auto i = interfaces.constBegin(); i != interfaces.constEnd(); ++i) {
+            writeString(i.key());
+            writeMap(i.value());
+        }
+    }
+
+    void writeValue(const QVariant &value)
+    {
+        using namespace DDiskEventJournal;
+
+        const int type = value.userType();
+
+        if (type == QMetaType::QString) {
+            stream << static_cast<quint8>(StringValue);
+            writeString(value.toString());
+        } else if (type == qMetaTypeId<QByteArrayList>()) {
+            stream << static_cast<quint8>(ByteArrayListValue) << value.value<QByteArrayList>();
+        } else if (type == QMetaType::QStringList) {
+            stream << static_cast<quint8>(StringListValue);
+            writeStringList(value.toStringList());
+        } else if (type == QMetaType::QVariantMap) {
+            stream << static_cast<quint8>(MapValue);
+            writeMap(value.toMap());
+        } else if (type == qMetaTypeId<QList<QPair<QString, QVariantMap>>>()) {
+            const QList<QPair<QString, QVariantMap>> &items = value.value<QList<QPair<QString, QVariantMap>>>();
+
+            stream << static_cast<quint8>(ConfigurationValue) << static_cast<quint32>(items.size());
+
+            for (const QPair<QString, QVariantMap> &item : items) {
+                writeString(item.first);
+                writeMap(item.second);
+            }
+        } else if (type == qMetaTypeId<QList<UDisks2::ActiveDeviceInfo>>()) {
+            const QList<UDisks2::ActiveDeviceInfo> &devices = value.value<QList<UDisks2::ActiveDeviceInfo>>();
+
+            stream << static_cast<quint8>(ActiveDevicesValue) << static_cast<quint32>(devices.size());
+
+            for (const UDisks2::ActiveDeviceInfo &device : devices) {
+                writeString(device.block.path());
+                stream << device.slot;
+                writeStringList(device.state);
+                stream << device.num_read_errors;
+                writeMap(device.expansion);
+            }
+        } else if (type != QMetaType::UnknownType && type < QMetaType::User) {
+            stream << static_cast<quint8>(PlainValue) << value;
+        } else {
+            // the other D-Bus types are never left by UDisks2::demarshal() for UDisks2 properties
+            stream << static_cast<quint8>(InvalidValue);
+        }
+    }
+
+    QDataStream stream;
+    QElapsedTimer clock;
+    qint64 last = 0;
+    int count = 0;
+    QHash<QString, quint32> strings;
+};
+
+class DDiskEventReader
+{
+public:
+    explicit DDiskEventReader(QIODevice *device)
+        : stream(device)
+    {
+        stream.setVersion(QDataStream::Qt_5_6);
+    }
+
+    bool readHeader()
+    {
+        quint32 magic = 0;
+        quint16 version = 0;
+
+        stream >> magic >> version >> startTime;
+
+        if (stream.status() != QDataStream::Ok || magic != DDiskEventJournal::Magic) {
+            errorString = QStringLiteral("Not a disk event journal");
+            return false;
+        }
+
+        if (version != DDiskEventJournal::Version) {
+            errorString = QStringLiteral("Unsupported journal version %1").arg(version);
+            return false;
+        }
+
+        time = 0;
+
+        return true;
+    }
+
+    bool atEnd() const
+    {
+        return stream.atEnd();
+    }
+
+    bool read(DDiskEvent *event)
+    {
+        quint8 type = 0;
+        qint64 delta = 0;
+
+        *event = DDiskEvent();
+        stream >> type >> delta;
+        time += delta;
+        event->type = static_cast<DDiskEvent::Type>(type);
+        event->time = time;
+
+        switch (event->type) {
+        case DDiskEvent::Snapshot: {
+            quint32 count = 0;
+
+            stream >> count;
+
+            for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+                const QString &path = readString();
+
+                event->objects.insert(path, readInterfaces());
+            }
+            break;
+        }
+        case DDiskEvent::InterfacesAdded:
+            event->path = readString();
+            event->objects.insert(event->path, readInterfaces());
+            break;
+        case DDiskEvent::InterfacesRemoved:
+            event->path = readString();
+            event->names = readStringList();
+            break;
+        case DDiskEvent::PropertiesChanged:
+            event->path = readString();
+            event->interface = readString();
+            event->properties = readMap();
+            event->names = readStringList();
+            break;
+        case DDiskEvent::ServiceOwnerChanged:
+            event->path = readString();
+            break;
+        default:
+            errorString = QStringLiteral("Unknown event type %1").arg(type);
+            return false;
+        }
+
+        if (stream.status() != QDataStream::Ok) {
+            errorString = QStringLiteral("Truncated or corrupted journal");
+            return false;
+        }
+
+        return true;
+    }
+
+    qint64 startTime = 0; // msecs since epoch
+    QString errorString;
+
+private:
+    QString readString()
+    {
+        quint32 index = 0;
+
+        stream >> index;
+
+        if (index < static_cast<quint32>(strings.size()))
+            return strings.at(static_cast<int>(index));
+
+        if (index != static_cast<quint32>(strings.size())) {
+            stream.setStatus(QDataStream::ReadCorruptData);
+            return QString();
+        }
+
+        QString string;
+
+        stream >> string;
+        strings.append(string);
+
+        return string;
+    }
+
+    QStringList readStringList()
+    {
+        quint32 count = 0;
+        QStringList list;
+
+        stream >> count;
+
+        for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            list << readString();
+        }
+
+        return list;
+    }
+
+    QVariantMap readMap()
+    {
+        quint32 count = 0;
+        QVariantMap map;
+
+        stream >> count;
+
+        for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            const QString &key = readString();
+
+            map.insert(key, readValue());
+        }
+
+        return map;
+    }
+
+    QMap<QString, QVariantMap> readInterfaces()
+    {
+        quint32 count = 0;
+        QMap<QString, QVariantMap> interfaces;
+
+        stream >> count;
+
+        for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            const QString &interface = readString();
+
+            interfaces.insert(interface, readMap());
+        }
+
+        return interfaces;
+    }
+
+    QVariant readValue()
+    {
+        using namespace DDiskEventJournal;
+
+        quint8 tag = InvalidValue;
+
+        stream >> tag;
+
+        switch (tag) {
+        case PlainValue: {
+            QVariant value;
+
+            stream >> value;
+
+            return value;
+        }
+        case StringValue:
+            return readString();
+        case ByteArrayListValue: {
+            QByteArrayList list;
+
+            stream >> list;
+
+            return QVariant::fromValue(list);
+        }
+        case StringListValue:
+            return readStringList();
+        case MapValue:
+            return readMap();
+        case ConfigurationValue: {
+            quint32 count = 0;
+            QList<QPair<QString, QVariantMap>> items;
+
+            stream >> count;
+
+            for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+                const QString &type = readString();
+
+                items << qMakePair(type, readMap());
+            }
+
+            return QVariant::fromValue(items);
+        }
+        case ActiveDevicesValue: {
+            quint32 count = 0;
+            QList<UDisks2::ActiveDeviceInfo> devices;
+
+            stream >> count;
+
+            for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+                UDisks2::ActiveDeviceInfo device;
+
+                device.block = QDBusObjectPath(readString());
+                stream >> device.slot;
+                device.state = readStringList();
+                stream >> device.num_read_errors;
+                device.expansion = readMap();
+                devices << device;
+            }
+
+            return QVariant::fromValue(devices);
+        }
+        case InvalidValue:
+            return QVariant();
+        default:
+            stream.setStatus(QDataStream::ReadCorruptData);
+            return QVariant();
+        }
+    }
+
+    QDataStream stream;
+    qint64 time = 0;
+    QVector<QString> strings;
+};
+
+#endif // DDISKEVENTJOURNAL_P_H
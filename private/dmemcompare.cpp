@@ -0,0 +1,231 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dmemcompare_p.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DMEMCOMPARE_X86
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define DMEMCOMPARE_NEON
+#endif
+
+namespace DMemCompare {
+static size_t firstMismatchGeneric(const uchar *a, const uchar *b, size_t length)
+{
+    size_t i = 0;
+
+    for (; i + sizeof(quint64) <= length; i += sizeof(quint64)) {
+        quint64 x, y;
+
+        memcpy(&x, a + i, sizeof(x));
+        memcpy(&y, b + i, sizeof(y));
+
+        if (x != y)
+            break;
+    }
+
+    for (; i < length; ++i) {
+        if (a[i] != b[i])
+            return i;
+    }
+
+    return length;
+}
+
+static size_t firstNonZeroGeneric(const uchar *data, size_t length)
+{
+    size_t i = 0;
+
+    for (; i + sizeof(quint64) <= length; i += sizeof(quint64)) {
+        quint64 x;
+
+        memcpy(&x, data + i, sizeof(x));
+
+        if (x)
+            break;
+    }
+
+    for (; i < length; ++i) {
+        if (data[i])
+            return i;
+    }
+
+    return length;
+}
+
+#if defined(DMEMCOMPARE_X86)
+// a mask bit is set for every byte equal, the first clear bit is the first byte different
+__attribute__((target("sse2")))
+static size_t firstMismatchSse2(const uchar *a, const uchar *b, size_t length)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+        const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)));
+
+        if (mask != 0xffff)
+            return i + static_cast<size_t>(__builtin_ctz(~mask));
+    }
+
+    return i + firstMismatchGeneric(a + i, b + i, length - i);
+}
+
+__attribute__((target("sse2")))
+static size_t firstNonZeroSse2(const uchar *data, size_t length)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, zero)));
+
+        if (mask != 0xffff)
+            return i + static_cast<size_t>(__builtin_ctz(~mask));
+    }
+
+    return i + firstNonZeroGeneric(data + i, length - i);
+}
+
+// two vectors per iteration, the loads of the next ones overlap the compare
+__attribute__((target("avx2")))
+static size_t firstMismatchAvx2(const uchar *a, const uchar *b, size_t length)
+{
+    size_t i = 0;
+
+    for (; i + 64 <= length; i += 64) {
+        const __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        const __m256i y0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        const __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i + 32));
+        const __m256i y1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i + 32));
+        const __m256i equal = _mm256_and_si256(_mm256_cmpeq_epi8(x0, y0), _mm256_cmpeq_epi8(x1, y1));
+
+        if (static_cast<unsigned>(_mm256_movemask_epi8(equal)) == 0xffffffffu)
+            continue;
+
+        const unsigned mask0 = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x0, y0)));
+
+        if (mask0 != 0xffffffffu)
+            return i + static_cast<size_t>(__builtin_ctz(~mask0));
+
+        const unsigned mask1 = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x1, y1)));
+
+        return i + 32 + static_cast<size_t>(__builtin_ctz(~mask1));
+    }
+
+    return i + firstMismatchSse2(a + i, b + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static size_t firstNonZeroAvx2(const uchar *data, size_t length)
+{
+    size_t i = 0;
+
+    for (; i + 64 <= length; i += 64) {
+        const __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        const __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + 32));
+
+        if (_mm256_testz_si256(_mm256_or_si256(x0, x1), _mm256_or_si256(x0, x1)))
+            continue;
+
+        return i + firstNonZeroSse2(data + i, 64);
+    }
+
+    return i + firstNonZeroSse2(data + i, length - i);
+}
+
+struct Kernels
+{
+    size_t (*firstMismatch)(const uchar *, const uchar *, size_t);
+    size_t (*firstNonZero)(const uchar *, size_t);
+    const char *name;
+};
+
+// chosen once, by the CPU running the code and not by the one it was built for
+static const Kernels &kernels()
+{
+    static const Kernels selected = [] {
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2"))
+            return Kernels {firstMismatchAvx2, firstNonZeroAvx2, "avx2"};
+
+        if (__builtin_cpu_supports("sse2"))
+            return Kernels {firstMismatchSse2, firstNonZeroSse2, "sse2"};
+
+        return Kernels {firstMismatchGeneric, firstNonZeroGeneric, "generic"};
+    }();
+
+    return selected;
+}
+
+size_t firstMismatch(const uchar *a, const uchar *b, size_t length)
+{
+    return kernels().firstMismatch(a, b, length);
+}
+
+size_t firstNonZero(const uchar *data, size_t length)
+{
+    return kernels().firstNonZero(data, length);
+}
+
+const char *kernelName()
+{
+    return kernels().name;
+}
+#elif defined(DMEMCOMPARE_NEON)
+// NEON is part of aarch64, no dispatch
+size_t firstMismatch(const uchar *a, const uchar *b, size_t length)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        const uint8x16_t equal = vceqq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+
+        if (vminvq_u8(equal) != 0xff)
+            return i + firstMismatchGeneric(a + i, b + i, 16);
+    }
+
+    return i + firstMismatchGeneric(a + i, b + i, length - i);
+}
+
+size_t firstNonZero(const uchar *data, size_t length)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        if (vmaxvq_u8(vld1q_u8(data + i)) != 0)
+            return i + firstNonZeroGeneric(data + i, 16);
+    }
+
+    return i + firstNonZeroGeneric(data + i, length - i);
+}
+
+const char *kernelName()
+{
+    return "neon";
+}
+#else
+size_t firstMismatch(const uchar *a, const uchar *b, size_t length)
+{
+    return firstMismatchGeneric(a, b, length);
+}
+
+size_t firstNonZero(const uchar *data, size_t length)
+{
+    return firstNonZeroGeneric(data, length);
+}
+
+const char *kernelName()
+{
+    return "generic";
+}
+#endif
+}
@@ -0,0 +1,24 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DMEMCOMPARE_P_H
+#define DMEMCOMPARE_P_H
+
+#include <QtGlobal>
+
+#include <cstddef>
+
+// Comparison kernels for the verification of what was written to a device.
+// AVX2 or SSE2 on x86, chosen at run time, NEON on aarch64 and 8 bytes words
+// elsewhere.
+namespace DMemCompare {
+// the index of the first byte different in a and b, length if they are equal
+size_t firstMismatch(const uchar *a, const uchar *b, size_t length);
+// the index of the first byte not 0, length if all of them are
+size_t firstNonZero(const uchar *data, size_t length);
+// "avx2", "sse2", "neon" or "generic"
+const char *kernelName();
+}
+
+#endif // DMEMCOMPARE_P_H
@@ -0,0 +1,58 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DPROPERTIESDISPATCHER_P_H
+#define DPROPERTIESDISPATCHER_P_H
+
+#include <QDBusConnection>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPair>
+#include <QPointer>
+#include <QVariantMap>
+
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+class QDBusMessage;
+QT_END_NAMESPACE
+
+// One PropertiesChanged subscription to org.freedesktop.UDisks2 per connection,
+// dispatched to the subscribers of the object path of each message. Unlike a
+// match rule per object, the bus daemon doesn't have to check N rules for
+// every message and the objects cost nothing to the bus.
+class DPropertiesDispatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<void(const QString &interface, const QVariantMap &changed_properties,
+                               const QStringList &invalidated_properties)> Callback;
+
+    static DPropertiesDispatcher *instance(const QDBusConnection &connection);
+
+    // callback is called in the thread of the dispatcher (the main thread) until
+    // unsubscribe() or the destruction of context, which should live in that thread too
+    void subscribe(const QString &path, QObject *context, const Callback &callback);
+    void unsubscribe(const QString &path, QObject *context);
+
+private Q_SLOTS:
+    void onPropertiesChanged(const QString &interface, const QVariantMap &changed_properties,
+                             const QStringList &invalidated_properties, const QDBusMessage &message);
+    void onContextDestroyed(QObject *context);
+
+private:
+    explicit DPropertiesDispatcher(const QDBusConnection &connection);
+
+    void updateSubscription();
+
+    QDBusConnection connection;
+    QMutex lock;
+    QHash<QString, QList<QPair<QPointer<QObject>, Callback>>> subscribers;
+    QHash<QObject *, int> contexts; // -> subscriptions count
+    bool subscribed = false;
+};
+
+#endif // DPROPERTIESDISPATCHER_P_H
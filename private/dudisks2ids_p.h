@@ -0,0 +1,138 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DUDISKS2IDS_P_H
+#define DUDISKS2IDS_P_H
+
+#include "udisks2_dbus_common.h"
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// Interns strings to small integers, so the maps and sets keyed on object paths
+// hash and compare an int instead of a 40 characters path. An id is released
+// when its last reference is, and may then be reused for another string.
+class DStringTable
+{
+public:
+    // the id of name, added if needed, with one more reference
+    int ref(const QString &name)
+    {
+        auto it = ids.constFind(name);
+
+        if (it != ids.constEnd()) {
+            ++refs[*it];
+            return *it;
+        }
+
+        int id;
+
+        if (freeIds.isEmpty()) {
+            id = names.size();
+            names.append(name);
+            refs.append(1);
+        } else {
+            id = freeIds.takeLast();
+            names[id] = name;
+            refs[id] = 1;
+        }
+
+        ids.insert(name, id);
+
+        return id;
+    }
+
+    void deref(int id)
+    {
+        if (id < 0 || id >= refs.size() || refs[id] == 0 || --refs[id] > 0)
+            return;
+
+        ids.remove(names[id]);
+        names[id].clear();
+        freeIds.append(id);
+    }
+
+    // -1 if name is not interned
+    int id(const QString &name) const
+    {
+        return ids.value(name, -1);
+    }
+
+    QString name(int id) const
+    {
+        return names.value(id);
+    }
+
+    void clear()
+    {
+        ids.clear();
+        names.clear();
+        refs.clear();
+        freeIds.clear();
+    }
+
+private:
+    QHash<QString, int> ids;
+    QVector<QString> names;
+    QVector<int> refs;
+    QVector<int> freeIds;
+};
+
+// The interfaces of UDisks2, their ids are constants used in switches.
+// The unknown interfaces get the next ids and are never released, there are few.
+class DInterfaceTable
+{
+public:
+    enum Id {
+        Block,
+        Drive,
+        DriveAta,
+        Filesystem,
+        Partition,
+        PartitionTable,
+        Encrypted,
+        Loop,
+        Swapspace,
+        Job,
+        MDRaid,
+        Manager,
+        KnownCount
+    };
+
+    DInterfaceTable()
+    {
+        static const char *known[] = {"Block", "Drive", "Drive.Ata", "Filesystem", "Partition", "PartitionTable",
+                                      "Encrypted", "Loop", "Swapspace", "Job", "MDRaid", "Manager"};
+
+        static_assert(sizeof(known) / sizeof(known[0]) == KnownCount, "a name for every known interface");
+
+        for (const char *name : known) {
+            table.ref(QStringLiteral(UDISKS2_SERVICE ".") + QLatin1String(name));
+        }
+    }
+
+    int id(const QString &interface)
+    {
+        const int id = table.id(interface);
+
+        return id < 0 ? table.ref(interface) : id;
+    }
+
+    // -1 if never seen
+    int find(const QString &interface) const
+    {
+        return table.id(interface);
+    }
+
+    QString name(int id) const
+    {
+        return table.name(id);
+    }
+
+private:
+    DStringTable table;
+};
+
+#endif // DUDISKS2IDS_P_H
@@ -0,0 +1,122 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DXXHASH64_P_H
+#define DXXHASH64_P_H
+
+#include <QtEndian>
+#include <QtGlobal>
+
+#include <cstring>
+
+// XXH64 of Yann Collet, the hash of the chunks of the backup images: several
+// GB/s on a core, far above what a disk reads. Not cryptographic, it detects
+// the changes of a block, it doesn't resist someone forging them.
+namespace DXXHash64 {
+const quint64 Prime1 = 0x9e3779b185ebca87ULL;
+const quint64 Prime2 = 0xc2b2ae3d27d4eb4fULL;
+const quint64 Prime3 = 0x165667b19e3779f9ULL;
+const quint64 Prime4 = 0x85ebca77c2b2ae63ULL;
+const quint64 Prime5 = 0x27d4eb2f165667c5ULL;
+
+inline quint64 rotateLeft(quint64 value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// little endian whatever the CPU, the hashes are stored in the images
+inline quint64 read64(const uchar *data)
+{
+    quint64 value;
+
+    memcpy(&value, data, sizeof(value));
+
+    return qFromLittleEndian(value);
+}
+
+inline quint32 read32(const uchar *data)
+{
+    quint32 value;
+
+    memcpy(&value, data, sizeof(value));
+
+    return qFromLittleEndian(value);
+}
+
+inline quint64 mixRound(quint64 accumulator, quint64 input)
+{
+    accumulator += input * Prime2;
+    accumulator = rotateLeft(accumulator, 31);
+
+    return accumulator * Prime1;
+}
+
+inline quint64 mergeRound(quint64 accumulator, quint64 value)
+{
+    accumulator ^= mixRound(0, value);
+
+    return accumulator * Prime1 + Prime4;
+}
+
+inline quint64 hash(const uchar *data, size_t length, quint64 seed = 0)
+{
+    const uchar *const end = data + length;
+    quint64 h;
+
+    if (length >= 32) {
+        // four lanes of 8 bytes, independent so that the CPU runs them together
+        const uchar *const limit = end - 32;
+        quint64 v1 = seed + Prime1 + Prime2;
+        quint64 v2 = seed + Prime2;
+        quint64 v3 = seed;
+        quint64 v4 = seed - Prime1;
+
+        do {
+            v1 = mixRound(v1, read64(data));
+            v2 = mixRound(v2, read64(data + 8));
+            v3 = mixRound(v3, read64(data + 16));
+            v4 = mixRound(v4, read64(data + 24));
+            data += 32;
+        } while (data <= limit);
+
+        h = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    } else {
+        h = seed + Prime5;
+    }
+
+    h += static_cast<quint64>(length);
+
+    while (data + 8 <= end) {
+        h ^= mixRound(0, read64(data));
+        h = rotateLeft(h, 27) * Prime1 + Prime4;
+        data += 8;
+    }
+
+    if (data + 4 <= end) {
+        h ^= static_cast<quint64>(read32(data)) * Prime1;
+        h = rotateLeft(h, 23) * Prime2 + Prime3;
+        data += 4;
+    }
+
+    while (data < end) {
+        h ^= *data * Prime5;
+        h = rotateLeft(h, 11) * Prime1;
+        ++data;
+    }
+
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+
+    return h;
+}
+}
+
+#endif // DXXHASH64_P_H
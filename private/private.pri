@@ -1,2 +1,15 @@
 HEADERS += \
-    $$PWD/dblockdevice_p.h
+    $$PWD/dblockdevice_p.h \
+    $$PWD/ddbuscallqueue_p.h \
+    $$PWD/dcapabilitycache_p.h \
+    $$PWD/dblockdevicefilter_p.h \
+    $$PWD/ddiskeventjournal_p.h \
+    $$PWD/dudisks2ids_p.h \
+    $$PWD/dpropertiesdispatcher_p.h \
+    $$PWD/dblockio_p.h \
+    $$PWD/dmemcompare_p.h \
+    $$PWD/dbackupformat_p.h \
+    $$PWD/dxxhash64_p.h
+
+SOURCES += \
+    $$PWD/dmemcompare.cpp
@@ -7,6 +7,7 @@ URL:            https://github.com/linuxdeepin/udisks2-qt5
 Source0:        %{name}_%{version}.tar.gz
 BuildRequires:  gcc-c++
 BuildRequires:  pkgconfig(Qt5Core)
+BuildRequires:  pkgconfig(libzstd)
 
 %description
 This package provides a Qt5 binding for udisks2.
@@ -3,6 +3,9 @@ QT += core dbus
 QT -= gui
 TEMPLATE = lib
 
+CONFIG += link_pkgconfig
+PKGCONFIG += libzstd
+
 isEmpty(VERSION): VERSION = 0.0.1
 
 SOURCES += \
@@ -11,7 +14,26 @@ SOURCES += \
     $$PWD/udisks2_dbus_common.cpp \
     $$PWD/dblockdevice.cpp \
     $$PWD/dblockpartition.cpp \
-    $$PWD/dudisksjob.cpp
+    $$PWD/dudisksjob.cpp \
+    $$PWD/dpartitiontable.cpp \
+    $$PWD/dfilesystemcheckscheduler.cpp \
+    $$PWD/dblockdeviceinfo.cpp \
+    $$PWD/ddriveinfo.cpp \
+    $$PWD/ddiskdevicemodel.cpp \
+    $$PWD/dblockdevicefilter.cpp \
+    $$PWD/dblockdevicequery.cpp \
+    $$PWD/dfilesystemusagemonitor.cpp \
+    $$PWD/dsysfsblockreader.cpp \
+    $$PWD/ddiskiomonitor.cpp \
+    $$PWD/ddiskeventrecorder.cpp \
+    $$PWD/ddiskeventreplayer.cpp \
+    $$PWD/dsmarthistory.cpp \
+    $$PWD/dsmartselftestscheduler.cpp \
+    $$PWD/dsecureerasescheduler.cpp \
+    $$PWD/ddiskwiper.cpp \
+    $$PWD/dimageverifier.cpp \
+    $$PWD/dbackupwriter.cpp \
+    $$PWD/dbackupimage.cpp
 
 udisk2.files = $$PWD/org.freedesktop.UDisks2.xml
 udisk2.header_flags = -i $$PWD/udisks2_dbus_common.h -N
@@ -24,7 +46,26 @@ HEADERS += \
     $$PWD/ddiskmanager.h \
     $$PWD/dblockdevice.h \
     $$PWD/dblockpartition.h \
-    $$PWD/dudisksjob.h
+    $$PWD/dudisksjob.h \
+    $$PWD/dpartitiontable.h \
+    $$PWD/dfilesystemcheckscheduler.h \
+    $$PWD/dblockdeviceinfo.h \
+    $$PWD/ddriveinfo.h \
+    $$PWD/ddiskdevicemodel.h \
+    $$PWD/dblockdevicefilter.h \
+    $$PWD/dblockdevicequery.h \
+    $$PWD/dfilesystemusagemonitor.h \
+    $$PWD/dsysfsblockreader.h \
+    $$PWD/ddiskiomonitor.h \
+    $$PWD/ddiskeventrecorder.h \
+    $$PWD/ddiskeventreplayer.h \
+    $$PWD/dsmarthistory.h \
+    $$PWD/dsmartselftestscheduler.h \
+    $$PWD/dsecureerasescheduler.h \
+    $$PWD/ddiskwiper.h \
+    $$PWD/dimageverifier.h \
+    $$PWD/dbackupwriter.h \
+    $$PWD/dbackupimage.h
 
 include($$PWD/private/private.pri)
 
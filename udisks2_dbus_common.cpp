@@ -5,20 +5,49 @@
 #include "udisks2_dbus_common.h"
 #include "objectmanager_interface.h"
 #include "udisks2_interface.h"
+#include "private/dpropertiesdispatcher_p.h"
 
+#include <QCoreApplication>
 #include <QDBusArgument>
 #include <QDBusInterface>
 #include <QDBusConnection>
+#include <QDBusMessage>
 #include <QDBusReply>
+#include <QDBusMetaType>
+#include <QDBusServiceWatcher>
+#include <QMutex>
 #include <QXmlStreamReader>
 
 namespace UDisks2 {
 Q_GLOBAL_STATIC_WITH_ARGS(OrgFreedesktopDBusObjectManagerInterface, omGlobal, (UDISKS2_SERVICE, "/org/freedesktop/UDisks2", QDBusConnection::systemBus()))
 Q_GLOBAL_STATIC_WITH_ARGS(OrgFreedesktopUDisks2ManagerInterface, umGlobal, (UDISKS2_SERVICE, "/org/freedesktop/UDisks2/Manager", QDBusConnection::systemBus()))
 
+static void registerMetaTypes()
+{
+    static bool registered = [] {
+        qDBusRegisterMetaType<QMap<QString, QVariantMap>>();
+        qDBusRegisterMetaType<QList<QPair<QString, QVariantMap>>>();
+        qDBusRegisterMetaType<QByteArrayList>();
+        qDBusRegisterMetaType<QPair<QString,QVariantMap>>();
+        qDBusRegisterMetaType<QMap<QDBusObjectPath,QMap<QString,QVariantMap>>>();
+        qDBusRegisterMetaType<ResizeCapability>();
+
+        QMetaType::registerDebugStreamOperator<QList<QPair<QString, QVariantMap>>>();
+
+        return true;
+    }();
+
+    Q_UNUSED(registered)
+}
+
 bool interfaceExists(const QString &path, const QString &interface)
 {
-    QDBusInterface ud2(UDISKS2_SERVICE, path, "org.freedesktop.DBus.Introspectable", QDBusConnection::systemBus());
+    return interfaceExists(path, interface, QDBusConnection::systemBus());
+}
+
+bool interfaceExists(const QString &path, const QString &interface, const QDBusConnection &connection)
+{
+    QDBusInterface ud2(UDISKS2_SERVICE, path, "org.freedesktop.DBus.Introspectable", connection);
     QDBusReply<QString> reply = ud2.call("Introspect");
     QXmlStreamReader xml_parser(reply.value());
 
@@ -40,17 +69,50 @@ bool interfaceExists(const QString &path, const QString &interface)
 
 OrgFreedesktopDBusObjectManagerInterface *objectManager()
 {
-    if (!omGlobal.exists()) {
-        qDBusRegisterMetaType<QMap<QString, QVariantMap>>();
-        qDBusRegisterMetaType<QList<QPair<QString, QVariantMap>>>();
-        qDBusRegisterMetaType<QByteArrayList>();
-        qDBusRegisterMetaType<QPair<QString,QVariantMap>>();
-        qDBusRegisterMetaType<QMap<QDBusObjectPath,QMap<QString,QVariantMap>>>();
+    registerMetaTypes();
 
-        QMetaType::registerDebugStreamOperator<QList<QPair<QString, QVariantMap>>>();
+    return omGlobal;
+}
+
+OrgFreedesktopDBusObjectManagerInterface *objectManager(const QDBusConnection &connection)
+{
+    if (connection.name() == QDBusConnection::systemBus().name())
+        return objectManager();
+
+    registerMetaTypes();
+
+    // like omGlobal, the object managers of the other connections live as long as the process
+    static QMutex lock;
+    static QHash<QString, OrgFreedesktopDBusObjectManagerInterface *> managers;
+
+    QMutexLocker locker(&lock);
+    OrgFreedesktopDBusObjectManagerInterface *&om = managers[connection.name()];
+
+    if (!om) {
+        om = new OrgFreedesktopDBusObjectManagerInterface(UDISKS2_SERVICE, "/org/freedesktop/UDisks2", connection);
     }
 
-    return omGlobal;
+    return om;
+}
+
+QDBusServiceWatcher *serviceWatcher(const QDBusConnection &connection)
+{
+    static QMutex lock;
+    static QHash<QString, QDBusServiceWatcher *> watchers;
+
+    QMutexLocker locker(&lock);
+    QDBusServiceWatcher *&watcher = watchers[connection.name()];
+
+    if (!watcher) {
+        watcher = new QDBusServiceWatcher(UDISKS2_SERVICE, connection, QDBusServiceWatcher::WatchForOwnerChange);
+
+        // 创建它的可能是一个很快就会退出的线程
+        if (QCoreApplication::instance()) {
+            watcher->moveToThread(QCoreApplication::instance()->thread());
+        }
+    }
+
+    return watcher;
 }
 
 QString version()
@@ -63,6 +125,90 @@ QStringList supportedFilesystems()
     return umGlobal->supportedFilesystems();
 }
 
+QVariant demarshal(const QVariant &value)
+{
+    const int type = value.userType();
+
+    if (type == qMetaTypeId<QDBusObjectPath>())
+        return value.value<QDBusObjectPath>().path();
+
+    if (type == qMetaTypeId<QDBusVariant>())
+        return demarshal(value.value<QDBusVariant>().variant());
+
+    if (type != qMetaTypeId<QDBusArgument>())
+        return value;
+
+    const QDBusArgument &argument = value.value<QDBusArgument>();
+    const QString &signature = argument.currentSignature();
+
+    if (signature == QLatin1String("aay")) {
+        return QVariant::fromValue(qdbus_cast<QByteArrayList>(argument));
+    }
+
+    if (signature == QLatin1String("ao")) {
+        QStringList paths;
+
+        for (const QDBusObjectPath &path : qdbus_cast<QList<QDBusObjectPath>>(argument)) {
+            paths << path.path();
+        }
+
+        return paths;
+    }
+
+    if (signature == QLatin1String("a(sa{sv})")) {
+        return QVariant::fromValue(qdbus_cast<QList<QPair<QString, QVariantMap>>>(argument));
+    }
+
+    if (signature == QLatin1String("a(oiasta{sv})")) {
+        return QVariant::fromValue(qdbus_cast<QList<ActiveDeviceInfo>>(argument));
+    }
+
+    if (signature == QLatin1String("a{sv}")) {
+        QVariantMap map = qdbus_cast<QVariantMap>(argument);
+
+        for (auto i = map.begin(); i != map.end(); ++i) {
+            i.value() = demarshal(i.value());
+        }
+
+        return map;
+    }
+
+    return value;
+}
+
+bool valueEquals(const QVariant &v1, const QVariant &v2)
+{
+    if (v1.userType() != v2.userType())
+        return false;
+
+    const int type = v1.userType();
+
+    if (type == qMetaTypeId<QByteArrayList>())
+        return v1.value<QByteArrayList>() == v2.value<QByteArrayList>();
+
+    if (type == qMetaTypeId<QList<QPair<QString, QVariantMap>>>())
+        return v1.value<QList<QPair<QString, QVariantMap>>>() == v2.value<QList<QPair<QString, QVariantMap>>>();
+
+    if (type == qMetaTypeId<QList<ActiveDeviceInfo>>()) {
+        const QList<ActiveDeviceInfo> &l1 = v1.value<QList<ActiveDeviceInfo>>();
+        const QList<ActiveDeviceInfo> &l2 = v2.value<QList<ActiveDeviceInfo>>();
+
+        if (l1.count() != l2.count())
+            return false;
+
+        for (int i = 0; i < l1.count(); ++i) {
+            if (l1[i].block != l2[i].block || l1[i].slot != l2[i].slot || l1[i].state != l2[i].state
+                    || l1[i].num_read_errors != l2[i].num_read_errors || l1[i].expansion != l2[i].expansion) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    return v1 == v2;
+}
+
 }
 
 QDBusArgument &operator<<(QDBusArgument &argument, const UDisks2::SmartAttribute &mystruct)
@@ -124,3 +270,143 @@ const QDBusArgument &operator>>(const QDBusArgument &argument, UDisks2::ActiveDe
 
     return argument;
 }
+
+QDBusArgument &operator<<(QDBusArgument &argument, const UDisks2::ResizeCapability &mystruct)
+{
+    argument.beginStructure();
+    argument << mystruct.available
+             << mystruct.mode
+             << mystruct.requiredUtil;
+    argument.endStructure();
+
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, UDisks2::ResizeCapability &mystruct)
+{
+    argument.beginStructure();
+    argument >> mystruct.available
+            >> mystruct.mode
+            >> mystruct.requiredUtil;
+    argument.endStructure();
+
+    return argument;
+}
+
+DPropertiesDispatcher::DPropertiesDispatcher(const QDBusConnection &connection)
+    : connection(connection)
+{
+
+}
+
+DPropertiesDispatcher *DPropertiesDispatcher::instance(const QDBusConnection &connection)
+{
+    // like the service watchers, one per connection for the life of the process
+    static QMutex lock;
+    static QHash<QString, DPropertiesDispatcher *> dispatchers;
+
+    QMutexLocker locker(&lock);
+    DPropertiesDispatcher *&dispatcher = dispatchers[connection.name()];
+
+    if (!dispatcher) {
+        dispatcher = new DPropertiesDispatcher(connection);
+
+        if (QCoreApplication::instance()) {
+            dispatcher->moveToThread(QCoreApplication::instance()->thread());
+        }
+    }
+
+    return dispatcher;
+}
+
+void DPropertiesDispatcher::subscribe(const QString &path, QObject *context, const Callback &callback)
+{
+    QMutexLocker locker(&lock);
+
+    subscribers[path].append(qMakePair(QPointer<QObject>(context), callback));
+
+    if (contexts[context]++ == 0) {
+        connect(context, &QObject::destroyed, this, &DPropertiesDispatcher::onContextDestroyed, Qt::DirectConnection);
+    }
+
+    updateSubscription();
+}
+
+void DPropertiesDispatcher::unsubscribe(const QString &path, QObject *context)
+{
+    QMutexLocker locker(&lock);
+    auto list = subscribers.find(path);
+
+    if (list == subscribers.end())
+        return;
+
+    for (int i = 0; i < list->count(); ++i) {
+        if (list->at(i).first != context)
+            continue;
+
+        list->removeAt(i);
+
+        if (--contexts[context] == 0) {
+            contexts.remove(context);
+            disconnect(context, &QObject::destroyed, this, &DPropertiesDispatcher::onContextDestroyed);
+        }
+
+        break;
+    }
+
+    if (list->isEmpty())
+        subscribers.erase(list);
+
+    updateSubscription();
+}
+
+void DPropertiesDispatcher::onPropertiesChanged(const QString &interface, const QVariantMap &changed_properties,
+                                                const QStringList &invalidated_properties, const QDBusMessage &message)
+{
+    QMutexLocker locker(&lock);
+    const QList<QPair<QPointer<QObject>, Callback>> list = subscribers.value(message.path());
+
+    locker.unlock();
+
+    // a callback may subscribe, unsubscribe or even destroy another subscriber
+    for (const QPair<QPointer<QObject>, Callback> &subscriber : list) {
+        if (subscriber.first)
+            subscriber.second(interface, changed_properties, invalidated_properties);
+    }
+}
+
+void DPropertiesDispatcher::onContextDestroyed(QObject *context)
+{
+    QMutexLocker locker(&lock);
+
+    contexts.remove(context);
+
+    for (auto list = subscribers.begin(); list != subscribers.end();) {
+        for (int i = list->count() - 1; i >= 0; --i) {
+            // the QPointer is already null while context is destroyed
+            if (list->at(i).first.isNull() || list->at(i).first == context)
+                list->removeAt(i);
+        }
+
+        list = list->isEmpty() ? subscribers.erase(list) : list + 1;
+    }
+
+    updateSubscription();
+}
+
+// must be called with lock held, no match rule at all while nobody listens
+void DPropertiesDispatcher::updateSubscription()
+{
+    if (subscribers.isEmpty() == !subscribed)
+        return;
+
+    subscribed = !subscribed;
+
+    if (subscribed) {
+        connection.connect(UDISKS2_SERVICE, QString(), "org.freedesktop.DBus.Properties", "PropertiesChanged",
+                           this, SLOT(onPropertiesChanged(const QString &, const QVariantMap &, const QStringList &, const QDBusMessage &)));
+    } else {
+        connection.disconnect(UDISKS2_SERVICE, QString(), "org.freedesktop.DBus.Properties", "PropertiesChanged",
+                              this, SLOT(onPropertiesChanged(const QString &, const QVariantMap &, const QStringList &, const QDBusMessage &)));
+    }
+}
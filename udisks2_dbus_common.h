@@ -11,6 +11,8 @@
 
 QT_BEGIN_NAMESPACE
 class QDBusArgument;
+class QDBusConnection;
+class QDBusServiceWatcher;
 QT_END_NAMESPACE
 
 class OrgFreedesktopDBusObjectManagerInterface;
@@ -42,15 +44,35 @@ struct ActiveDeviceInfo
     QVariantMap expansion; // Currently unused. Intended for future expansion.
 };
 
+/// by: http://storaged.org/doc/udisks2-api/2.7.2/gdbus-org.freedesktop.UDisks2.Manager.html#gdbus-method-org-freedesktop-UDisks2-Manager.CanResize
+// the (bts) reply of CanResize, a nested QPair would be marshalled as (b(ts))
+struct ResizeCapability
+{
+    bool available = false;
+    quint64 mode = 0; // flags of the allowed resizing: offline/online shrinking/growing
+    QString requiredUtil; // the binary missing when available is false
+};
+
 /// by: http://storaged.org/doc/udisks2-api/2.7.2/udisks-std-options.html
 // default options
 // Many method calls take a parameter of type 'a{sv}' that is normally called options. The following table lists well-known options:
 // "auth.no_user_interaction" 	bool 	// If set to TRUE, then no user interaction will happen when checking if the method call is authorized.
 
 bool interfaceExists(const QString &path, const QString &interface);
+bool interfaceExists(const QString &path, const QString &interface, const QDBusConnection &connection);
 OrgFreedesktopDBusObjectManagerInterface *objectManager();
+OrgFreedesktopDBusObjectManagerInterface *objectManager(const QDBusConnection &connection);
+// Shared watcher of the owner of org.freedesktop.UDisks2, its signals mean that udisksd was (re)started or stopped
+QDBusServiceWatcher *serviceWatcher(const QDBusConnection &connection);
 QStringList supportedFilesystems();
 QString version();
+
+// Converts a value received in a signal payload (QDBusArgument, QDBusObjectPath...)
+// to the plain Qt type used by the property getters, e.g. "aay" to QByteArrayList
+// and "o" to QString.
+QVariant demarshal(const QVariant &value);
+// QVariant::operator== can't compare the container types used by UDisks2 properties
+bool valueEquals(const QVariant &v1, const QVariant &v2);
 }
 
 Q_DECLARE_METATYPE(UDisks2::SmartAttribute)
@@ -63,4 +85,9 @@ Q_DECLARE_METATYPE(UDisks2::ActiveDeviceInfo)
 QDBusArgument &operator<<(QDBusArgument &argument, const UDisks2::ActiveDeviceInfo &mystruct);
 const QDBusArgument &operator>>(const QDBusArgument &argument, UDisks2::ActiveDeviceInfo &mystruct);
 
+Q_DECLARE_METATYPE(UDisks2::ResizeCapability)
+
+QDBusArgument &operator<<(QDBusArgument &argument, const UDisks2::ResizeCapability &mystruct);
+const QDBusArgument &operator>>(const QDBusArgument &argument, UDisks2::ResizeCapability &mystruct);
+
 #endif // UDISK2_DBUS_COMMON_H